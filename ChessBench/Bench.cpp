@@ -0,0 +1,351 @@
+#include <string>
+#include <print>
+#include <format>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <numeric>
+#include <vector>
+#include "Attacks.h"
+#include "Board.h"
+#include "CpuFeatures.h"
+#include "Move.h"
+#include "MoveGen.h"
+#include "Eval.h"
+#include "Fen.h"
+#include "PackedPosition.h"
+
+// Microbenchmark for the individual engine kernels (movegen, make, check
+// detection, attack maps, evaluation and FEN parsing). Each kernel is timed
+// separately over a corpus of positions so a regression can be pinned on a
+// single function.
+//
+// Usage: ChessBench [--fens file] [--warmup N] [--reps N] [--iters N]
+//                   [--kernel name] [--variant auto|scalar|avx2] [--format text|json|csv] [--out file]
+
+namespace {
+
+// Default corpus: opening, middlegame and endgame positions from the usual
+// perft suites plus the puzzle scenarios used in main.cpp.
+const std::vector<std::string> default_corpus = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r2q1r2/ppp2pbk/4b1pp/4p3/4P3/3P4/PPP3BP/R1Q1R1K1 b - - 0 1",
+    "1KR4R/1PPB4/PQN4P/5PP1/8/p2b1pbp/1pp2qp1/1k1rr3 b - - 0 1",
+    "r5k1/1R3bp1/3p3p/2q2p2/p1P1pP2/P3P1P1/1Q1N1K1P/8 w - - 0 1",
+    "8/8/4k3/8/2p5/8/B2K4/8 w - - 0 1",
+};
+
+enum class OutputFormat { Text, Json, Csv };
+
+struct BenchConfig {
+    std::string fens_file;
+    std::string kernel;      // empty = all kernels
+    std::string out_file;
+    std::string variant = "auto"; // kernel variant, see CpuFeatures.h
+    int warmup = 3;
+    int reps = 15;
+    int iters = 20;          // passes over the corpus per repetition
+    OutputFormat format = OutputFormat::Text;
+};
+
+struct Position {
+    std::string fen;
+    Board board;
+    Color side;
+    std::vector<Move> moves;
+};
+
+struct KernelResult {
+    std::string name;
+    size_t calls_per_rep = 0;
+    double min_ns = 0, median_ns = 0, mean_ns = 0, p90_ns = 0, p99_ns = 0, max_ns = 0;
+};
+
+// Keeps the optimizer from discarding kernel results.
+volatile long long sink = 0;
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t idx = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+// Runs `body` warmup + reps times. `body` performs `calls` kernel invocations
+// and returns a checksum; each sample is the mean time per invocation.
+KernelResult run_kernel(const std::string& name, size_t calls, const BenchConfig& cfg,
+                        const std::function<long long()>& body) {
+    for (int i = 0; i < cfg.warmup; ++i) {
+        sink = sink + body();
+    }
+
+    std::vector<double> samples;
+    samples.reserve(cfg.reps);
+    for (int i = 0; i < cfg.reps; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        long long checksum = body();
+        auto stop = std::chrono::steady_clock::now();
+        sink = sink + checksum;
+        double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+        samples.push_back(ns / static_cast<double>(std::max<size_t>(calls, 1)));
+    }
+    std::sort(samples.begin(), samples.end());
+
+    KernelResult r;
+    r.name = name;
+    r.calls_per_rep = calls;
+    r.min_ns = samples.front();
+    r.max_ns = samples.back();
+    r.median_ns = percentile(samples, 50);
+    r.p90_ns = percentile(samples, 90);
+    r.p99_ns = percentile(samples, 99);
+    r.mean_ns = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    return r;
+}
+
+std::vector<Position> load_corpus(const BenchConfig& cfg) {
+    std::vector<std::string> fens;
+    if (!cfg.fens_file.empty()) {
+        std::ifstream in(cfg.fens_file);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            fens.push_back(line);
+        }
+    } else {
+        fens = default_corpus;
+    }
+
+    std::vector<Position> corpus;
+    for (const auto& fen : fens) {
+        Position pos{ fen, Board{}, Color::White, {} };
+        if (!pos.board.set_fen(fen)) {
+            std::println(stderr, "Skipping invalid FEN: {}", fen);
+            continue;
+        }
+        pos.side = pos.board.get_side_to_move();
+        auto result = generate_legal_moves(&pos.board, pos.side);
+        if (result) pos.moves = std::move(*result);
+        corpus.push_back(std::move(pos));
+    }
+    return corpus;
+}
+
+std::vector<KernelResult> run_benchmarks(const std::vector<Position>& corpus, const BenchConfig& cfg) {
+    std::vector<KernelResult> results;
+    auto wanted = [&](const std::string& name) { return cfg.kernel.empty() || cfg.kernel == name; };
+    const size_t n = corpus.size() * cfg.iters;
+
+    if (wanted("set_fen")) {
+        results.push_back(run_kernel("set_fen", n, cfg, [&] {
+            long long sum = 0;
+            Board board;
+            for (int it = 0; it < cfg.iters; ++it)
+                for (const auto& pos : corpus)
+                    sum += board.set_fen(pos.fen);
+            return sum;
+        }));
+    }
+
+    if (wanted("parse_fen_strict")) {
+        results.push_back(run_kernel("parse_fen_strict", n, cfg, [&] {
+            long long sum = 0;
+            Board board;
+            for (int it = 0; it < cfg.iters; ++it)
+                for (const auto& pos : corpus)
+                    sum += parse_fen(pos.fen, board, FenMode::Strict).has_value();
+            return sum;
+        }));
+    }
+
+    if (wanted("write_fen")) {
+        results.push_back(run_kernel("write_fen", n, cfg, [&] {
+            long long sum = 0;
+            char buffer[MaxFenLength];
+            for (int it = 0; it < cfg.iters; ++it)
+                for (const auto& pos : corpus)
+                    sum += static_cast<long long>(write_fen(pos.board, buffer));
+            return sum;
+        }));
+    }
+
+    if (wanted("generate_legal_moves")) {
+        results.push_back(run_kernel("generate_legal_moves", n, cfg, [&] {
+            long long sum = 0;
+            for (int it = 0; it < cfg.iters; ++it)
+                for (const auto& pos : corpus) {
+                    auto moves = generate_legal_moves(&pos.board, pos.side);
+                    if (moves) sum += static_cast<long long>(moves->size());
+                }
+            return sum;
+        }));
+    }
+
+    if (wanted("apply_move")) {
+        size_t moves_total = 0;
+        for (const auto& pos : corpus) moves_total += pos.moves.size();
+        // Copy-make: the engine has no unmake, so the board copy is part of the cost.
+        results.push_back(run_kernel("apply_move", moves_total * cfg.iters, cfg, [&] {
+            long long sum = 0;
+            for (int it = 0; it < cfg.iters; ++it)
+                for (const auto& pos : corpus)
+                    for (const auto& move : pos.moves) {
+                        Board next = pos.board;
+                        apply_move(next, move);
+                        sum += next.at(move.to_rank, move.to_file).has_value();
+                    }
+            return sum;
+        }));
+    }
+
+    if (wanted("king_in_check")) {
+        results.push_back(run_kernel("king_in_check", n, cfg, [&] {
+            long long sum = 0;
+            for (int it = 0; it < cfg.iters; ++it)
+                for (const auto& pos : corpus)
+                    sum += king_in_check(pos.board, pos.side);
+            return sum;
+        }));
+    }
+
+    if (wanted("compute_attacks")) {
+        results.push_back(run_kernel("compute_attacks", n, cfg, [&] {
+            long long sum = 0;
+            for (int it = 0; it < cfg.iters; ++it)
+                for (const auto& pos : corpus) {
+                    AttackInfo attacks = compute_attacks(pos.board, pos.side);
+                    sum += attacks.mobility[0] + attacks.in_check();
+                }
+            return sum;
+        }));
+    }
+
+    if (wanted("evaluate_board")) {
+        results.push_back(run_kernel("evaluate_board", n, cfg, [&] {
+            long long sum = 0;
+            for (int it = 0; it < cfg.iters; ++it)
+                for (const auto& pos : corpus)
+                    sum += evaluate_board(pos.board, pos.side);
+            return sum;
+        }));
+    }
+
+    if (wanted("evaluate_batch")) {
+        std::vector<PackedPosition> packed;
+        for (const auto& pos : corpus) {
+            if (auto p = pack_position(pos.board)) packed.push_back(*p);
+        }
+        std::vector<int> scores(packed.size());
+        results.push_back(run_kernel("evaluate_batch", packed.size() * cfg.iters, cfg, [&] {
+            long long sum = 0;
+            for (int it = 0; it < cfg.iters; ++it) {
+                evaluate_batch(packed, scores);
+                sum += std::accumulate(scores.begin(), scores.end(), 0LL);
+            }
+            return sum;
+        }));
+    }
+
+    return results;
+}
+
+std::string format_results(const std::vector<KernelResult>& results, size_t positions, const BenchConfig& cfg) {
+    std::string out;
+    switch (cfg.format) {
+    case OutputFormat::Text:
+        out += std::format("cpu {}  variant {}\n", cpu_features().to_string(), kernel_variant_name(kernel_variant()));
+        out += std::format("positions {}  warmup {}  reps {}  iters {}\n", positions, cfg.warmup, cfg.reps, cfg.iters);
+        out += std::format("{:<22}{:>12}{:>12}{:>12}{:>12}{:>12}{:>12}\n",
+                           "kernel", "calls/rep", "min ns", "median ns", "p90 ns", "p99 ns", "mean ns");
+        for (const auto& r : results) {
+            out += std::format("{:<22}{:>12}{:>12.1f}{:>12.1f}{:>12.1f}{:>12.1f}{:>12.1f}\n",
+                               r.name, r.calls_per_rep, r.min_ns, r.median_ns, r.p90_ns, r.p99_ns, r.mean_ns);
+        }
+        break;
+    case OutputFormat::Json:
+        out += std::format("{{\"cpu\":\"{}\",\"variant\":\"{}\",\"positions\":{},\"warmup\":{},\"reps\":{},\"iters\":{},\"results\":[",
+                           cpu_features().to_string(), kernel_variant_name(kernel_variant()), positions, cfg.warmup, cfg.reps, cfg.iters);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            out += std::format("{}{{\"kernel\":\"{}\",\"calls_per_rep\":{},\"min_ns\":{:.2f},\"median_ns\":{:.2f},"
+                               "\"p90_ns\":{:.2f},\"p99_ns\":{:.2f},\"max_ns\":{:.2f},\"mean_ns\":{:.2f}}}",
+                               i ? "," : "", r.name, r.calls_per_rep, r.min_ns, r.median_ns,
+                               r.p90_ns, r.p99_ns, r.max_ns, r.mean_ns);
+        }
+        out += "]}\n";
+        break;
+    case OutputFormat::Csv:
+        out += "kernel,calls_per_rep,min_ns,median_ns,p90_ns,p99_ns,max_ns,mean_ns\n";
+        for (const auto& r : results) {
+            out += std::format("{},{},{:.2f},{:.2f},{:.2f},{:.2f},{:.2f},{:.2f}\n",
+                               r.name, r.calls_per_rep, r.min_ns, r.median_ns, r.p90_ns, r.p99_ns, r.max_ns, r.mean_ns);
+        }
+        break;
+    }
+    return out;
+}
+
+bool parse_args(int argc, char* argv[], BenchConfig& cfg) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return (i + 1 < argc) ? argv[++i] : ""; };
+        if (arg == "--fens") cfg.fens_file = next();
+        else if (arg == "--warmup") cfg.warmup = std::stoi(next());
+        else if (arg == "--reps") cfg.reps = std::max(1, std::stoi(next()));
+        else if (arg == "--iters") cfg.iters = std::max(1, std::stoi(next()));
+        else if (arg == "--kernel") cfg.kernel = next();
+        else if (arg == "--variant") cfg.variant = next();
+        else if (arg == "--out") cfg.out_file = next();
+        else if (arg == "--format") {
+            std::string f = next();
+            if (f == "json") cfg.format = OutputFormat::Json;
+            else if (f == "csv") cfg.format = OutputFormat::Csv;
+            else if (f == "text") cfg.format = OutputFormat::Text;
+            else return false;
+        }
+        else return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchConfig cfg;
+    try {
+        if (!parse_args(argc, argv, cfg)) {
+            std::println(stderr, "Usage: ChessBench [--fens file] [--warmup N] [--reps N] [--iters N] "
+                                 "[--kernel name] [--variant auto|scalar|avx2] [--format text|json|csv] [--out file]");
+            return 1;
+        }
+        if (!set_kernel_variant(cfg.variant)) {
+            std::println(stderr, "Kernel variant {} is not available (cpu: {}).", cfg.variant, cpu_features().to_string());
+            return 1;
+        }
+    } catch (const std::exception&) {
+        std::println(stderr, "Invalid numeric argument.");
+        return 1;
+    }
+
+    auto corpus = load_corpus(cfg);
+    if (corpus.empty()) {
+        std::println(stderr, "No positions to benchmark.");
+        return 1;
+    }
+
+    auto results = run_benchmarks(corpus, cfg);
+    std::string report = format_results(results, corpus.size(), cfg);
+
+    if (cfg.out_file.empty()) {
+        std::print("{}", report);
+    } else {
+        std::ofstream out(cfg.out_file);
+        out << report;
+    }
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include "AnalysisCache.h"
+#include "EvalParams.h"
+#include "MappedFile.h"
+#include "MoveGen.h"
+#include "TranspositionTable.h"
+#include "Zobrist.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+
+namespace {
+
+constexpr char FileMagic[8] = { 'C', 'H', 'C', 'A', 'C', 'H', 'E', '1' };
+
+// FNV-1a over the evaluation parameters. Scores searched with other
+// parameters are not valid for this build, so such a file is refused.
+constexpr uint32_t eval_params_hash() {
+    uint32_t hash = 2166136261u;
+    auto mix = [&](int value) {
+        for (int byte = 0; byte < 4; ++byte) {
+            hash ^= (static_cast<uint32_t>(value) >> (8 * byte)) & 0xFF;
+            hash *= 16777619u;
+        }
+    };
+    for (int value : piece_values) mix(value);
+    for (const auto& row : pawn_table) {
+        for (int value : row) mix(value);
+    }
+    return hash;
+}
+
+struct FileHeader {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t eval_hash;  // eval_params_hash() of the build that wrote it
+};
+static_assert(sizeof(FileHeader) == 16);
+static_assert(sizeof(AnalysisCache::Record) == 16);
+
+// Reads the records of a cache file; false if it exists but is not one, or
+// was written with other evaluation parameters.
+bool read_records(const std::string& path, std::vector<AnalysisCache::Record>& records, bool& exists) {
+    records.clear();
+    std::error_code error;
+    exists = std::filesystem::file_size(path, error) > 0 && !error;
+    if (!exists) return true;
+
+    MappedFile file;
+    if (!file.open(path)) return false;
+    FileHeader header;
+    if (file.size() < sizeof(header)) return false;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0 || header.record_size != sizeof(AnalysisCache::Record) ||
+        header.eval_hash != eval_params_hash())
+        return false;
+
+    size_t count = (file.size() - sizeof(header)) / sizeof(AnalysisCache::Record);
+    records.resize(count);
+    std::memcpy(records.data(), file.data() + sizeof(header), count * sizeof(AnalysisCache::Record));
+    return true;
+}
+
+void write_header(std::ofstream& out) {
+    FileHeader header{};
+    std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+    header.record_size = sizeof(AnalysisCache::Record);
+    header.eval_hash = eval_params_hash();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+} // namespace
+
+bool AnalysisCache::open(const std::string& path) {
+    close();
+    bool exists = false;
+    if (!read_records(path, records_, exists)) return false;
+
+    if (exists) {
+        // Drop a partial record from an interrupted append.
+        auto expected = sizeof(FileHeader) + records_.size() * sizeof(Record);
+        if (std::filesystem::file_size(path) != expected) std::filesystem::resize_file(path, expected);
+        out_.open(path, std::ios::binary | std::ios::app);
+    } else {
+        out_.open(path, std::ios::binary | std::ios::trunc);
+        write_header(out_);
+        out_.flush();
+    }
+    if (!out_) {
+        records_.clear();
+        return false;
+    }
+    for (const Record& record : records_) {
+        auto [it, inserted] = depths_.try_emplace(record.key, record.depth);
+        if (!inserted) it->second = std::max(it->second, record.depth);
+    }
+    path_ = path;
+    return true;
+}
+
+void AnalysisCache::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (out_.is_open()) out_.close();
+    records_.clear();
+    depths_.clear();
+    path_.clear();
+}
+
+size_t AnalysisCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_.size();
+}
+
+size_t AnalysisCache::warm(TranspositionTable& tt) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const Record& record : records_) {
+        if (record.bound != Bound::Exact) continue;
+        tt.store(record.key, record.depth, record.score, record.move);
+        ++count;
+    }
+    return count;
+}
+
+void AnalysisCache::record(const Record& record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!out_.is_open()) return;
+    auto [it, inserted] = depths_.try_emplace(record.key, record.depth);
+    if (!inserted) {
+        if (it->second >= record.depth) return;
+        it->second = record.depth;
+    }
+    out_.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    out_.flush();
+    records_.push_back(record);
+}
+
+void AnalysisCache::record_search(const TranspositionTable& tt, const Board& root, int max_plies) {
+    if (!is_open()) return;
+    Board board = root;
+    for (int ply = 0; ply < max_plies; ++ply) {
+        uint64_t key = zobrist_key(board);
+        auto entry = tt.probe(key);
+        if (!entry || (ply == 0 && entry->depth < min_depth_)) break;
+        record({ key, entry->score, entry->move, static_cast<uint8_t>(entry->depth), Bound::Exact });
+
+        auto move = TranspositionTable::decode_move(board, entry->move);
+        if (!move) break;
+        apply_move(board, *move);
+    }
+}
+
+bool compact_analysis_cache(const std::string& input_path, const std::string& output_path, int min_depth,
+                            size_t& records_in, size_t& records_out) {
+    std::vector<AnalysisCache::Record> records;
+    bool exists = false;
+    if (!read_records(input_path, records, exists) || !exists) return false;
+    records_in = records.size();
+
+    // Later records win ties, matching the order the table would see them in.
+    std::unordered_map<uint64_t, size_t> best;
+    best.reserve(records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (records[i].depth < min_depth) continue;
+        auto [it, inserted] = best.try_emplace(records[i].key, i);
+        if (!inserted && records[it->second].depth <= records[i].depth) it->second = i;
+    }
+    std::vector<size_t> kept;
+    kept.reserve(best.size());
+    for (const auto& [key, index] : best) kept.push_back(index);
+    std::sort(kept.begin(), kept.end());
+
+    // Write next to the target and rename, so compacting in place is safe.
+    std::string temp_path = output_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        write_header(out);
+        for (size_t index : kept) out.write(reinterpret_cast<const char*>(&records[index]), sizeof(records[index]));
+        if (!out) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, output_path, error);
+    if (error) return false;
+    records_out = kept.size();
+    return true;
+}
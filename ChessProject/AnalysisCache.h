@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Board.h"
+
+class TranspositionTable;
+
+// Persistent store of deep search results, shared across runs and machines.
+// The file is a 16-byte header ("CHCACHE1", record size, a hash of the
+// evaluation parameters) followed by an append-only log of 16-byte records;
+// a later or deeper record for the same position supersedes an earlier one.
+// A file written with other parameters (e.g. before a tuning run) does not
+// open, as its scores no longer match this evaluation. The full 64-bit
+// Zobrist key is kept, so a table slot collision can never return another
+// position's entry.
+class AnalysisCache {
+public:
+    enum class Bound : uint8_t { Exact, Lower, Upper };
+
+    struct Record {
+        uint64_t key;
+        int32_t score;   // for the side to move
+        uint16_t move;   // TranspositionTable::encode_move
+        uint8_t depth;
+        Bound bound;
+    };
+
+    ~AnalysisCache() { close(); }
+
+    // Maps the existing records of `path` (creating the file if needed) and
+    // opens it for appending. A torn record left by a crash is cut off. False
+    // if the file is not a cache or has another evaluation parameter hash.
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return out_.is_open(); }
+    const std::string& path() const { return path_; }
+    size_t size() const;
+
+    // Only results searched at least this deep are recorded.
+    void set_min_depth(int depth) { min_depth_ = depth; }
+    int min_depth() const { return min_depth_; }
+
+    // Stores every exact record read at open() in `tt`; the table keeps the
+    // deepest entry per position. Returns the number of records offered.
+    size_t warm(TranspositionTable& tt) const;
+
+    // Appends the table entries along the principal variation from `root`
+    // when the root entry is at least min_depth() deep. Positions already
+    // stored at the same or a greater depth are skipped. Safe to call from
+    // several threads.
+    void record_search(const TranspositionTable& tt, const Board& root, int max_plies);
+    void record(const Record& record);
+
+private:
+    std::string path_;
+    std::vector<Record> records_; // loaded at open() plus everything recorded since
+    std::unordered_map<uint64_t, uint8_t> depths_; // deepest stored record per key
+    std::ofstream out_;
+    mutable std::mutex mutex_;
+    int min_depth_ = 6;
+};
+
+// Rewrites a cache file keeping one record per position (the deepest, the
+// latest of equally deep ones) and dropping those shallower than min_depth.
+bool compact_analysis_cache(const std::string& input_path, const std::string& output_path, int min_depth,
+                            size_t& records_in, size_t& records_out);
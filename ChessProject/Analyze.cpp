@@ -0,0 +1,215 @@
+#include "Analyze.h"
+#include "AnalysisCache.h"
+#include "Fen.h"
+#include "Json.h"
+#include "MoveGen.h"
+#include "Memory.h"
+#include "TranspositionTable.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <print>
+
+namespace {
+
+struct Job {
+    uint64_t seq;
+    uint64_t line_no;
+    std::string text;
+};
+
+// Analyses one FEN/EPD line and returns its JSON result.
+std::string analyze_line(const Job& job, MoveSelector& selector, const SearchLimits& limits, AnalysisCache& cache) {
+    // The four FEN fields, as echoed back; move counters and EPD operations
+    // such as id "pos 12"; follow them.
+    std::string_view text = job.text;
+    size_t end = 0;
+    for (int field = 0; field < 4 && end != std::string_view::npos; ++field) {
+        end = text.find_first_of(" \t\r", text.find_first_not_of(" \t", end));
+    }
+    std::string_view fen = text.substr(0, end);
+    fen.remove_prefix(std::min(fen.find_first_not_of(" \t"), fen.size()));
+
+    Board board;
+    auto ops = parse_fen(text, board);
+
+    std::string json = std::format("{{\"line\":{},", job.line_no);
+    if (ops && !ops->id.empty()) json += std::format("\"id\":\"{}\",", json_escape(ops->id));
+    json += std::format("\"fen\":\"{}\",", json_escape(fen));
+    if (!ops) return json + "\"error\":\"invalid position\"}";
+
+    Color side = board.get_side_to_move();
+    auto moves = generate_legal_moves(&board, side);
+    if (!moves) return json + std::format("\"error\":\"{}\"}}", json_escape(moves.error()));
+    if (moves->empty()) {
+        return json + std::format("\"bestmove\":null,\"result\":\"{}\"}}",
+                                  king_in_check(board, side) ? "checkmate" : "stalemate");
+    }
+
+    Move best = selector.search(board, side, limits);
+    const SearchStats& stats = selector.last_stats();
+    if (selector.history_independent(board)) cache.record_search(*selector.transposition_table(), board, stats.depth);
+    auto pv = selector.principal_variation(board, side);
+    if (pv.empty()) pv.push_back(best);
+
+    json += std::format("\"bestmove\":\"{}\",\"score\":{},\"depth\":{},\"nodes\":{},\"time_ms\":{:.1f},\"pv\":[",
+                        uci_move(board, best), selector.last_score(), stats.depth, stats.total.nodes, stats.elapsed_ms);
+    Board line = board;
+    for (size_t i = 0; i < pv.size(); ++i) {
+        json += std::format("{}\"{}\"", i ? "," : "", uci_move(line, pv[i]));
+        apply_move(line, pv[i]);
+    }
+    return json + "]}";
+}
+
+} // namespace
+
+std::optional<AnalyzeOptions> parse_analyze_args(const std::vector<std::string>& args) {
+    AnalyzeOptions options;
+    bool has_depth = false;
+    try {
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if (arg == "--input" && has_value) options.input_path = args[++i];
+            else if (arg == "--output" && has_value) options.output_path = args[++i];
+            else if (arg == "--workers" && has_value) options.workers = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--depth" && has_value) { options.limits.depth = std::stoi(args[++i]); has_depth = true; }
+            else if (arg == "--nodes" && has_value) options.limits.nodes = std::stoull(args[++i]);
+            else if (arg == "--movetime" && has_value) options.limits.movetime_ms = std::stoll(args[++i]);
+            else if (arg == "--hash" && has_value) options.hash_mb = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--shared-hash") options.shared_hash = true;
+            else if (arg == "--cache" && has_value) options.cache_path = args[++i];
+            else if (arg == "--cache-depth" && has_value) options.cache_depth = std::max(1, std::stoi(args[++i]));
+            else return std::nullopt;
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    if (options.input_path.empty()) return std::nullopt;
+    if (!has_depth && (options.limits.nodes || options.limits.movetime_ms)) options.limits.depth = SearchLimits::MaxDepth;
+    return options;
+}
+
+int run_analyze(const AnalyzeOptions& options) {
+    std::ifstream file;
+    if (options.input_path != "-") {
+        file.open(options.input_path);
+        if (!file) {
+            std::println(stderr, "Cannot open {}", options.input_path);
+            return 1;
+        }
+    }
+    std::istream& in = options.input_path == "-" ? std::cin : file;
+
+    std::ofstream out_file;
+    if (!options.output_path.empty()) {
+        out_file.open(options.output_path, std::ios::trunc);
+        if (!out_file) {
+            std::println(stderr, "Cannot write {}", options.output_path);
+            return 1;
+        }
+    }
+    std::ostream& out = options.output_path.empty() ? std::cout : out_file;
+
+    AnalysisCache cache;
+    if (!options.cache_path.empty()) {
+        if (!cache.open(options.cache_path)) {
+            std::println(stderr, "Cannot open analysis cache {}", options.cache_path);
+            return 1;
+        }
+        cache.set_min_depth(options.cache_depth);
+        std::println(stderr, "Analysis cache {}: {} records", options.cache_path, cache.size());
+    }
+
+    std::unique_ptr<TranspositionTable> shared_tt;
+    if (options.shared_hash) {
+        shared_tt = std::make_unique<TranspositionTable>(options.hash_mb);
+        cache.warm(*shared_tt);
+    }
+
+    // Positions are numbered as they are read. A position is only handed out
+    // while it is within `window` of the oldest unwritten one, which bounds
+    // the queue plus the results waiting to be written in order.
+    const uint64_t window = static_cast<uint64_t>(options.workers) * 4;
+    std::mutex mutex;
+    std::condition_variable work_ready, space_ready;
+    std::deque<Job> queue;
+    std::map<uint64_t, std::string> finished;
+    uint64_t next_out = 0;
+    bool input_done = false;
+
+    auto worker = [&](int index) {
+        // A private table is allocated after binding, on the worker's node.
+        bind_thread_to_node(index);
+        std::unique_ptr<TranspositionTable> own_tt;
+        if (!shared_tt) {
+            own_tt = std::make_unique<TranspositionTable>(options.hash_mb, TranspositionTable::Placement::Local);
+            cache.warm(*own_tt);
+        }
+        MoveSelector selector(1);
+        selector.set_transposition_table(shared_tt ? shared_tt.get() : own_tt.get());
+
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_ready.wait(lock, [&] { return !queue.empty() || input_done; });
+                if (queue.empty()) break;
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            std::string result = analyze_line(job, selector, options.limits, cache);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.emplace(job.seq, std::move(result));
+            bool advanced = false;
+            for (auto it = finished.begin(); it != finished.end() && it->first == next_out; it = finished.erase(it)) {
+                out << it->second << '\n';
+                ++next_out;
+                advanced = true;
+            }
+            if (advanced) {
+                out.flush();
+                space_ready.notify_one();
+            }
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t positions = 0;
+    {
+        std::vector<std::jthread> pool;
+        for (int i = 0; i < options.workers; ++i) pool.emplace_back(worker, i);
+
+        std::string line;
+        uint64_t line_no = 0;
+        while (std::getline(in, line)) {
+            ++line_no;
+            auto first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') continue;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            space_ready.wait(lock, [&] { return positions < next_out + window; });
+            queue.push_back({ positions++, line_no, std::move(line) });
+            work_ready.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            input_done = true;
+        }
+        work_ready.notify_all();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::println(stderr, "Analysed {} positions in {:.2f} s ({:.1f} positions/s, {} workers)",
+                 positions, seconds, seconds > 0 ? positions / seconds : 0.0, options.workers);
+    return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Eval.h"
+
+struct AnalyzeOptions {
+    std::string input_path;    // FEN or EPD per line, "-" for stdin
+    std::string output_path;   // JSON lines, stdout when empty
+    int workers = std::max(1u, std::thread::hardware_concurrency());
+    SearchLimits limits;
+    size_t hash_mb = 16;       // per worker, or in total with shared_hash
+    bool shared_hash = false;
+    std::string cache_path;    // AnalysisCache file, warm-starts the tables and keeps deep results
+    int cache_depth = 6;
+};
+
+// Parses the arguments following "analyze" on the command line.
+std::optional<AnalyzeOptions> parse_analyze_args(const std::vector<std::string>& args);
+
+// Analyses every position of the input with a pool of single-threaded
+// searches and writes one JSON object per line, in input order. At most a
+// few positions per worker are held in memory regardless of input size.
+int run_analyze(const AnalyzeOptions& options);
@@ -0,0 +1,120 @@
+#include "Attacks.h"
+#include <bit>
+
+namespace {
+
+constexpr int knight_steps[8][2] = { {2, 1}, {1, 2}, {-1, 2}, {-2, 1}, {-2, -1}, {-1, -2}, {1, -2}, {2, -1} };
+// Lines first, then diagonals.
+constexpr int king_steps[8][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+
+constexpr bool on_board(int rank, int file) {
+    return rank >= 0 && rank < Board::Size && file >= 0 && file < Board::Size;
+}
+
+uint64_t step_attacks(int rank, int file, const int (&steps)[8][2]) {
+    uint64_t attacks = 0;
+    for (const auto& [dr, df] : steps) {
+        if (on_board(rank + dr, file + df)) attacks |= square_bit(rank + dr, file + df);
+    }
+    return attacks;
+}
+
+// Squares along a ray up to and including the first piece. The piece on
+// `transparent` (or no square, when it is 0) does not block.
+uint64_t ray_attacks(const Board& board, int rank, int file, int dr, int df, uint64_t transparent) {
+    uint64_t attacks = 0;
+    for (int r = rank + dr, f = file + df; on_board(r, f); r += dr, f += df) {
+        attacks |= square_bit(r, f);
+        if (board.at(r, f) && !(square_bit(r, f) & transparent)) break;
+    }
+    return attacks;
+}
+
+bool slides_along(PieceType type, bool diagonal) {
+    return type == PieceType::Queen || type == (diagonal ? PieceType::Bishop : PieceType::Rook);
+}
+
+} // namespace
+
+AttackInfo compute_attacks(const Board& board, Color side_to_move) {
+    AttackInfo info;
+    info.us = side_to_move;
+    const int us = static_cast<int>(side_to_move);
+
+    std::array<uint64_t, 2> occupied{};
+    int king_squares[2][2] = { {-1, -1}, {-1, -1} };
+    for (int rank = 0; rank < Board::Size; ++rank) {
+        for (int file = 0; file < Board::Size; ++file) {
+            const auto& sq = board.at(rank, file);
+            if (!sq) continue;
+            occupied[static_cast<int>(sq->color)] |= square_bit(rank, file);
+            if (sq->type == PieceType::King) {
+                king_squares[static_cast<int>(sq->color)][0] = rank;
+                king_squares[static_cast<int>(sq->color)][1] = file;
+            }
+        }
+    }
+    for (int color = 0; color < 2; ++color) {
+        auto [rank, file] = king_squares[color];
+        if (rank >= 0) info.king_zone[color] = square_bit(rank, file) | step_attacks(rank, file, king_steps);
+    }
+    info.king_rank = king_squares[us][0];
+    info.king_file = king_squares[us][1];
+    uint64_t our_king = info.king_rank >= 0 ? square_bit(info.king_rank, info.king_file) : 0;
+
+    for (int rank = 0; rank < Board::Size; ++rank) {
+        for (int file = 0; file < Board::Size; ++file) {
+            const auto& sq = board.at(rank, file);
+            if (!sq) continue;
+            const int color = static_cast<int>(sq->color);
+            uint64_t transparent = color != us ? our_king : 0;
+            uint64_t attacks = 0;
+            switch (sq->type) {
+                case PieceType::Pawn: {
+                    int forward = rank + (sq->color == Color::White ? 1 : -1);
+                    for (int df : { -1, 1 }) {
+                        if (on_board(forward, file + df)) attacks |= square_bit(forward, file + df);
+                    }
+                    break;
+                }
+                case PieceType::Knight: attacks = step_attacks(rank, file, knight_steps); break;
+                case PieceType::King:   attacks = step_attacks(rank, file, king_steps); break;
+                default:
+                    for (int d = 0; d < 8; ++d) {
+                        if (slides_along(sq->type, d >= 4)) {
+                            attacks |= ray_attacks(board, rank, file, king_steps[d][0], king_steps[d][1], transparent);
+                        }
+                    }
+                    break;
+            }
+            info.attacked[color] |= attacks;
+            if (sq->type != PieceType::Pawn && sq->type != PieceType::King) {
+                info.mobility[color] += std::popcount(attacks & ~occupied[color]);
+            }
+            if (attacks & info.king_zone[1 - color]) ++info.king_zone_attackers[1 - color];
+            if (color != us && (attacks & our_king)) info.checkers |= square_bit(rank, file);
+        }
+    }
+
+    // A pin is one of our pieces, then an enemy slider, on a line from our king.
+    if (info.king_rank < 0) return info;
+    for (int d = 0; d < 8; ++d) {
+        const auto [dr, df] = king_steps[d];
+        uint64_t shield = 0;
+        for (int r = info.king_rank + dr, f = info.king_file + df; on_board(r, f); r += dr, f += df) {
+            const auto& sq = board.at(r, f);
+            if (!sq) continue;
+            if (sq->color == side_to_move) {
+                if (shield) break;
+                shield = square_bit(r, f);
+                continue;
+            }
+            if (shield && slides_along(sq->type, d >= 4)) {
+                info.pinned |= shield;
+                info.pinners |= square_bit(r, f);
+            }
+            break;
+        }
+    }
+    return info;
+}
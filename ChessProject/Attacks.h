@@ -0,0 +1,39 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "Board.h"
+
+// Attack information of a position, computed once when the search enters a
+// node. Legal move generation and check detection read it instead of
+// scanning the board again for every trial move, and evaluation terms can
+// take mobility and king safety from it. Square sets are bitmasks with bit
+// rank * 8 + file, as in PackedPosition.
+
+constexpr uint64_t square_bit(int rank, int file) {
+    return uint64_t(1) << (rank * 8 + file);
+}
+
+struct AttackInfo {
+    Color us = Color::White;             // side to move
+    int king_rank = -1, king_file = -1;  // king of the side to move; -1 without one
+
+    // Squares attacked by each side, indexed by Color. The attacks of the
+    // side not to move go through our king, so stepping back along a
+    // checking line is seen as stepping into check.
+    std::array<uint64_t, 2> attacked{};
+    // Each king's square and its neighbours, and how many enemy pieces
+    // attack that zone.
+    std::array<uint64_t, 2> king_zone{};
+    std::array<int, 2> king_zone_attackers{};
+    // Squares the knights, bishops, rooks and queens of each side reach
+    // without landing on their own pieces.
+    std::array<int, 2> mobility{};
+
+    uint64_t checkers = 0;  // enemy pieces giving check
+    uint64_t pinned = 0;    // our pieces that may only move along the line to our king
+    uint64_t pinners = 0;   // enemy sliders pinning them
+
+    bool in_check() const { return checkers != 0; }
+};
+
+AttackInfo compute_attacks(const Board& board, Color side_to_move);
@@ -0,0 +1,274 @@
+#include "Bitbase.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+enum Ending { KQK, KRK, KPK, EndingCount };
+
+// index = stm << 18 | white king << 12 | black king << 6 | piece, squares a1 = 0 ... h8 = 63
+constexpr size_t PositionCount = size_t(1) << 19;
+constexpr size_t WordCount = PositionCount / 64;
+constexpr char FileMagic[8] = { 'C', 'H', 'B', 'B', 'A', 'S', 'E', '1' };
+
+enum State : uint8_t { Unknown, Win, Draw, Invalid };
+
+constexpr int KnownWin = 10000;
+
+size_t index(int stm, int wk, int bk, int sq) {
+    return (size_t(stm) << 18) | (size_t(wk) << 12) | (size_t(bk) << 6) | size_t(sq);
+}
+
+int file_of(int sq) { return sq & 7; }
+int rank_of(int sq) { return sq >> 3; }
+uint64_t bit(int sq) { return uint64_t(1) << sq; }
+
+int distance(int a, int b) {
+    return std::max(std::abs(file_of(a) - file_of(b)), std::abs(rank_of(a) - rank_of(b)));
+}
+
+std::array<uint64_t, 64> king_attacks{};
+
+uint64_t ray_attacks(int sq, uint64_t occupied, bool orthogonal, bool diagonal) {
+    static constexpr int dirs[8][2] = { {1,0}, {-1,0}, {0,1}, {0,-1}, {1,1}, {1,-1}, {-1,1}, {-1,-1} };
+    uint64_t attacks = 0;
+    for (int d = orthogonal ? 0 : 4; d < (diagonal ? 8 : 4); ++d) {
+        int r = rank_of(sq) + dirs[d][0], f = file_of(sq) + dirs[d][1];
+        while (r >= 0 && r < 8 && f >= 0 && f < 8) {
+            attacks |= bit(r * 8 + f);
+            if (occupied & bit(r * 8 + f)) break;
+            r += dirs[d][0];
+            f += dirs[d][1];
+        }
+    }
+    return attacks;
+}
+
+// Squares attacked by the white piece of the ending.
+uint64_t piece_attacks(Ending e, int sq, uint64_t occupied) {
+    switch (e) {
+        case KQK: return ray_attacks(sq, occupied, true, true);
+        case KRK: return ray_attacks(sq, occupied, true, false);
+        case KPK: {
+            uint64_t attacks = 0;
+            if (rank_of(sq) < 7) {
+                if (file_of(sq) > 0) attacks |= bit(sq + 7);
+                if (file_of(sq) < 7) attacks |= bit(sq + 9);
+            }
+            return attacks;
+        }
+        default: return 0;
+    }
+}
+
+struct Tables {
+    std::array<std::vector<uint64_t>, EndingCount> generated;
+    std::array<const uint64_t*, EndingCount> bits{};
+    MappedFile file;
+    std::atomic<bool> ready{false};
+};
+
+Tables tables;
+
+bool probe_bit(Ending e, size_t idx) {
+    return (tables.bits[e][idx >> 6] >> (idx & 63)) & 1;
+}
+
+uint8_t initial_state(Ending e, size_t idx) {
+    int stm = int(idx >> 18), wk = int(idx >> 12) & 63, bk = int(idx >> 6) & 63, sq = int(idx & 63);
+    if (wk == bk || sq == wk || sq == bk || distance(wk, bk) <= 1) return Invalid;
+    if (e == KPK && (rank_of(sq) == 0 || rank_of(sq) == 7)) return Invalid;
+    // The side not to move can't be in check.
+    if (stm == 0 && (piece_attacks(e, sq, bit(wk) | bit(bk)) & bit(bk))) return Invalid;
+    return Unknown;
+}
+
+// One retrograde step: a position is won once white has a move to a won
+// position, or black only has moves to won positions.
+uint8_t classify(Ending e, size_t idx, const std::vector<std::atomic<uint8_t>>& state) {
+    int stm = int(idx >> 18), wk = int(idx >> 12) & 63, bk = int(idx >> 6) & 63, sq = int(idx & 63);
+    auto is_win = [&](size_t i) { return state[i].load(std::memory_order_relaxed) == Win; };
+
+    if (stm == 0) {
+        for (uint64_t b = king_attacks[wk] & ~king_attacks[bk] & ~bit(sq); b; b &= b - 1) {
+            if (is_win(index(1, std::countr_zero(b), bk, sq))) return Win;
+        }
+        if (e == KPK) {
+            int to = sq + 8;
+            if (to == wk || to == bk) return Unknown;
+            if (rank_of(to) == 7) {
+                // Promotion continues in the finished queen and rook bitbases.
+                if (probe_bit(KQK, index(1, wk, bk, to)) || probe_bit(KRK, index(1, wk, bk, to))) return Win;
+                return Unknown;
+            }
+            if (is_win(index(1, wk, bk, to))) return Win;
+            if (rank_of(sq) == 1 && to + 8 != wk && to + 8 != bk && is_win(index(1, wk, bk, to + 8))) return Win;
+        } else {
+            for (uint64_t b = piece_attacks(e, sq, bit(wk) | bit(bk)) & ~bit(wk) & ~bit(bk); b; b &= b - 1) {
+                if (is_win(index(1, wk, bk, std::countr_zero(b)))) return Win;
+            }
+        }
+        return Unknown;
+    }
+
+    uint64_t attacked = king_attacks[wk] | piece_attacks(e, sq, bit(wk));
+    bool in_check = piece_attacks(e, sq, bit(wk) | bit(bk)) & bit(bk);
+    bool has_move = false;
+    for (uint64_t b = king_attacks[bk] & ~attacked; b; b &= b - 1) {
+        int to = std::countr_zero(b);
+        if (to == sq) return Draw; // undefended piece is captured
+        has_move = true;
+        if (!is_win(index(0, wk, to, sq))) return Unknown;
+    }
+    if (!has_move) return in_check ? Win : Draw;
+    return Win;
+}
+
+std::vector<uint64_t> build(Ending e, int threads) {
+    std::vector<std::atomic<uint8_t>> state(PositionCount);
+    for (size_t i = 0; i < PositionCount; ++i) state[i].store(initial_state(e, i), std::memory_order_relaxed);
+
+    // Iterate to a fixed point. Positions only ever move from Unknown to a
+    // final state, so workers may see each other's updates within a pass.
+    std::atomic<bool> changed{true};
+    while (changed.load()) {
+        changed = false;
+        std::atomic<size_t> next_chunk{0};
+        constexpr size_t ChunkSize = 4096;
+        auto worker = [&] {
+            bool local_change = false;
+            for (size_t begin; (begin = next_chunk.fetch_add(ChunkSize)) < PositionCount;) {
+                for (size_t i = begin; i < begin + ChunkSize; ++i) {
+                    if (state[i].load(std::memory_order_relaxed) != Unknown) continue;
+                    uint8_t s = classify(e, i, state);
+                    if (s != Unknown) {
+                        state[i].store(s, std::memory_order_relaxed);
+                        local_change = true;
+                    }
+                }
+            }
+            if (local_change) changed = true;
+        };
+        std::vector<std::jthread> pool;
+        for (int t = 0; t < threads; ++t) pool.emplace_back(worker);
+    }
+
+    std::vector<uint64_t> bits(WordCount, 0);
+    for (size_t i = 0; i < PositionCount; ++i) {
+        if (state[i].load(std::memory_order_relaxed) == Win) bits[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+    return bits;
+}
+
+void init_attacks() {
+    for (int sq = 0; sq < 64; ++sq) {
+        uint64_t b = 0;
+        for (int dr = -1; dr <= 1; ++dr)
+            for (int df = -1; df <= 1; ++df) {
+                int r = rank_of(sq) + dr, f = file_of(sq) + df;
+                if ((dr || df) && r >= 0 && r < 8 && f >= 0 && f < 8) b |= bit(r * 8 + f);
+            }
+        king_attacks[sq] = b;
+    }
+}
+
+// Progress terms inside a won ending so the search makes headway.
+int win_bonus(Ending e, int wk, int bk, int sq) {
+    if (e == KPK) return 20 * rank_of(sq) - distance(wk, sq);
+    int edge = std::min({ file_of(bk), 7 - file_of(bk), rank_of(bk), 7 - rank_of(bk) });
+    return 20 * (3 - edge) + 10 * (7 - distance(wk, bk));
+}
+
+} // namespace
+
+void bitbase_generate(int threads) {
+    threads = std::max(threads, 1);
+    init_attacks();
+    tables.ready = false;
+    // KPK looks up promotions in the finished queen and rook bitbases.
+    for (Ending e : { KQK, KRK, KPK }) {
+        tables.generated[e] = build(e, threads);
+        tables.bits[e] = tables.generated[e].data();
+    }
+    tables.file.close();
+    tables.ready = true;
+}
+
+bool bitbase_save(const std::string& path) {
+    if (!tables.ready) return false;
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    out.write(FileMagic, sizeof(FileMagic));
+    for (int e = 0; e < EndingCount; ++e) {
+        out.write(reinterpret_cast<const char*>(tables.bits[e]), WordCount * sizeof(uint64_t));
+    }
+    return static_cast<bool>(out);
+}
+
+bool bitbase_load(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path) || file.size() != sizeof(FileMagic) + EndingCount * WordCount * sizeof(uint64_t) ||
+        std::memcmp(file.data(), FileMagic, sizeof(FileMagic)) != 0)
+        return false;
+
+    init_attacks();
+    tables.ready = false;
+    tables.file = std::move(file);
+    for (int e = 0; e < EndingCount; ++e) {
+        tables.generated[e].clear();
+        tables.bits[e] = reinterpret_cast<const uint64_t*>(tables.file.data() + sizeof(FileMagic)) + e * WordCount;
+    }
+    tables.ready = true;
+    return true;
+}
+
+bool bitbase_ready() {
+    return tables.ready.load(std::memory_order_acquire);
+}
+
+std::optional<int> bitbase_eval(const Board& board, Color perspective) {
+    if (!bitbase_ready()) return std::nullopt;
+
+    int kings[2] = { -1, -1 };
+    int piece_sq = -1;
+    Color strong = Color::White;
+    Ending ending = EndingCount;
+    for (int rank = 0; rank < Board::Size; ++rank) {
+        for (int file = 0; file < Board::Size; ++file) {
+            const auto& p = board.at(rank, file);
+            if (!p) continue;
+            int sq = rank * 8 + file;
+            if (p->type == PieceType::King) {
+                kings[p->color == Color::White ? 0 : 1] = sq;
+                continue;
+            }
+            if (piece_sq >= 0) return std::nullopt; // more than one piece besides the kings
+            piece_sq = sq;
+            strong = p->color;
+            if (p->type == PieceType::Queen) ending = KQK;
+            else if (p->type == PieceType::Rook) ending = KRK;
+            else if (p->type == PieceType::Pawn) ending = KPK;
+            else return std::nullopt;
+        }
+    }
+    if (piece_sq < 0 || kings[0] < 0 || kings[1] < 0) return std::nullopt;
+
+    // Normalise so the stronger side is white and pawns move up the board.
+    int flip = strong == Color::White ? 0 : 56;
+    int wk = kings[strong == Color::White ? 0 : 1] ^ flip;
+    int bk = kings[strong == Color::White ? 1 : 0] ^ flip;
+    int sq = piece_sq ^ flip;
+    int stm = board.get_side_to_move() == strong ? 0 : 1;
+
+    if (!probe_bit(ending, index(stm, wk, bk, sq))) return 0;
+    int score = KnownWin + win_bonus(ending, wk, bk, sq);
+    return perspective == strong ? score : -score;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <thread>
+#include "Board.h"
+
+// Win/draw bitbases for KPK, KRK and KQK built by retrograde analysis. Each
+// ending stores one bit per (side to move, white king, black king, piece)
+// with the piece owner normalised to white: set means the stronger side wins.
+
+// Generates all three bitbases using `threads` workers.
+void bitbase_generate(int threads = std::thread::hardware_concurrency());
+
+// Writes the generated bitbases to `path` / maps them from a file written
+// earlier. Loading keeps the mapping open; pages are read on first probe.
+bool bitbase_save(const std::string& path);
+bool bitbase_load(const std::string& path);
+
+bool bitbase_ready();
+
+// Exact score of a three-piece position covered by a bitbase, from the point
+// of view of `perspective`: 0 for a draw, a known-win score otherwise.
+// Returns nullopt for any other material or before the bitbases are ready.
+std::optional<int> bitbase_eval(const Board& board, Color perspective);
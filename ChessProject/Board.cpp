@@ -1,8 +1,10 @@
 ﻿#include "Board.h"
+#include "Fen.h"
 #include <format>
-#include <sstream>
+#include <string_view>
 #include <string>
 #include <cctype>
+#include <algorithm>
 
 Board::Board() {
     setup_initial_position();
@@ -10,6 +12,12 @@ Board::Board() {
 
 void Board::setup_initial_position() {
     clear_board();
+    side_to_move_ = Color::White;
+    en_passant_target = std::nullopt;
+    halfmove_clock_ = 0;
+    fullmove_number_ = 1;
+    white_kingside_castle = white_queenside_castle = true;
+    black_kingside_castle = black_queenside_castle = true;
     for (int file = 0; file < Size; ++file) {
         squares_[1][file] = Piece{ PieceType::Pawn, Color::White };
         squares_[6][file] = Piece{ PieceType::Pawn, Color::Black };
@@ -74,111 +82,49 @@ std::string Board::to_string() const {
     return result;
 }
 
-std::string Board::to_vt100_unicode_string() const {
-    static const wchar_t* unicode_pieces[2][6] = {
-        {L"♙", L"♘", L"♗", L"♖", L"♕", L"♔"},
-        {L"♟", L"♞", L"♝", L"♜", L"♛", L"♚"}
+const char* piece_glyph(const Piece& piece) {
+    // U+2654..U+265F spelled out as UTF-8 so the narrow literals survive any
+    // execution character set.
+    static const char* const glyphs[2][6] = {
+        {"\xE2\x99\x99", "\xE2\x99\x98", "\xE2\x99\x97", "\xE2\x99\x96", "\xE2\x99\x95", "\xE2\x99\x94"},
+        {"\xE2\x99\x9F", "\xE2\x99\x9E", "\xE2\x99\x9D", "\xE2\x99\x9C", "\xE2\x99\x9B", "\xE2\x99\x9A"}
     };
-    static const char* bg_light = "\033[48;5;230m";
-    static const char* bg_dark  = "\033[48;5;101m";
-    static const char* reset    = "\033[0m";
+    return glyphs[static_cast<int>(piece.color)][static_cast<int>(piece.type)];
+}
+
+std::string Board::to_vt100_unicode_string() const {
+    static constexpr std::string_view bg_light = "\033[48;5;230m";
+    static constexpr std::string_view bg_dark  = "\033[48;5;101m";
+    static constexpr std::string_view reset    = "\033[0m";
 
-    std::ostringstream oss;
+    std::string result;
+    result.reserve(Size * (Size * 20 + 1));
     for (int rank = Size - 1; rank >= 0; --rank) {
         for (int file = 0; file < Size; ++file) {
             bool is_light = (rank + file) % 2 == 0;
-            oss << (is_light ? bg_light : bg_dark);
+            result += is_light ? bg_light : bg_dark;
 
             const auto& sq = squares_[rank][file];
             if (!sq) {
-                oss << "  ";
+                result += "  ";
             } else {
-                int color_idx = (sq->color == Color::White) ? 0 : 1;
-                int type_idx = static_cast<int>(sq->type);
-                std::wstring ws(unicode_pieces[color_idx][type_idx]);
-                std::string utf8(ws.begin(), ws.end());
-                oss << utf8 << " ";
+                result += piece_glyph(*sq);
+                result += ' ';
             }
-            oss << reset;
+            result += reset;
         }
-        oss << "\n";
+        result += '\n';
     }
-    return oss.str();
+    return result;
 }
 
-bool Board::set_fen(const std::string& fen) {
-    clear_board();
-    std::istringstream iss(fen);
-    std::string board_part, active_color, castling, ep_square;
-    if (!(iss >> board_part >> active_color >> castling >> ep_square)) return false;
-
-    int rank = 7, file = 0;
-    for (char c : board_part) {
-        if (c == '/') {
-            --rank;
-            file = 0;
-        }
-        else if (std::isdigit(c)) {
-            file += c - '0';
-        }
-        else {
-            Color color = std::isupper(c) ? Color::White : Color::Black;
-            PieceType type;
-            switch (std::tolower(c)) {
-            case 'p': type = PieceType::Pawn; break;
-            case 'n': type = PieceType::Knight; break;
-            case 'b': type = PieceType::Bishop; break;
-            case 'r': type = PieceType::Rook; break;
-            case 'q': type = PieceType::Queen; break;
-            case 'k': type = PieceType::King; break;
-            default: return false;
-            }
-            set_piece(rank, file, type, color);
-            ++file;
-        }
-    }
-
-    white_kingside_castle = false;
-    white_queenside_castle = false;
-    black_kingside_castle = false;
-    black_queenside_castle = false;
-
-    if (castling.find('K') != std::string::npos &&
-        squares_[0][4] && squares_[0][4]->type == PieceType::King && squares_[0][4]->color == Color::White &&
-        squares_[0][7] && squares_[0][7]->type == PieceType::Rook && squares_[0][7]->color == Color::White) {
-        white_kingside_castle = true;
-    }
-    if (castling.find('Q') != std::string::npos &&
-        squares_[0][4] && squares_[0][4]->type == PieceType::King && squares_[0][4]->color == Color::White &&
-        squares_[0][0] && squares_[0][0]->type == PieceType::Rook && squares_[0][0]->color == Color::White) {
-        white_queenside_castle = true;
-    }
-    if (castling.find('k') != std::string::npos &&
-        squares_[7][4] && squares_[7][4]->type == PieceType::King && squares_[7][4]->color == Color::Black &&
-        squares_[7][7] && squares_[7][7]->type == PieceType::Rook && squares_[7][7]->color == Color::Black) {
-        black_kingside_castle = true;
-    }
-    if (castling.find('q') != std::string::npos &&
-        squares_[7][4] && squares_[7][4]->type == PieceType::King && squares_[7][4]->color == Color::Black &&
-        squares_[7][0] && squares_[7][0]->type == PieceType::Rook && squares_[7][0]->color == Color::Black) {
-        black_queenside_castle = true;
-    }
-
-    if (ep_square == "-") {
-        en_passant_target = std::nullopt;
-    }
-    else if (ep_square.size() == 2) {
-        int file = ep_square[0] - 'a';
-        int rank = ep_square[1] - '1';
-        if (file >= 0 && file < Size && rank >= 0 && rank < Size) {
-            en_passant_target = std::make_pair(rank, file);
-        }
-        else {
-            en_passant_target = std::nullopt;
-        }
-    }
+bool Board::set_fen(std::string_view fen) {
+    return parse_fen(fen, *this).has_value();
+}
 
-    return true;
+std::string Board::to_fen() const {
+    char buffer[MaxFenLength];
+    return std::string(buffer, write_fen(*this, buffer));
 }
 
 void Board::update_castling_rights() {
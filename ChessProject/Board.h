@@ -2,11 +2,16 @@
 #include <array>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <compare>
 
 enum class PieceType { Pawn, Knight, Bishop, Rook, Queen, King };
 enum class Color { White, Black };
 
+constexpr Color opponent(Color color) {
+    return color == Color::White ? Color::Black : Color::White;
+}
+
 struct Piece {
     PieceType type;
     Color color;
@@ -14,6 +19,9 @@ struct Piece {
     auto operator<=>(const Piece&) const = default;
 };
 
+// UTF-8 chess symbol of a piece, e.g. "\xE2\x99\x94" (U+2654) for the white king.
+const char* piece_glyph(const Piece& piece);
+
 class Board {
 public:
     static constexpr int Size = 8;
@@ -34,12 +42,22 @@ public:
     void clear_board();
     void set_piece(int rank, int file, PieceType type, Color color);
 
-    // FEN support
-    bool set_fen(const std::string& fen);
+    // FEN support, as parse_fen and write_fen in Fen.h with lenient parsing
+    bool set_fen(std::string_view fen);
+    std::string to_fen() const;
 
     const std::optional<std::pair<int, int>>& get_en_passant_target() const { return en_passant_target; }
     void set_en_passant_target(const std::optional<std::pair<int, int>>& ep) { en_passant_target = ep; }
 
+    Color get_side_to_move() const { return side_to_move_; }
+    void set_side_to_move(Color c) { side_to_move_ = c; }
+
+    // Plies since the last capture or pawn move, and the FEN move number
+    int get_halfmove_clock() const { return halfmove_clock_; }
+    void set_halfmove_clock(int plies) { halfmove_clock_ = plies; }
+    int get_fullmove_number() const { return fullmove_number_; }
+    void set_fullmove_number(int number) { fullmove_number_ = number; }
+
     void update_castling_rights();
 
     bool white_kingside_castle = true;
@@ -52,4 +70,7 @@ public:
 private:
     BoardArray squares_;
     std::optional<std::pair<int, int>> en_passant_target;
+    Color side_to_move_ = Color::White;
+    int halfmove_clock_ = 0;
+    int fullmove_number_ = 1;
 };
\ No newline at end of file
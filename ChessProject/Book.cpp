@@ -0,0 +1,99 @@
+#include "Book.h"
+#include "Zobrist.h"
+
+namespace {
+
+// Polyglot entries are 16 big-endian bytes: key(8) move(2) weight(2) learn(4).
+constexpr size_t entry_size = 16;
+
+uint64_t read_be(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v = (v << 8) | p[i];
+    return v;
+}
+
+// Polyglot move: to file 0-2, to rank 3-5, from file 6-8, from rank 9-11, promotion 12-14.
+// Castling is stored as king-takes-own-rook.
+Move decode_move(const Board& board, uint16_t m) {
+    int to_file = m & 7, to_rank = (m >> 3) & 7;
+    int from_file = (m >> 6) & 7, from_rank = (m >> 9) & 7;
+    int promo = (m >> 12) & 7;
+
+    const auto& piece = board.at(from_rank, from_file);
+    const auto& target = board.at(to_rank, to_file);
+
+    if (promo) {
+        static constexpr PieceType promo_types[] = { PieceType::Knight, PieceType::Bishop, PieceType::Rook, PieceType::Queen };
+        return Move(from_rank, from_file, to_rank, to_file, MoveType::Promotion, promo_types[(promo - 1) & 3]);
+    }
+    if (piece && piece->type == PieceType::King && from_file == 4 && from_rank == to_rank &&
+        target && target->type == PieceType::Rook && target->color == piece->color) {
+        return Move(from_rank, from_file, to_rank, to_file == 7 ? 6 : 2, MoveType::Castling);
+    }
+    if (piece && piece->type == PieceType::Pawn && from_file != to_file && !target) {
+        return Move(from_rank, from_file, to_rank, to_file, MoveType::EnPassant);
+    }
+    return Move(from_rank, from_file, to_rank, to_file, target ? MoveType::Capture : MoveType::Normal);
+}
+
+} // namespace
+
+bool OpeningBook::open(const std::string& path) {
+    close();
+    if (!file_.open(path)) return false;
+    entries_ = file_.size() / entry_size;
+    return entries_ > 0;
+}
+
+void OpeningBook::close() {
+    file_.close();
+    entries_ = 0;
+}
+
+uint64_t OpeningBook::key_at(size_t idx) const {
+    return read_be(file_.data() + idx * entry_size, 8);
+}
+
+uint16_t OpeningBook::move_at(size_t idx) const {
+    return static_cast<uint16_t>(read_be(file_.data() + idx * entry_size + 8, 2));
+}
+
+uint16_t OpeningBook::weight_at(size_t idx) const {
+    return static_cast<uint16_t>(read_be(file_.data() + idx * entry_size + 10, 2));
+}
+
+std::optional<Move> OpeningBook::probe(const Board& board, Pick pick) {
+    if (!is_open()) return std::nullopt;
+    uint64_t key = zobrist_key(board);
+
+    // Lower bound: entries are sorted by key.
+    size_t lo = 0, hi = entries_;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (key_at(mid) < key) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == entries_ || key_at(lo) != key) return std::nullopt;
+
+    size_t end = lo;
+    uint64_t total_weight = 0;
+    size_t best = lo;
+    while (end < entries_ && key_at(end) == key) {
+        total_weight += weight_at(end);
+        if (weight_at(end) > weight_at(best)) best = end;
+        ++end;
+    }
+
+    size_t chosen = best;
+    if (pick == Pick::Weighted && total_weight > 0) {
+        uint64_t r = std::uniform_int_distribution<uint64_t>(0, total_weight - 1)(rng_);
+        for (size_t i = lo; i < end; ++i) {
+            if (r < weight_at(i)) {
+                chosen = i;
+                break;
+            }
+            r -= weight_at(i);
+        }
+    }
+    return decode_move(board, move_at(chosen));
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <optional>
+#include <random>
+#include <string>
+#include "Board.h"
+#include "Move.h"
+#include "MappedFile.h"
+
+// Polyglot (.bin) opening book. The file is memory-mapped and probed with a
+// binary search on the Zobrist key; probing does not allocate.
+class OpeningBook {
+public:
+    enum class Pick { Best, Weighted };
+
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return file_.is_open(); }
+    size_t entry_count() const { return entries_; }
+
+    // Book move for the position, or nullopt when it is out of book.
+    std::optional<Move> probe(const Board& board, Pick pick = Pick::Weighted);
+
+private:
+    MappedFile file_;
+    size_t entries_ = 0;
+    std::mt19937_64 rng_{std::random_device{}()};
+
+    uint64_t key_at(size_t idx) const;
+    uint16_t move_at(size_t idx) const;
+    uint16_t weight_at(size_t idx) const;
+};
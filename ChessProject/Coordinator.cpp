@@ -0,0 +1,516 @@
+#include "Coordinator.h"
+#include "Json.h"
+#include "MoveGen.h"
+#include "UciEngine.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <print>
+#include <sstream>
+#include <thread>
+#include "Socket.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A worker engine speaking the serve protocol, one JSON object per line.
+class WorkerLink {
+public:
+    virtual ~WorkerLink() = default;
+    virtual bool send(const std::string& line) = 0;
+    // Next line, or nullopt on timeout or once the worker is gone.
+    virtual std::optional<std::string> read_line(std::chrono::milliseconds timeout) = 0;
+    virtual bool gone() const = 0;
+    // Drops a failed worker: a child process is killed and reaped, a
+    // connection is closed.
+    virtual void close() = 0;
+};
+
+class ProcessLink : public WorkerLink {
+public:
+    bool launch(const std::string& command) { return process_.launch(command); }
+
+    bool send(const std::string& line) override {
+        process_.send(line);
+        return !gone();
+    }
+    std::optional<std::string> read_line(std::chrono::milliseconds timeout) override { return process_.read_line(timeout); }
+    bool gone() const override { return process_.exited() || !process_.is_running(); }
+    void close() override { process_.kill(); }
+
+private:
+    UciEngine process_;
+};
+
+class SocketLink : public WorkerLink {
+public:
+    explicit SocketLink(Socket socket) : socket_(socket) {}
+    ~SocketLink() override { close(); }
+
+    bool send(const std::string& line) override {
+        if (gone_ || !send_all(socket_, line + '\n')) gone_ = true;
+        return !gone_;
+    }
+
+    std::optional<std::string> read_line(std::chrono::milliseconds timeout) override {
+        auto deadline = Clock::now() + timeout;
+        while (!gone_) {
+            if (auto pos = buffer_.find('\n'); pos != std::string::npos) {
+                std::string line = buffer_.substr(0, pos);
+                buffer_.erase(0, pos + 1);
+                if (line.ends_with('\r')) line.pop_back();
+                return line;
+            }
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (left <= 0) break;
+            pollfd fd{ socket_, POLLIN, 0 };
+            if (poll_sockets(&fd, 1, static_cast<int>(left)) <= 0) continue;
+            char chunk[4096];
+            auto n = recv(socket_, chunk, static_cast<int>(sizeof(chunk)), 0);
+            if (n <= 0) gone_ = true;
+            else buffer_.append(chunk, static_cast<size_t>(n));
+        }
+        return std::nullopt;
+    }
+
+    bool gone() const override { return gone_; }
+    void close() override {
+        if (socket_ != InvalidSocket) close_socket(socket_);
+        socket_ = InvalidSocket;
+        gone_ = true;
+    }
+
+private:
+    Socket socket_;
+    std::string buffer_;
+    bool gone_ = false;
+};
+
+std::unique_ptr<WorkerLink> open_link(const std::string& spec) {
+    if (spec.starts_with("cmd=")) {
+        auto link = std::make_unique<ProcessLink>();
+        if (!link->launch(spec.substr(4))) return nullptr;
+        return link;
+    }
+    Socket socket = connect_socket(spec);
+    if (socket == InvalidSocket) return nullptr;
+    return std::make_unique<SocketLink>(socket);
+}
+
+struct Job {
+    std::string request;  // the fields of the request after its id
+    uint64_t line_no = 0;
+    std::string fen;
+};
+
+// Shares the jobs between the workers. Each worker starts with a contiguous
+// shard and takes from its front; an idle worker steals the back half of the
+// largest shard. Jobs of a failed worker go to the front of the smallest
+// live shard, so the results the writer waits on come back first.
+class Dispatcher {
+public:
+    Dispatcher(size_t jobs, size_t workers, int retries)
+        : shards_(workers), alive_(workers, true), attempts_(jobs, 0), results_(jobs), retries_(retries),
+          remaining_(jobs), live_workers_(workers) {
+        for (size_t w = 0; w < workers; ++w) {
+            for (size_t job = jobs * w / workers; job < jobs * (w + 1) / workers; ++job) shards_[w].push_back(job);
+        }
+    }
+
+    // Next job for `worker`. With `wait`, blocks while the other workers
+    // still run jobs that may come back; nullopt once there is nothing left.
+    std::optional<size_t> take(size_t worker, bool wait) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            auto& own = shards_[worker];
+            if (!own.empty()) {
+                size_t job = own.front();
+                own.pop_front();
+                return job;
+            }
+            if (steal(worker)) continue;
+            if (!wait || remaining_ == 0) return std::nullopt;
+            changed_.wait(lock);
+        }
+    }
+
+    void complete(size_t job, std::string result) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (results_[job]) return;
+            results_[job] = std::move(result);
+            --remaining_;
+        }
+        changed_.notify_all();
+    }
+
+    // The worker is gone; its jobs in flight are retried elsewhere. When no
+    // worker is left the remaining jobs fail.
+    void fail_worker(size_t worker, const std::vector<size_t>& in_flight) {
+        std::vector<size_t> failed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            alive_[worker] = false;
+            --live_workers_;
+            for (size_t job : in_flight) {
+                if (results_[job]) continue;
+                if (++attempts_[job] > retries_ || live_workers_ == 0) {
+                    failed.push_back(job);
+                    continue;
+                }
+                ++retried_;
+                size_t target = worker;
+                for (size_t w = 0; w < shards_.size(); ++w) {
+                    if (alive_[w] && (!alive_[target] || shards_[w].size() < shards_[target].size())) target = w;
+                }
+                shards_[target].push_front(job);
+            }
+            if (live_workers_ == 0) {
+                for (auto& shard : shards_) {
+                    failed.insert(failed.end(), shard.begin(), shard.end());
+                    shard.clear();
+                }
+            }
+        }
+        changed_.notify_all();
+        for (size_t job : failed) complete(job, "\"error\":\"worker failed\"}");
+    }
+
+    // Blocks until the job has a result.
+    const std::string& result(size_t job) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&] { return results_[job].has_value(); });
+        return *results_[job];
+    }
+
+    size_t steals() const { return steals_; }
+    size_t retried() const { return retried_; }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<std::deque<size_t>> shards_;
+    std::vector<bool> alive_;
+    std::vector<int> attempts_;
+    std::vector<std::optional<std::string>> results_;
+    int retries_;
+    size_t remaining_;
+    size_t live_workers_;
+    size_t steals_ = 0;
+    size_t retried_ = 0;
+
+    bool steal(size_t worker) {
+        size_t victim = worker;
+        for (size_t w = 0; w < shards_.size(); ++w) {
+            if (shards_[w].size() > shards_[victim].size()) victim = w;
+        }
+        auto& from = shards_[victim];
+        if (from.empty()) return false;
+        size_t count = (from.size() + 1) / 2;
+        shards_[worker].insert(shards_[worker].end(), from.end() - count, from.end());
+        from.erase(from.end() - count, from.end());
+        ++steals_;
+        return true;
+    }
+};
+
+// Sends jobs to one worker, keeping up to `inflight` of them outstanding,
+// until there are none left or the worker fails.
+void drive_worker(size_t index, WorkerLink& link, Dispatcher& dispatcher, const std::vector<Job>& jobs,
+                  const CoordinatorOptions& options) {
+    std::vector<size_t> in_flight;
+    auto last_answer = Clock::now();
+    while (true) {
+        while (in_flight.size() < static_cast<size_t>(options.inflight)) {
+            auto job = dispatcher.take(index, in_flight.empty());
+            if (!job) break;
+            if (in_flight.empty()) last_answer = Clock::now();
+            in_flight.push_back(*job);
+            if (!link.send(std::format("{{\"id\":{},{}", *job, jobs[*job].request))) break;
+        }
+        if (in_flight.empty()) return;
+
+        auto line = link.read_line(std::chrono::milliseconds(100));
+        if (!line) {
+            bool silent = options.timeout_ms > 0 &&
+                          Clock::now() - last_answer > std::chrono::milliseconds(options.timeout_ms);
+            if (link.gone() || silent) {
+                std::println(stderr, "Worker {} {}, resending {} jobs", options.workers[index],
+                             silent ? "timed out" : "failed", in_flight.size());
+                dispatcher.fail_worker(index, in_flight);
+                link.close();
+                return;
+            }
+            continue;
+        }
+        // Answers start with the id the job was sent with: {"id":12,...
+        constexpr std::string_view prefix = "{\"id\":";
+        if (!line->starts_with(prefix)) continue;
+        size_t job = 0;
+        auto [end, ec] = std::from_chars(line->data() + prefix.size(), line->data() + line->size(), job);
+        if (ec != std::errc() || *end != ',') continue;
+        auto it = std::find(in_flight.begin(), in_flight.end(), job);
+        if (it == in_flight.end()) continue;
+        in_flight.erase(it);
+        last_answer = Clock::now();
+        dispatcher.complete(job, line->substr(end + 1 - line->data()));
+    }
+}
+
+std::string limits_fields(const SearchLimits& limits, int depth) {
+    std::string fields = std::format("\"depth\":{}", depth);
+    if (limits.nodes) fields += std::format(",\"nodes\":{}", limits.nodes);
+    if (limits.movetime_ms) fields += std::format(",\"movetime\":{}", limits.movetime_ms);
+    return fields;
+}
+
+std::string moves_field(const std::vector<std::string>& moves) {
+    std::string field = "\"moves\":[";
+    for (size_t i = 0; i < moves.size(); ++i) field += std::format("{}\"{}\"", i ? "," : "", json_escape(moves[i]));
+    return field + "]";
+}
+
+// One job per position of the input file.
+std::optional<std::vector<Job>> position_jobs(const CoordinatorOptions& options) {
+    std::ifstream file;
+    if (options.input_path != "-") {
+        file.open(options.input_path);
+        if (!file) {
+            std::println(stderr, "Cannot open {}", options.input_path);
+            return std::nullopt;
+        }
+    }
+    std::istream& in = options.input_path == "-" ? std::cin : file;
+
+    std::string limits = limits_fields(options.limits, options.limits.depth);
+    if (options.multi_pv > 1) limits += std::format(",\"multipv\":{}", options.multi_pv);
+    std::vector<Job> jobs;
+    std::string line;
+    uint64_t line_no = 0;
+    while (std::getline(in, line)) {
+        ++line_no;
+        auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        std::istringstream iss(line);
+        std::string fields[4];
+        for (auto& field : fields) iss >> field;
+        std::string fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+        jobs.push_back({ std::format("\"fen\":\"{}\",{}}}", json_escape(fen), limits), line_no, fen });
+    }
+    return jobs;
+}
+
+// One job per root move: the position after it, one ply shallower.
+std::optional<std::vector<Job>> root_jobs(const CoordinatorOptions& options, const Board& root, std::vector<Move>& moves) {
+    auto legal = generate_legal_moves(&root, root.get_side_to_move());
+    if (!legal || legal->empty()) {
+        std::println(stderr, "No legal moves in the root position");
+        return std::nullopt;
+    }
+    moves = std::move(*legal);
+    std::string fen = options.fen == "startpos" ? "startpos" : json_escape(options.fen);
+    std::string limits = limits_fields(options.limits, options.limits.depth - 1);
+    std::vector<Job> jobs;
+    for (const Move& move : moves) {
+        std::vector<std::string> line = options.moves;
+        line.push_back(uci_move(root, move));
+        jobs.push_back({ std::format("\"fen\":\"{}\",{},{}}}", fen, moves_field(line), limits), 0, {} });
+    }
+    return jobs;
+}
+
+// Ranks the root moves from the answers for the positions after them.
+void write_root_results(std::ostream& out, const Board& root, const std::vector<Move>& moves, Dispatcher& dispatcher,
+                        int depth, double elapsed_ms) {
+    struct Ranked {
+        int score;
+        std::string move;
+        uint64_t nodes;
+        std::vector<std::string> pv;
+    };
+    std::vector<Ranked> ranked;
+    uint64_t total_nodes = 0;
+    Color root_side = root.get_side_to_move();
+    for (size_t i = 0; i < moves.size(); ++i) {
+        std::string move = uci_move(root, moves[i]);
+        auto answer = parse_json_object("{" + dispatcher.result(i));
+        auto field = [&](std::string_view key) -> const JsonValue* {
+            if (!answer) return nullptr;
+            auto it = answer->find(key);
+            return it == answer->end() ? nullptr : &it->second;
+        };
+        if (const JsonValue* error = field("error")) {
+            out << std::format("{{\"move\":\"{}\",\"error\":\"{}\"}}", move, json_escape(error->string)) << '\n';
+            continue;
+        }
+        Board child = root;
+        apply_move(child, moves[i]);
+        Ranked entry{ 0, move, 0, { move } };
+        const JsonValue* score = field("score");
+        if (!score) {
+            // Mate or stalemate after the move, scored as the search scores a
+            // node without moves.
+            entry.score = evaluate_board(child, root_side);
+        } else {
+            entry.score = -static_cast<int>(score->number);
+            if (const JsonValue* nodes = field("nodes")) entry.nodes = static_cast<uint64_t>(nodes->number);
+            if (const JsonValue* lines = field("lines"); lines && !lines->array.empty() && lines->array[0].object) {
+                if (auto pv = lines->array[0].object->find("pv"); pv != lines->array[0].object->end()) {
+                    for (const JsonValue& reply : pv->second.array) entry.pv.push_back(reply.string);
+                }
+            }
+        }
+        total_nodes += entry.nodes;
+        ranked.push_back(std::move(entry));
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.score > b.score; });
+
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        std::string json = std::format("{{\"rank\":{},\"move\":\"{}\",\"score\":{},\"depth\":{},\"nodes\":{},\"pv\":[",
+                                       i + 1, ranked[i].move, ranked[i].score, depth, ranked[i].nodes);
+        for (size_t ply = 0; ply < ranked[i].pv.size(); ++ply) json += std::format("{}\"{}\"", ply ? "," : "", ranked[i].pv[ply]);
+        out << json << "]}\n";
+    }
+    if (!ranked.empty()) {
+        out << std::format("{{\"bestmove\":\"{}\",\"score\":{},\"depth\":{},\"nodes\":{},\"time_ms\":{:.1f}}}",
+                           ranked.front().move, ranked.front().score, depth, total_nodes, elapsed_ms) << '\n';
+    }
+    out.flush();
+}
+
+} // namespace
+
+std::optional<CoordinatorOptions> parse_coordinator_args(const std::vector<std::string>& args) {
+    CoordinatorOptions options;
+    bool has_depth = false;
+    try {
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if (arg == "--worker" && has_value) options.workers.push_back(args[++i]);
+            else if (arg == "--local" && has_value) options.local = std::max(0, std::stoi(args[++i]));
+            else if (arg == "--local-threads" && has_value) options.local_threads = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--local-hash" && has_value) options.local_hash_mb = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--input" && has_value) options.input_path = args[++i];
+            else if (arg == "--output" && has_value) options.output_path = args[++i];
+            else if (arg == "--fen" && has_value) options.fen = args[++i];
+            else if (arg == "--moves") { while (i + 1 < args.size() && !args[i + 1].starts_with("--")) options.moves.push_back(args[++i]); }
+            else if (arg == "--depth" && has_value) { options.limits.depth = std::stoi(args[++i]); has_depth = true; }
+            else if (arg == "--nodes" && has_value) options.limits.nodes = std::stoull(args[++i]);
+            else if (arg == "--movetime" && has_value) options.limits.movetime_ms = std::stoll(args[++i]);
+            else if (arg == "--multipv" && has_value) options.multi_pv = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--inflight" && has_value) options.inflight = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--retries" && has_value) options.retries = std::max(0, std::stoi(args[++i]));
+            else if (arg == "--timeout" && has_value) options.timeout_ms = std::max<int64_t>(0, std::stoll(args[++i]));
+            else return std::nullopt;
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    if (options.input_path.empty() == options.fen.empty()) return std::nullopt;
+    if (options.workers.empty() && options.local == 0) return std::nullopt;
+    if (!options.fen.empty()) {
+        // Every root move is searched to the same depth, as MoveSelector does.
+        if (options.limits.nodes || options.limits.movetime_ms || options.limits.depth < 2) return std::nullopt;
+    } else if (!has_depth && (options.limits.nodes || options.limits.movetime_ms)) {
+        options.limits.depth = SearchLimits::MaxDepth;
+    }
+    return options;
+}
+
+int run_coordinator(const CoordinatorOptions& options) {
+    Board root;
+    std::vector<Move> root_moves;
+    std::optional<std::vector<Job>> jobs;
+    if (options.fen.empty()) {
+        jobs = position_jobs(options);
+    } else {
+        if (options.fen == "startpos") root.setup_initial_position();
+        else if (!root.set_fen(options.fen)) {
+            std::println(stderr, "Invalid FEN {}", options.fen);
+            return 1;
+        }
+        for (const std::string& text : options.moves) {
+            auto move = parse_move(root, text);
+            if (!move) {
+                std::println(stderr, "Illegal move {}", text);
+                return 1;
+            }
+            apply_move(root, *move);
+        }
+        jobs = root_jobs(options, root, root_moves);
+    }
+    if (!jobs) return 1;
+
+    std::ofstream out_file;
+    if (!options.output_path.empty()) {
+        out_file.open(options.output_path, std::ios::trunc);
+        if (!out_file) {
+            std::println(stderr, "Cannot write {}", options.output_path);
+            return 1;
+        }
+    }
+    std::ostream& out = options.output_path.empty() ? std::cout : out_file;
+
+    if (!sockets_startup()) {
+        std::println(stderr, "Cannot initialise sockets");
+        return 1;
+    }
+    CoordinatorOptions resolved = options;
+    std::string self = options.self_path.find(' ') == std::string::npos ? options.self_path : "\"" + options.self_path + "\"";
+    for (int i = 0; i < options.local; ++i) {
+        resolved.workers.push_back(std::format("cmd={} serve --stdio --workers {} --hash {}", self, options.local_threads,
+                                               options.local_hash_mb));
+    }
+    std::vector<std::unique_ptr<WorkerLink>> links;
+    std::vector<std::string> names;
+    for (const std::string& spec : resolved.workers) {
+        if (auto link = open_link(spec)) {
+            links.push_back(std::move(link));
+            names.push_back(spec);
+        } else {
+            std::println(stderr, "Cannot reach worker {}", spec);
+        }
+    }
+    if (links.empty()) {
+        sockets_cleanup();
+        return 1;
+    }
+    resolved.workers = names;
+
+    auto start = Clock::now();
+    Dispatcher dispatcher(jobs->size(), links.size(), options.retries);
+    {
+        std::vector<std::jthread> threads;
+        for (size_t i = 0; i < links.size(); ++i) {
+            threads.emplace_back([&, i] { drive_worker(i, *links[i], dispatcher, *jobs, resolved); });
+        }
+        if (options.fen.empty()) {
+            for (size_t i = 0; i < jobs->size(); ++i) {
+                const Job& job = (*jobs)[i];
+                out << std::format("{{\"line\":{},\"fen\":\"{}\",{}", job.line_no, json_escape(job.fen), dispatcher.result(i)) << '\n';
+                out.flush();
+            }
+        } else {
+            for (size_t i = 0; i < jobs->size(); ++i) dispatcher.result(i);
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            write_root_results(out, root, root_moves, dispatcher, options.limits.depth, ms);
+        }
+    }
+    links.clear();
+    sockets_cleanup();
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::println(stderr, "Coordinated {} jobs on {} workers in {:.2f} s ({:.1f} jobs/s), {} steals, {} retried",
+                 jobs->size(), names.size(), seconds, seconds > 0 ? jobs->size() / seconds : 0.0, dispatcher.steals(),
+                 dispatcher.retried());
+    return 0;
+}
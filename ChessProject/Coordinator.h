@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Eval.h"
+
+struct CoordinatorOptions {
+    // Worker engines speaking the serve protocol: "cmd=<command>" runs a
+    // process over pipes (e.g. "cmd=ssh host chess serve --stdio"), and
+    // "unix:/path" or "tcp:host:port" connect to a running "serve".
+    std::vector<std::string> workers;
+    int local = 0;              // extra workers: copies of this executable run with "serve --stdio"
+    int local_threads = 1;      // search threads of each local worker
+    size_t local_hash_mb = 64;
+    std::string self_path;      // this executable, for the local workers
+
+    std::string input_path;     // FEN or EPD per line, one job per position
+    std::string output_path;    // JSON lines in input order, stdout when empty
+    std::string fen;            // or: split the root moves of this position ("startpos" or a FEN)
+    std::vector<std::string> moves;  // played from `fen` before the split
+    SearchLimits limits;
+    int multi_pv = 1;
+
+    int inflight = 2;           // requests outstanding per worker
+    int retries = 2;            // times a job is resent after the worker running it failed
+    int64_t timeout_ms = 0;     // a worker silent this long with work pending is dropped; 0 waits forever
+};
+
+// Parses the arguments following "coordinate" on the command line.
+std::optional<CoordinatorOptions> parse_coordinator_args(const std::vector<std::string>& args);
+
+// Shards the jobs over the workers and writes the merged results. Position
+// sets are split into one contiguous shard per worker; a worker that runs
+// out steals half of the largest remaining shard, and the jobs of a worker
+// that dies or stops answering are sent to another one. Results are written
+// in input order as soon as the ones before them are in.
+//
+// With `fen` set, every root move becomes a job searched to depth - 1 in
+// its own process, the way MoveSelector shares root moves between threads,
+// and the ranked moves are written followed by a summary line.
+int run_coordinator(const CoordinatorOptions& options);
@@ -0,0 +1,131 @@
+#include "CpuFeatures.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#if CHESS_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+#if CHESS_X86
+struct CpuidRegs {
+    uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+};
+
+CpuidRegs cpuid(uint32_t leaf, uint32_t subleaf = 0) {
+    CpuidRegs regs;
+#ifdef _MSC_VER
+    int info[4];
+    __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+    regs = { static_cast<uint32_t>(info[0]), static_cast<uint32_t>(info[1]),
+             static_cast<uint32_t>(info[2]), static_cast<uint32_t>(info[3]) };
+#else
+    __cpuid_count(leaf, subleaf, regs.eax, regs.ebx, regs.ecx, regs.edx);
+#endif
+    return regs;
+}
+
+// Register state the OS saves on context switches (XCR0).
+uint64_t xgetbv0() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+CpuFeatures detect() {
+    CpuFeatures features;
+#if CHESS_X86
+    CpuidRegs vendor = cpuid(0);
+    uint32_t max_leaf = vendor.eax;
+    char name[13] = {};
+    std::memcpy(name, &vendor.ebx, 4);
+    std::memcpy(name + 4, &vendor.edx, 4);
+    std::memcpy(name + 8, &vendor.ecx, 4);
+
+    CpuidRegs basic = cpuid(1);
+    features.popcnt = basic.ecx & (1u << 23);
+    bool os_xsave = basic.ecx & (1u << 27);
+    uint64_t xcr0 = os_xsave ? xgetbv0() : 0;
+    bool ymm_saved = (xcr0 & 0x6) == 0x6;
+    bool zmm_saved = (xcr0 & 0xE6) == 0xE6;
+
+    if (max_leaf >= 7) {
+        CpuidRegs extended = cpuid(7);
+        features.bmi2 = extended.ebx & (1u << 8);
+        features.avx2 = ymm_saved && (extended.ebx & (1u << 5));
+        features.avx512 = zmm_saved && (extended.ebx & (1u << 16)) && (extended.ebx & (1u << 30));
+    }
+    // AMD implements PEXT/PDEP in microcode before family 19h (Zen 3).
+    int family = ((basic.eax >> 8) & 0xF) + ((basic.eax >> 20) & 0xFF);
+    bool amd = std::strcmp(name, "AuthenticAMD") == 0;
+    features.fast_pext = features.bmi2 && !(amd && family < 0x19);
+#endif
+    return features;
+}
+
+std::atomic<KernelVariant> selected_variant{ best_kernel_variant() };
+
+} // namespace
+
+std::string CpuFeatures::to_string() const {
+    std::string text;
+    auto add = [&](bool present, const char* name) {
+        if (!present) return;
+        if (!text.empty()) text += ' ';
+        text += name;
+    };
+    add(popcnt, "popcnt");
+    add(bmi2, fast_pext ? "bmi2" : "bmi2(slow-pext)");
+    add(avx2, "avx2");
+    add(avx512, "avx512");
+    return text.empty() ? "none" : text;
+}
+
+const CpuFeatures& cpu_features() {
+    static const CpuFeatures features = detect();
+    return features;
+}
+
+std::string_view kernel_variant_name(KernelVariant variant) {
+    switch (variant) {
+        case KernelVariant::Avx2: return "avx2";
+        case KernelVariant::Scalar: break;
+    }
+    return "scalar";
+}
+
+std::optional<KernelVariant> parse_kernel_variant(std::string_view name) {
+    if (name == "scalar") return KernelVariant::Scalar;
+    if (name == "avx2") return KernelVariant::Avx2;
+    return std::nullopt;
+}
+
+KernelVariant best_kernel_variant() {
+    return cpu_features().avx2 ? KernelVariant::Avx2 : KernelVariant::Scalar;
+}
+
+KernelVariant kernel_variant() {
+    return selected_variant.load(std::memory_order_relaxed);
+}
+
+bool set_kernel_variant(std::string_view name) {
+    if (name == "auto") {
+        selected_variant.store(best_kernel_variant(), std::memory_order_relaxed);
+        return true;
+    }
+    auto variant = parse_kernel_variant(name);
+    if (!variant || (*variant == KernelVariant::Avx2 && !cpu_features().avx2)) return false;
+    selected_variant.store(*variant, std::memory_order_relaxed);
+    return true;
+}
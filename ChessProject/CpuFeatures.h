@@ -0,0 +1,51 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+
+// CPU feature detection and the choice of kernel variant. One binary runs on
+// every x86-64 host: kernels that need a newer instruction set are compiled
+// for it with CHESS_TARGET_* and only called when the host supports it.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CHESS_X86 1
+#else
+#define CHESS_X86 0
+#endif
+
+// MSVC emits any intrinsic without /arch; GCC and Clang need the target per function.
+#if CHESS_X86 && (defined(__GNUC__) || defined(__clang__))
+#define CHESS_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2,popcnt")))
+#else
+#define CHESS_TARGET_AVX2
+#endif
+
+struct CpuFeatures {
+    bool popcnt = false;
+    bool bmi2 = false;
+    bool fast_pext = false;  // bmi2 without the microcoded PEXT of AMD before Zen 3
+    bool avx2 = false;       // with the OS saving the YMM registers
+    bool avx512 = false;     // AVX-512 F and BW with the OS saving the ZMM registers
+
+    // Space separated list of the detected features, e.g. "popcnt bmi2 avx2".
+    std::string to_string() const;
+};
+
+// Features of the host, detected on first use.
+const CpuFeatures& cpu_features();
+
+enum class KernelVariant { Scalar, Avx2 };
+
+std::string_view kernel_variant_name(KernelVariant variant);
+std::optional<KernelVariant> parse_kernel_variant(std::string_view name);
+
+// The best variant the host supports.
+KernelVariant best_kernel_variant();
+
+// Variant used by the dispatched kernels, best_kernel_variant() by default.
+KernelVariant kernel_variant();
+
+// Forces a variant by name ("scalar", "avx2") or returns to the detected one
+// with "auto". Returns false, leaving the choice unchanged, for an unknown
+// name or a variant the host cannot run.
+bool set_kernel_variant(std::string_view name);
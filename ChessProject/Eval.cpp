@@ -1,7 +1,15 @@
 #include "Eval.h"
 #include "MoveGen.h"
+#include "Attacks.h"
+#include "Bitbase.h"
+#include "Memory.h"
 #include "Move.h"
+#include "SearchStats.h"
+#include "Syzygy.h"
+#include "TranspositionTable.h"
+#include "Zobrist.h"
 #include <algorithm>
+#include <chrono>
 #include <stdexcept>
 #include <future>
 #include <thread>
@@ -11,10 +19,12 @@
 
 int evaluate_board(const Board& board, Color side_to_move) {
     int score = 0;
+    int pieces = 0;
     for (int rank = 0; rank < Board::Size; ++rank) {
         for (int file = 0; file < Board::Size; ++file) {
             const auto& sq = board.at(rank, file);
             if (!sq) continue;
+            ++pieces;
             int value = piece_value(sq->type);
 
             // Piece-square table bonus
@@ -30,6 +40,11 @@ int evaluate_board(const Board& board, Color side_to_move) {
         }
     }
 
+    // Exact result for KPK, KRK and KQK
+    if (pieces == 3) {
+        if (auto known = bitbase_eval(board, side_to_move)) return *known;
+    }
+
     // King safety: simple penalty if king is exposed (e.g., not surrounded by pawns)
     // (You can expand this logic as needed)
     // ...
@@ -37,49 +52,315 @@ int evaluate_board(const Board& board, Color side_to_move) {
     return score;
 }
 
-// Minimax search (no alpha-beta), flexible depth, returns evaluation score
-int minimax(Board& board, Color side_to_move, int depth, bool maximizingPlayer) {
+// Search-side wrappers so movegen and eval time can be attributed separately.
+template <Color Us>
+static std::expected<std::vector<Move>, std::string> search_generate_moves(const Board& board,
+                                                                          const AttackInfo& attacks) {
+    STATS_INC(movegen_calls);
+    STATS_TIMER(movegen_ns);
+    return generate_legal_moves<Us>(board, attacks);
+}
+
+static int search_evaluate(const Board& board, Color side) {
+    STATS_INC(eval_calls);
+    STATS_TIMER(eval_ns);
+    return evaluate_board(board, side);
+}
+
+// Tablebase results rank above any material score; quicker wins (more remaining depth) score higher.
+constexpr int TbWinScore = 100000;
+
+// Probes the WDL tables for the side to move at this node and converts the
+// result to a score for `root_side`.
+static std::optional<int> probe_tablebase(Board& board, Color node_side, Color root_side, int depth) {
+    if (syzygy_max_pieces() == 0 || depth < syzygy_options.probe_depth) return std::nullopt;
+    if (syzygy_piece_count(board) > std::min(syzygy_max_pieces(), syzygy_options.probe_limit)) return std::nullopt;
+
+    board.set_side_to_move(node_side);
+    auto wdl = syzygy_probe_wdl(board);
+    if (!wdl) return std::nullopt;
+    STATS_INC(tb_hits);
+
+    int score = 0;
+    switch (*wdl) {
+        case WdlScore::Win: score = TbWinScore + depth; break;
+        case WdlScore::Loss: score = -TbWinScore - depth; break;
+        case WdlScore::CursedWin: score = syzygy_options.use_rule50 ? 1 : TbWinScore + depth; break;
+        case WdlScore::BlessedLoss: score = syzygy_options.use_rule50 ? -1 : -TbWinScore - depth; break;
+        case WdlScore::Draw: score = 0; break;
+    }
+    return node_side == root_side ? score : -score;
+}
+
+// Node and time budget shared by the threads of one MoveSelector::search call.
+struct SearchControl {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> nodes{0};
+    uint64_t node_limit = 0;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    const std::atomic<bool>* external_stop = nullptr;
+    std::atomic<uint64_t>* progress = nullptr;
+
+    // Nodes are added in batches so the shared counter and the clock are
+    // only touched every 1024 nodes per thread.
+    bool should_stop(uint32_t& pending) {
+        if (++pending >= 1024) {
+            uint64_t searched = nodes.fetch_add(pending, std::memory_order_relaxed) + pending;
+            if (progress) progress->fetch_add(pending, std::memory_order_relaxed);
+            pending = 0;
+            if ((node_limit && searched >= node_limit) ||
+                (external_stop && external_stop->load(std::memory_order_relaxed)) ||
+                (deadline && std::chrono::steady_clock::now() >= *deadline))
+                stop.store(true, std::memory_order_relaxed);
+        }
+        return stop.load(std::memory_order_relaxed);
+    }
+};
+
+static thread_local SearchControl* current_control = nullptr;
+static thread_local uint32_t pending_nodes = 0;
+static thread_local TranspositionTable* current_tt = nullptr;
+// Game history followed by the positions on the current search path.
+static thread_local std::vector<uint64_t> position_history;
+
+// Fifty move rule, or a repetition since the last capture or pawn move. A
+// single repetition is enough: the side that could deviate did not.
+static bool is_draw(const Board& board, uint64_t key) {
+    int clock = board.get_halfmove_clock();
+    if (clock >= 100) {
+        Color side = board.get_side_to_move();
+        AttackInfo attacks = compute_attacks(board, side);
+        if (!attacks.in_check()) return true;
+        auto moves = side == Color::White ? generate_legal_moves<Color::White>(board, attacks)
+                                          : generate_legal_moves<Color::Black>(board, attacks);
+        return moves && !moves->empty(); // checkmate still counts
+    }
+    // The same side is to move only every other ply, and a position cannot
+    // recur within fewer than four.
+    int reach = std::min<int>(clock, static_cast<int>(position_history.size()));
+    for (int back = 4; back <= reach; back += 2) {
+        if (position_history[position_history.size() - back] == key) return true;
+    }
+    return false;
+}
+
+// Minimax search (no alpha-beta), flexible depth, returns evaluation score.
+// Root is the side the score is for, Maximizing whether Root is to move; both
+// are template parameters so the node's side is a constant in every node.
+template <Color Root, bool Maximizing>
+static int minimax(Board& board, int depth) {
+    constexpr Color node_side = Maximizing ? Root : opponent(Root);
+    // The result of an aborted search is discarded, any value will do.
+    if (current_control && current_control->should_stop(pending_nodes)) return 0;
+    STATS_NODE(depth);
+
+    board.set_side_to_move(node_side);
+    uint64_t key = zobrist_key(board);
+    if (is_draw(board, key)) {
+        STATS_INC(draw_cutoffs);
+        return 0;
+    }
+
     if (depth == 0) {
-        return evaluate_board(board, side_to_move);
+        STATS_INC(leaf_evals);
+        return search_evaluate(board, Root);
     }
 
-    auto result = generate_legal_moves(&board, maximizingPlayer ? side_to_move : (side_to_move == Color::White ? Color::Black : Color::White));
+    if (auto tb_score = probe_tablebase(board, node_side, Root, depth)) return *tb_score;
+
+    // Table scores are stored for the side to move at the node.
+    if (current_tt) {
+        if (auto entry = current_tt->probe(key); entry && entry->depth >= depth) {
+            STATS_INC(tt_hits);
+            return Maximizing ? entry->score : -entry->score;
+        }
+    }
+
+    // Attack maps are only needed from here on: leaves and table hits skip them.
+    const AttackInfo attacks = compute_attacks(board, node_side);
+    auto result = search_generate_moves<node_side>(board, attacks);
     if (!result || result->empty()) {
         // No legal moves: checkmate or stalemate
-        int eval = evaluate_board(board, side_to_move);
+        STATS_INC(terminal_nodes);
+        int eval = search_evaluate(board, Root);
         // Optionally, return large negative/positive for checkmate
         return eval;
     }
 
-    int bestEval = maximizingPlayer ? -1000000 : 1000000;
+    int bestEval = Maximizing ? -1000000 : 1000000;
+    const Move* bestMove = nullptr;
 
+    position_history.push_back(key);
     for (const auto& move : *result) {
         Board next_board = board;
         apply_move(next_board, move);
-        int eval = minimax(next_board, side_to_move, depth - 1, !maximizingPlayer);
-        if (maximizingPlayer) {
-            if (eval > bestEval) bestEval = eval;
+        int eval = minimax<Root, !Maximizing>(next_board, depth - 1);
+        if constexpr (Maximizing) {
+            if (eval > bestEval) { bestEval = eval; bestMove = &move; }
         } else {
-            if (eval < bestEval) bestEval = eval;
+            if (eval < bestEval) { bestEval = eval; bestMove = &move; }
         }
     }
+    position_history.pop_back();
+
+    if (current_tt && bestMove && !(current_control && current_control->stop.load(std::memory_order_relaxed))) {
+        current_tt->store(key, depth, Maximizing ? bestEval : -bestEval,
+                          TranspositionTable::encode_move(*bestMove));
+    }
     return bestEval;
 }
 
+int minimax(Board& board, Color side_to_move, int depth, bool maximizingPlayer) {
+    if (side_to_move == Color::White) {
+        return maximizingPlayer ? minimax<Color::White, true>(board, depth) : minimax<Color::White, false>(board, depth);
+    }
+    return maximizingPlayer ? minimax<Color::Black, true>(board, depth) : minimax<Color::Black, false>(board, depth);
+}
+
 MoveSelector::MoveSelector(int num_threads)
     : num_threads_(num_threads > 0 ? num_threads : 1) {}
 
+bool MoveSelector::history_independent(const Board& root) const {
+    return std::min<size_t>(root.get_halfmove_clock(), game_history_.size()) == 0;
+}
+
 Move MoveSelector::select_best_move(const Board& board, Color side_to_move, int depth) {
+    auto start_time = std::chrono::steady_clock::now();
+    auto result = search_root(board, side_to_move, depth, nullptr, last_stats_);
+    last_stats_.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    last_score_ = result->score;
+    return result->move;
+}
+
+Move MoveSelector::search(const Board& board, Color side_to_move, const SearchLimits& limits) {
+    auto start_time = std::chrono::steady_clock::now();
+    SearchControl control;
+    control.node_limit = limits.nodes;
+    control.external_stop = limits.stop;
+    control.progress = limits.nodes_searched;
+    if (limits.movetime_ms > 0) control.deadline = start_time + std::chrono::milliseconds(limits.movetime_ms);
+
+    SearchStats total;
+    total.threads = num_threads_;
+    std::optional<RootResult> best;
+    int max_depth = std::clamp(limits.depth, 1, SearchLimits::MaxDepth);
+    for (int depth = 1; depth <= max_depth; ++depth) {
+        SearchStats iteration;
+        // Depth 1 always runs to completion so there is a move to return.
+        auto result = search_root(board, side_to_move, depth, depth > 1 ? &control : nullptr, iteration);
+
+        total.total.merge(iteration.total);
+        total.thread_nodes.resize(iteration.thread_nodes.size());
+        for (size_t i = 0; i < iteration.thread_nodes.size(); ++i) total.thread_nodes[i] += iteration.thread_nodes[i];
+
+        if (!result) break;
+        best = std::move(result);
+        total.depth = depth;
+        last_lines_ = make_lines(board, side_to_move, *best, depth);
+        if (on_iteration_) {
+            total.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+            on_iteration_(depth, last_lines_, total);
+        }
+        if (best->from_tablebase || control.stop.load()) break;
+    }
+
+    last_stats_ = std::move(total);
+    last_stats_.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    last_score_ = best->score;
+    return best->move;
+}
+
+std::vector<RootLine> MoveSelector::make_lines(const Board& board, Color side_to_move, const RootResult& result,
+                                               int depth) const {
+    std::vector<RootLine> lines;
+    size_t count = std::min<size_t>(multi_pv_, result.ranked.size());
+    for (size_t i = 0; i < count; ++i) {
+        const auto& [score, move] = result.ranked[i];
+        RootLine line{ move, score, { move } };
+        // The rest of each line comes from the child's table entries.
+        if (tt_ && depth > 1) {
+            Board next = board;
+            next.set_side_to_move(side_to_move);
+            apply_move(next, move);
+            for (const Move& reply : extract_pv(*tt_, next, depth - 1)) line.pv.push_back(reply);
+        }
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+std::vector<Move> MoveSelector::principal_variation(const Board& board, Color side_to_move) const {
+    if (!tt_) return {};
+    Board root = board;
+    root.set_side_to_move(side_to_move);
+    return extract_pv(*tt_, root, std::max(last_stats_.depth, 1));
+}
+
+std::optional<MoveSelector::RootResult> MoveSelector::search_root(const Board& board, Color side_to_move, int depth,
+                                                                  SearchControl* control, SearchStats& stats) {
     auto result = generate_legal_moves(&board, side_to_move);
     if (!result || result->empty()) throw std::runtime_error("No legal moves");
 
-    const auto& moves = *result;
+    stats = SearchStats{};
+    stats.depth = depth;
+    stats.threads = num_threads_;
+    stats.total.nodes = 1;
+    stats.total.nodes_per_ply[0] = 1;
+
+    // Won or lost tablebase positions are played straight from DTZ; drawn ones
+    // only search the moves that keep the draw.
+    std::vector<Move>& moves = *result;
+    Board root = board;
+    root.set_side_to_move(side_to_move);
+    uint64_t root_key = zobrist_key(root);
+    if (syzygy_max_pieces() > 0) {
+        if (auto tb_move = syzygy_probe_root(root, moves)) {
+            auto wdl = syzygy_probe_wdl(root);
+            stats.total.tb_hits = 1;
+            int score = wdl && *wdl > WdlScore::Draw ? TbWinScore : wdl && *wdl < WdlScore::Draw ? -TbWinScore : 0;
+            return RootResult{ score, *tb_move, true, { { score, *tb_move } } };
+        }
+    }
+
+    // A deep enough table entry for the root, e.g. warmed from the analysis
+    // cache, answers the search outright: minimax scores are exact. It holds
+    // only the best move, so MultiPV searches the root moves instead, and
+    // is keyed by position alone, so it is skipped when the game history
+    // could make the root's result differ.
+    if (tt_ && multi_pv_ == 1 && history_independent(root)) {
+        if (auto entry = tt_->probe(root_key); entry && entry->depth >= depth) {
+            if (auto move = TranspositionTable::decode_move(root, entry->move)) {
+                stats.total.tt_hits = 1;
+                return RootResult{ entry->score, *move, false, { { entry->score, *move } } };
+            }
+        }
+    }
+
     std::vector<std::tuple<int, Move>> evals;
     std::mutex evals_mutex; // Mutex to protect evals
     std::atomic<size_t> next_idx{0};
     std::latch done_latch(num_threads_);
+    std::vector<ThreadStats> thread_stats(num_threads_);
 
-    auto worker = [&]() {
+    // A caller already bound to a node, such as one analysis or server
+    // worker per node, keeps all of its search threads there.
+    const int caller_node = current_thread_node();
+    auto worker = [&](int thread_idx) {
+        // On NUMA hosts each thread runs on one node, and its per-thread
+        // state (counters, path history) is allocated there on first touch.
+        // A single unbound thread is left to the scheduler.
+        if (caller_node >= 0) bind_thread_to_node(caller_node);
+        else if (num_threads_ > 1) bind_thread_to_node(thread_idx);
+#if CHESS_SEARCH_STATS
+        ThreadStats local_stats;
+        local_stats.root_depth = depth;
+        current_thread_stats = &local_stats;
+#endif
+        current_control = control;
+        current_tt = tt_;
+        pending_nodes = 0;
+        position_history = game_history_;
+        position_history.push_back(root_key);
         while (true) {
             size_t idx = next_idx.fetch_add(1);
             if (idx >= moves.size()) break;
@@ -92,20 +373,42 @@ Move MoveSelector::select_best_move(const Board& board, Color side_to_move, int
                 evals.push_back(std::move(tuple)); // Thread-safe push_back
             }
         }
+        if (control) control->nodes += pending_nodes;
+        current_control = nullptr;
+        current_tt = nullptr;
+#if CHESS_SEARCH_STATS
+        current_thread_stats = nullptr;
+        thread_stats[thread_idx] = local_stats;
+#endif
         done_latch.count_down();
     };
 
     std::vector<std::jthread> threads;
     threads.reserve(num_threads_);
     for (int i = 0; i < num_threads_; ++i) {
-        threads.emplace_back(worker);
+        threads.emplace_back(worker, i);
     }
     done_latch.wait();
 
-    auto best = std::max_element(evals.begin(), evals.end(),
-        [](const auto& a, const auto& b) { return std::get<0>(a) < std::get<0>(b); });
+    // Aggregate per-thread counters; the root itself is ply 0.
+    for (const auto& ts : thread_stats) {
+        stats.total.merge(ts);
+        stats.thread_nodes.push_back(ts.nodes);
+    }
+
+    if (control && control->stop.load()) return std::nullopt;
+
+    // Stable, so equal scores keep the order the moves finished in.
+    std::stable_sort(evals.begin(), evals.end(),
+        [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+    const auto& best = evals.front();
+
+    // The root entry starts the principal variation.
+    if (tt_) {
+        tt_->store(root_key, depth, std::get<0>(best), TranspositionTable::encode_move(std::get<1>(best)));
+    }
 
-    return std::get<1>(*best);
+    return RootResult{ std::get<0>(best), std::get<1>(best), false, std::move(evals) };
 }
 
 /*
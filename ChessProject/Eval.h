@@ -1,48 +1,129 @@
 #pragma once
 #include "Board.h"
+#include "EvalParams.h"
 #include "Move.h"
+#include "SearchStats.h"
 #include <vector>
 #include <tuple>
 #include <memory>
 #include <atomic>
 #include <mutex>
+#include <thread>
+#include <optional>
+#include <cstdint>
+#include <functional>
+#include <span>
 
 // Material values
 constexpr int piece_value(PieceType type) {
-    switch (type) {
-        case PieceType::Pawn:   return 100;
-        case PieceType::Knight: return 320;
-        case PieceType::Bishop: return 330;
-        case PieceType::Rook:   return 500;
-        case PieceType::Queen:  return 900;
-        case PieceType::King:   return 20000;
-    }
-    return 0;
+    return piece_values[static_cast<int>(type)];
 }
 
-// Example piece-square table for pawns (others can be added similarly)
-constexpr int pawn_table[8][8] = {
-    { 0,  0,  0,  0,  0,  0,  0,  0},
-    {50, 50, 50, 50, 50, 50, 50, 50},
-    {10, 10, 20, 30, 30, 20, 10, 10},
-    { 5,  5, 10, 25, 25, 10,  5,  5},
-    { 0,  0,  0, 20, 20,  0,  0,  0},
-    { 5, -5,-10,  0,  0,-10, -5,  5},
-    { 5, 10, 10,-20,-20, 10, 10,  5},
-    { 0,  0,  0,  0,  0,  0,  0,  0}
-};
-// Add similar tables for other pieces as needed...
-
 int evaluate_board(const Board& board, Color side_to_move);
+
+struct PackedPosition;
+
+// evaluate_board for many positions at once, each from its own side to move:
+// scores[i] is exactly evaluate_board(positions[i], side to move). Positions
+// are evaluated eight at a time in structure-of-arrays blocks, with AVX2 when
+// kernel_variant() selects it. `scores` must be at least as long as `positions`.
+// A packed record that is not valid() scores 0.
+void evaluate_batch(std::span<const PackedPosition> positions, std::span<int> scores);
+void evaluate_batch(std::span<const Board> positions, std::span<int> scores);
 int minimax(Board& board, Color side_to_move, int depth, bool maximizingPlayer);
 
 Move select_best_move(const Board& board, Color side_to_move, int depth);
 
+// Limits for MoveSelector::search. A zero node or time budget means unlimited.
+struct SearchLimits {
+    static constexpr int MaxDepth = ThreadStats::MaxPly - 1;
+
+    int depth = 4;
+    uint64_t nodes = 0;
+    int64_t movetime_ms = 0;
+    // Checked with the node and time budget; setting it from another thread
+    // ends the search like an exhausted budget.
+    const std::atomic<bool>* stop = nullptr;
+    // Nodes searched so far, for progress displays. Raised with the shared
+    // node count, in steps of 1024 nodes per thread.
+    std::atomic<uint64_t>* nodes_searched = nullptr;
+};
+
+struct SearchControl;
+class TranspositionTable;
+
+// One root move with its score for the side to move and its principal variation.
+struct RootLine {
+    Move move;
+    int score;
+    std::vector<Move> pv;
+};
+
 class MoveSelector {
 public:
     MoveSelector(int num_threads = std::thread::hardware_concurrency());
     Move select_best_move(const Board& board, Color side_to_move, int depth);
 
+    // Iterative deepening up to limits.depth. When the node or time budget runs
+    // out the unfinished depth is dropped and the last completed one is used.
+    Move search(const Board& board, Color side_to_move, const SearchLimits& limits);
+
+    // Counters of the most recent search; depth is the last completed depth.
+    const SearchStats& last_stats() const { return last_stats_; }
+    // Score of the returned move for the side that played it.
+    int last_score() const { return last_score_; }
+
+    // Number of root lines to rank (MultiPV). Plain minimax scores every root
+    // move exactly, so extra lines cost only their PV extraction.
+    void set_multi_pv(int lines) { multi_pv_ = std::max(lines, 1); }
+    int multi_pv() const { return multi_pv_; }
+    // Best lines of the last completed iteration, best first.
+    const std::vector<RootLine>& last_lines() const { return last_lines_; }
+
+    // Called after every completed iteration with its depth, ranked lines and
+    // the counters accumulated so far.
+    using IterationCallback = std::function<void(int depth, const std::vector<RootLine>& lines, const SearchStats& stats)>;
+    void set_iteration_callback(IterationCallback callback) { on_iteration_ = std::move(callback); }
+
+    // Table shared by all search threads, nullptr to search without one. The
+    // table may be shared with other selectors and must outlive the searches.
+    void set_transposition_table(TranspositionTable* tt) { tt_ = tt; }
+    TranspositionTable* transposition_table() const { return tt_; }
+
+    // Zobrist keys of the positions played before the one being searched,
+    // oldest first. Repeating one of them, or a position earlier on the
+    // search path, scores as a draw.
+    void set_game_history(std::vector<uint64_t> keys) { game_history_ = std::move(keys); }
+    const std::vector<uint64_t>& game_history() const { return game_history_; }
+
+    // True when no game history position can recur in a search of `root`:
+    // there is none since the last capture or pawn move. Only then does the
+    // result depend on the position alone, so it may be taken from or stored
+    // under its Zobrist key across searches (root table hits, AnalysisCache).
+    bool history_independent(const Board& root) const;
+
+    // Best line of the last search, read back from the transposition table.
+    std::vector<Move> principal_variation(const Board& board, Color side_to_move) const;
+
 private:
+    struct RootResult {
+        int score;
+        Move move;
+        bool from_tablebase;
+        std::vector<std::tuple<int, Move>> ranked; // every searched root move, best first
+    };
+
     int num_threads_;
+    SearchStats last_stats_;
+    int last_score_ = 0;
+    TranspositionTable* tt_ = nullptr;
+    std::vector<uint64_t> game_history_;
+    int multi_pv_ = 1;
+    std::vector<RootLine> last_lines_;
+    IterationCallback on_iteration_;
+
+    std::vector<RootLine> make_lines(const Board& board, Color side_to_move, const RootResult& result, int depth) const;
+
+    std::optional<RootResult> search_root(const Board& board, Color side_to_move, int depth,
+                                          SearchControl* control, SearchStats& stats);
 };
\ No newline at end of file
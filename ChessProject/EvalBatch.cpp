@@ -0,0 +1,145 @@
+#include "Eval.h"
+#include "Bitbase.h"
+#include "CpuFeatures.h"
+#include "PackedPosition.h"
+#include <algorithm>
+#include <bit>
+#include <type_traits>
+#if CHESS_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr int Lanes = 8;
+constexpr int EmptyCode = 15; // piece codes are color << 3 | type, as in PackedPosition
+
+// Material plus piece-square bonus of every piece code on every square, from
+// white's point of view. The batch score is a plain sum of table entries.
+struct SquareTables {
+    alignas(32) int32_t value[64][16];
+};
+
+constexpr SquareTables make_square_tables() {
+    SquareTables tables{};
+    for (int sq = 0; sq < 64; ++sq) {
+        int rank = sq / 8, file = sq % 8;
+        for (int type = 0; type < 6; ++type) {
+            int white = piece_values[type] + (type == static_cast<int>(PieceType::Pawn) ? pawn_table[rank][file] : 0);
+            int black = piece_values[type] + (type == static_cast<int>(PieceType::Pawn) ? pawn_table[7 - rank][file] : 0);
+            tables.value[sq][type] = white;
+            tables.value[sq][8 | type] = -black;
+        }
+    }
+    return tables;
+}
+
+constexpr SquareTables square_tables = make_square_tables();
+
+// Structure-of-arrays block: the piece code of each square for each lane.
+struct Block {
+    alignas(32) int32_t codes[64][Lanes];
+    bool black_to_move[Lanes];
+    int pieces[Lanes];
+
+    void clear() {
+        for (auto& square : codes) {
+            for (int32_t& code : square) code = EmptyCode;
+        }
+    }
+
+    void load(int lane, const PackedPosition& packed) {
+        black_to_move[lane] = packed.flags & 1;
+        pieces[lane] = 0;
+        // A corrupt record would read codes past the end of `pieces` or
+        // index missing piece types; it scores as an empty board instead.
+        if (!packed.valid()) return;
+        int index = 0;
+        for (uint64_t bits = packed.occupancy; bits; bits &= bits - 1, ++index) {
+            codes[std::countr_zero(bits)][lane] = (packed.pieces[index / 2] >> (index % 2 * 4)) & 0xF;
+        }
+        pieces[lane] = index;
+    }
+
+    void load(int lane, const Board& board) {
+        int count = 0;
+        for (int sq = 0; sq < 64; ++sq) {
+            const auto& piece = board.at(sq / 8, sq % 8);
+            if (!piece) continue;
+            codes[sq][lane] = static_cast<int>(piece->color) << 3 | static_cast<int>(piece->type);
+            ++count;
+        }
+        black_to_move[lane] = board.get_side_to_move() == Color::Black;
+        pieces[lane] = count;
+    }
+};
+
+// White's score for every lane of the block.
+void score_block_scalar(const Block& block, int32_t* white_scores) {
+    for (int lane = 0; lane < Lanes; ++lane) white_scores[lane] = 0;
+    for (int sq = 0; sq < 64; ++sq) {
+        for (int lane = 0; lane < Lanes; ++lane) white_scores[lane] += square_tables.value[sq][block.codes[sq][lane]];
+    }
+}
+
+#if CHESS_X86
+CHESS_TARGET_AVX2 void score_block_avx2(const Block& block, int32_t* white_scores) {
+    __m256i sum = _mm256_setzero_si256();
+    for (int sq = 0; sq < 64; ++sq) {
+        __m256i codes = _mm256_load_si256(reinterpret_cast<const __m256i*>(block.codes[sq]));
+        __m256i low = _mm256_load_si256(reinterpret_cast<const __m256i*>(&square_tables.value[sq][0]));
+        __m256i high = _mm256_load_si256(reinterpret_cast<const __m256i*>(&square_tables.value[sq][8]));
+        // permutevar uses the low three bits of each code; bit 3 (black or
+        // empty) picks the upper half of the table.
+        __m256 white = _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(low, codes));
+        __m256 black = _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(high, codes));
+        __m256 pick_black = _mm256_castsi256_ps(_mm256_slli_epi32(codes, 28));
+        sum = _mm256_add_epi32(sum, _mm256_castps_si256(_mm256_blendv_ps(white, black, pick_black)));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(white_scores), sum);
+}
+#else
+void score_block_avx2(const Block& block, int32_t* white_scores) {
+    score_block_scalar(block, white_scores);
+}
+#endif
+
+template <KernelVariant Variant, typename PositionType>
+void evaluate_blocks(std::span<const PositionType> positions, std::span<int> scores) {
+    Block block;
+    int32_t white_scores[Lanes];
+    for (size_t base = 0; base < positions.size(); base += Lanes) {
+        int count = static_cast<int>(std::min<size_t>(Lanes, positions.size() - base));
+        block.clear();
+        for (int lane = 0; lane < count; ++lane) block.load(lane, positions[base + lane]);
+        if constexpr (Variant == KernelVariant::Avx2) score_block_avx2(block, white_scores);
+        else score_block_scalar(block, white_scores);
+
+        for (int lane = 0; lane < count; ++lane) {
+            int score = block.black_to_move[lane] ? -white_scores[lane] : white_scores[lane];
+            // Exact result for KPK, KRK and KQK, as in evaluate_board
+            if (block.pieces[lane] == 3) {
+                Board board;
+                const Board* bitbase_board = &board;
+                if constexpr (std::is_same_v<PositionType, Board>) bitbase_board = &positions[base + lane];
+                else unpack_position(positions[base + lane], board);
+                Color side = block.black_to_move[lane] ? Color::Black : Color::White;
+                if (auto known = bitbase_eval(*bitbase_board, side)) score = *known;
+            }
+            scores[base + lane] = score;
+        }
+    }
+}
+
+} // namespace
+
+// The kernel variant is chosen once per call.
+void evaluate_batch(std::span<const PackedPosition> positions, std::span<int> scores) {
+    if (kernel_variant() == KernelVariant::Avx2) evaluate_blocks<KernelVariant::Avx2>(positions, scores);
+    else evaluate_blocks<KernelVariant::Scalar>(positions, scores);
+}
+
+void evaluate_batch(std::span<const Board> positions, std::span<int> scores) {
+    if (kernel_variant() == KernelVariant::Avx2) evaluate_blocks<KernelVariant::Avx2>(positions, scores);
+    else evaluate_blocks<KernelVariant::Scalar>(positions, scores);
+}
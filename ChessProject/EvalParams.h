@@ -0,0 +1,20 @@
+#pragma once
+
+// Evaluation parameters, written by the "tune" mode (see Tune.h). Rerun the
+// tuner to change them rather than editing this file by hand.
+// Hand-written starting values.
+
+// Indexed by PieceType; the king value is not tuned.
+constexpr int piece_values[6] = { 100, 320, 330, 500, 900, 20000 };
+
+// Pawn bonus by rank from the pawn owner's side (row 0 = own back rank) and file.
+constexpr int pawn_table[8][8] = {
+    { 0,  0,  0,  0,  0,  0,  0,  0},
+    {50, 50, 50, 50, 50, 50, 50, 50},
+    {10, 10, 20, 30, 30, 20, 10, 10},
+    { 5,  5, 10, 25, 25, 10,  5,  5},
+    { 0,  0,  0, 20, 20,  0,  0,  0},
+    { 5, -5,-10,  0,  0,-10, -5,  5},
+    { 5, 10, 10,-20,-20, 10, 10,  5},
+    { 0,  0,  0,  0,  0,  0,  0,  0}
+};
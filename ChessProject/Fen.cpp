@@ -0,0 +1,341 @@
+#include "Fen.h"
+#include "MappedFile.h"
+#include "MoveGen.h"
+#include <algorithm>
+#include <chrono>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <print>
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_space(text.front())) text.remove_prefix(1);
+    while (!text.empty() && is_space(text.back())) text.remove_suffix(1);
+    return text;
+}
+
+// Splits off the next space separated field of `text` from `pos` on.
+std::string_view next_field(std::string_view text, size_t& pos) {
+    while (pos < text.size() && is_space(text[pos])) ++pos;
+    size_t begin = pos;
+    while (pos < text.size() && !is_space(text[pos])) ++pos;
+    return text.substr(begin, pos - begin);
+}
+
+std::optional<int> parse_number(std::string_view field) {
+    int value = 0;
+    auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+    if (field.empty() || ec != std::errc() || end != field.data() + field.size() || value < 0) return std::nullopt;
+    return value;
+}
+
+std::optional<PieceType> piece_type(char c) {
+    switch (c | 0x20) {
+        case 'p': return PieceType::Pawn;
+        case 'n': return PieceType::Knight;
+        case 'b': return PieceType::Bishop;
+        case 'r': return PieceType::Rook;
+        case 'q': return PieceType::Queen;
+        case 'k': return PieceType::King;
+    }
+    return std::nullopt;
+}
+
+char piece_letter(const Piece& piece) {
+    static constexpr char letters[] = "PNBRQK";
+    char c = letters[static_cast<int>(piece.type)];
+    return piece.color == Color::White ? c : static_cast<char>(c | 0x20);
+}
+
+bool has_piece(const Board& board, int rank, int file, PieceType type, Color color) {
+    const auto& square = board.at(rank, file);
+    return square && square->type == type && square->color == color;
+}
+
+// Calls visit(opcode, operand) for each operation "opcode operand...;" of
+// `text`. A semicolon inside a quoted operand does not end it. Returns the
+// offset of a syntax error: an unterminated quote, or in strict mode an
+// operation without its semicolon.
+template <typename Visit>
+std::optional<size_t> for_each_op(std::string_view text, bool strict, Visit&& visit) {
+    size_t pos = 0;
+    while (true) {
+        while (pos < text.size() && is_space(text[pos])) ++pos;
+        if (pos == text.size()) return std::nullopt;
+        size_t begin = pos;
+        bool quoted = false;
+        while (pos < text.size() && (quoted || text[pos] != ';')) {
+            if (text[pos] == '"') quoted = !quoted;
+            ++pos;
+        }
+        if (quoted || (strict && pos == text.size())) return pos;
+        std::string_view op = trim(text.substr(begin, pos - begin));
+        size_t opcode_end = 0;
+        while (opcode_end < op.size() && !is_space(op[opcode_end])) ++opcode_end;
+        std::string_view operand = trim(op.substr(opcode_end));
+        if (operand.size() >= 2 && operand.front() == '"' && operand.back() == '"' &&
+            operand.find('"', 1) == operand.size() - 1) {
+            operand = operand.substr(1, operand.size() - 2);
+        }
+        visit(op.substr(0, opcode_end), operand);
+        if (pos < text.size()) ++pos;
+    }
+}
+
+std::unexpected<FenError> fail(std::string_view what, size_t offset) {
+    return std::unexpected(FenError{ what, offset });
+}
+
+// The checks of FenMode::Strict that look at the whole position.
+std::optional<std::string_view> position_error(const Board& board) {
+    int kings[2] = {};
+    for (int rank = 0; rank < Board::Size; ++rank) {
+        for (int file = 0; file < Board::Size; ++file) {
+            const auto& square = board.at(rank, file);
+            if (!square) continue;
+            if (square->type == PieceType::King) ++kings[static_cast<int>(square->color)];
+            if (square->type == PieceType::Pawn && (rank == 0 || rank == Board::Size - 1)) return "pawn on a back rank";
+        }
+    }
+    if (kings[0] != 1 || kings[1] != 1) return "each side needs exactly one king";
+    if (king_in_check(board, opponent(board.get_side_to_move()))) return "side not to move is in check";
+    return std::nullopt;
+}
+
+} // namespace
+
+std::string FenError::to_string() const {
+    return std::format("{} at offset {}", what, offset);
+}
+
+std::string_view EpdOps::operand(std::string_view opcode) const {
+    std::string_view found;
+    for_each_op(text, false, [&](std::string_view code, std::string_view value) {
+        if (code == opcode && found.empty()) found = value;
+    });
+    return found;
+}
+
+std::expected<EpdOps, FenError> parse_fen(std::string_view text, Board& board, FenMode mode) {
+    bool strict = mode == FenMode::Strict;
+    size_t pos = 0;
+
+    std::string_view placement = next_field(text, pos);
+    size_t field_start = pos - placement.size();
+    if (placement.empty()) return fail("empty FEN", 0);
+    board.clear_board();
+    int rank = Board::Size - 1, file = 0;
+    for (size_t i = 0; i < placement.size(); ++i) {
+        char c = placement[i];
+        if (c == '/') {
+            if (file != Board::Size || rank == 0) return fail("rank without 8 squares", field_start + i);
+            --rank;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+            if (file > Board::Size) return fail("rank without 8 squares", field_start + i);
+        } else if (auto type = piece_type(c)) {
+            if (file >= Board::Size) return fail("rank without 8 squares", field_start + i);
+            board.set_piece(rank, file++, *type, c >= 'a' ? Color::Black : Color::White);
+        } else {
+            return fail("invalid piece", field_start + i);
+        }
+    }
+    if (rank != 0 || file != Board::Size) return fail("placement without 8 ranks", field_start + placement.size());
+
+    std::string_view side = next_field(text, pos);
+    if (side != "w" && side != "b") return fail("side to move must be w or b", pos - side.size());
+    board.set_side_to_move(side == "b" ? Color::Black : Color::White);
+
+    std::string_view castling = next_field(text, pos);
+    field_start = pos - castling.size();
+    if (castling.empty()) return fail("missing castling rights", field_start);
+    board.white_kingside_castle = board.white_queenside_castle = false;
+    board.black_kingside_castle = board.black_queenside_castle = false;
+    if (castling != "-") {
+        for (size_t i = 0; i < castling.size(); ++i) {
+            Color color = castling[i] == 'K' || castling[i] == 'Q' ? Color::White : Color::Black;
+            int home = color == Color::White ? 0 : Board::Size - 1;
+            bool* right;
+            int rook_file;
+            switch (castling[i]) {
+                case 'K': right = &board.white_kingside_castle; rook_file = 7; break;
+                case 'Q': right = &board.white_queenside_castle; rook_file = 0; break;
+                case 'k': right = &board.black_kingside_castle; rook_file = 7; break;
+                case 'q': right = &board.black_queenside_castle; rook_file = 0; break;
+                default: return fail("invalid castling right", field_start + i);
+            }
+            bool in_place = has_piece(board, home, 4, PieceType::King, color) &&
+                            has_piece(board, home, rook_file, PieceType::Rook, color);
+            if (strict && (*right || !in_place)) {
+                return fail(*right ? "repeated castling right" : "castling right without king and rook", field_start + i);
+            }
+            *right = in_place;
+        }
+    }
+
+    std::string_view ep = next_field(text, pos);
+    field_start = pos - ep.size();
+    if (ep.empty()) return fail("missing en passant square", field_start);
+    board.set_en_passant_target(std::nullopt);
+    bool ep_square = ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && ep[1] >= '1' && ep[1] <= '8';
+    if (ep_square) {
+        int ep_rank = ep[1] - '1', ep_file = ep[0] - 'a';
+        if (strict) {
+            // The pawn that just moved two squares stands in front of the target.
+            Color mover = opponent(board.get_side_to_move());
+            int expected_rank = mover == Color::White ? 2 : 5;
+            int pawn_rank = mover == Color::White ? 3 : 4;
+            if (ep_rank != expected_rank || board.at(ep_rank, ep_file) ||
+                !has_piece(board, pawn_rank, ep_file, PieceType::Pawn, mover)) {
+                return fail("en passant square without a pawn that just moved", field_start);
+            }
+        }
+        board.set_en_passant_target(std::make_pair(ep_rank, ep_file));
+    } else if (ep != "-" && strict) {
+        return fail("invalid en passant square", field_start);
+    }
+
+    // Move counters, optional in EPD where operations take their place.
+    int halfmove = 0, fullmove = 1;
+    bool has_counters = false;
+    size_t after_fields = pos;
+    size_t peek = pos;
+    std::string_view field = next_field(text, peek);
+    if (auto clock = parse_number(field)) {
+        halfmove = *clock;
+        after_fields = peek;
+        field = next_field(text, peek);
+        if (auto number = parse_number(field)) {
+            fullmove = *number;
+            after_fields = peek;
+            has_counters = true;
+        } else if (strict) {
+            return fail("missing fullmove number", peek - field.size());
+        }
+    }
+
+    EpdOps ops;
+    ops.text = trim(text.substr(after_fields));
+    if (!ops.text.empty()) {
+        auto error = for_each_op(ops.text, strict, [&](std::string_view code, std::string_view value) {
+            if (code == "bm") ops.bm = value;
+            else if (code == "am") ops.am = value;
+            else if (code == "id") ops.id = value;
+            else if (code == "c0") ops.c0 = value;
+            else if (!has_counters && code == "hmvc") halfmove = parse_number(value).value_or(halfmove);
+            else if (!has_counters && code == "fmvn") fullmove = parse_number(value).value_or(fullmove);
+        });
+        // Lenient parsing keeps text that is not made of operations, such as
+        // a bare game result, in ops.text for the caller.
+        if (error && strict) return fail("unterminated EPD operation", static_cast<size_t>(ops.text.data() - text.data()) + *error);
+    }
+    if (strict && fullmove < 1) return fail("fullmove number must be at least 1", after_fields);
+    board.set_halfmove_clock(halfmove);
+    board.set_fullmove_number(std::max(fullmove, 1));
+
+    if (strict) {
+        if (auto error = position_error(board)) return fail(*error, 0);
+    }
+    return ops;
+}
+
+size_t write_fen(const Board& board, std::span<char> out) {
+    char buffer[MaxFenLength];
+    char* p = buffer;
+    for (int rank = Board::Size - 1; rank >= 0; --rank) {
+        int empty = 0;
+        for (int file = 0; file < Board::Size; ++file) {
+            const auto& square = board.at(rank, file);
+            if (!square) {
+                ++empty;
+                continue;
+            }
+            if (empty) *p++ = static_cast<char>('0' + empty);
+            empty = 0;
+            *p++ = piece_letter(*square);
+        }
+        if (empty) *p++ = static_cast<char>('0' + empty);
+        if (rank > 0) *p++ = '/';
+    }
+    *p++ = ' ';
+    *p++ = board.get_side_to_move() == Color::White ? 'w' : 'b';
+    *p++ = ' ';
+    char* rights = p;
+    if (board.white_kingside_castle) *p++ = 'K';
+    if (board.white_queenside_castle) *p++ = 'Q';
+    if (board.black_kingside_castle) *p++ = 'k';
+    if (board.black_queenside_castle) *p++ = 'q';
+    if (p == rights) *p++ = '-';
+    *p++ = ' ';
+    if (const auto& ep = board.get_en_passant_target()) {
+        *p++ = static_cast<char>('a' + ep->second);
+        *p++ = static_cast<char>('1' + ep->first);
+    } else {
+        *p++ = '-';
+    }
+    *p++ = ' ';
+    p = std::to_chars(p, p + 11, board.get_halfmove_clock()).ptr;
+    *p++ = ' ';
+    p = std::to_chars(p, p + 11, board.get_fullmove_number()).ptr;
+
+    size_t length = static_cast<size_t>(p - buffer);
+    if (length > out.size()) return 0;
+    std::memcpy(out.data(), buffer, length);
+    return length;
+}
+
+std::optional<FenCheckOptions> parse_fen_check_args(const std::vector<std::string>& args) {
+    FenCheckOptions options;
+    try {
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if (arg == "--input" && has_value) options.input_path = args[++i];
+            else if (arg == "--lenient") options.mode = FenMode::Lenient;
+            else if (arg == "--max-reports" && has_value) options.max_reports = std::max(0, std::stoi(args[++i]));
+            else return std::nullopt;
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    if (options.input_path.empty()) return std::nullopt;
+    return options;
+}
+
+int run_fen_check(const FenCheckOptions& options) {
+    MappedFile file;
+    if (!file.open(options.input_path)) {
+        std::println(stderr, "Cannot open {}", options.input_path);
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::string_view text(reinterpret_cast<const char*>(file.data()), file.size());
+    uint64_t line_no = 0, positions = 0, invalid = 0;
+    Board board;
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        ++line_no;
+        std::string_view content = trim(line);
+        if (content.empty() || content.front() == '#') continue;
+
+        ++positions;
+        auto ops = parse_fen(line, board, options.mode);
+        if (ops) continue;
+        if (invalid++ < static_cast<uint64_t>(options.max_reports)) {
+            std::println("{}: {}: {}", line_no, ops.error().to_string(), content);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::println("{} positions, {} invalid, {:.0f} positions/s", positions, invalid, positions / std::max(seconds, 1e-9));
+    return invalid ? 1 : 0;
+}
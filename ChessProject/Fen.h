@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <expected>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include "Board.h"
+
+// FEN and EPD parsing over string_view and from_chars, without allocating,
+// and FEN output into a caller's buffer.
+
+// Longest FEN write_fen produces: 64 pieces, 7 slashes, the four short
+// fields and two counters of up to 11 characters, with separators.
+constexpr size_t MaxFenLength = 71 + 1 + 1 + 1 + 4 + 1 + 2 + 1 + 11 + 1 + 11;
+
+enum class FenMode {
+    // As set_fen always accepted: move counters optional, castling rights
+    // without their king and rook dropped, a malformed en passant field ignored.
+    Lenient,
+    // For validating bulk input: both move counters or neither, rights and
+    // en passant square consistent with the pieces, one king per side, no
+    // pawns on the back ranks and the side not to move not in check.
+    Strict,
+};
+
+struct FenError {
+    std::string_view what;  // static text
+    size_t offset;          // in the parsed text
+
+    std::string to_string() const;
+};
+
+// EPD operations following the FEN fields, e.g. bm Nf3 e4; id "pos 12";
+// Operands are views into the parsed text, without quotes; multiple moves
+// of bm and am stay space separated.
+struct EpdOps {
+    std::string_view text;  // everything after the FEN fields
+    std::string_view bm;
+    std::string_view am;
+    std::string_view id;
+    std::string_view c0;
+
+    // Operand of any opcode, e.g. "c9" or "acd"; empty when absent.
+    std::string_view operand(std::string_view opcode) const;
+};
+
+// Parses a FEN, or the four FEN fields of an EPD record and its operations,
+// into `board`. The board is left unspecified on error.
+std::expected<EpdOps, FenError> parse_fen(std::string_view text, Board& board, FenMode mode = FenMode::Lenient);
+
+// Writes the FEN of `board` to `out` and returns its length, or 0 when `out`
+// is shorter than the FEN. Not terminated.
+size_t write_fen(const Board& board, std::span<char> out);
+
+struct FenCheckOptions {
+    std::string input_path;      // FEN or EPD per line
+    FenMode mode = FenMode::Strict;
+    int max_reports = 20;        // invalid lines printed; all are counted
+};
+
+// Parses the arguments following "fen-check" on the command line.
+std::optional<FenCheckOptions> parse_fen_check_args(const std::vector<std::string>& args);
+
+// Validates every line of a position file, printing the first invalid ones
+// and a summary. Exits with 1 when any line is invalid.
+int run_fen_check(const FenCheckOptions& options);
@@ -0,0 +1,225 @@
+#include "Gensfen.h"
+#include "MoveGen.h"
+#include "PackedPosition.h"
+#include "Memory.h"
+#include "TranspositionTable.h"
+#include "Zobrist.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <print>
+#include <random>
+
+namespace {
+
+// Finished games handed from the searchers to the writer thread. Pushing
+// swaps the game into an empty queue, or appends it to the games the writer
+// has not taken yet, so searchers never wait for I/O.
+class SampleQueue {
+public:
+    void push(std::vector<PackedPosition>&& samples) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_.empty()) pending_.swap(samples);
+            else pending_.insert(pending_.end(), samples.begin(), samples.end());
+        }
+        ready_.notify_one();
+    }
+
+    // Takes everything queued, waiting at most `timeout` for something to arrive.
+    std::vector<PackedPosition> take(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait_for(lock, timeout, [&] { return !pending_.empty() || closed_; });
+        std::vector<PackedPosition> taken;
+        taken.swap(pending_);
+        return taken;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
+
+    bool closed() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_ && pending_.empty();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::vector<PackedPosition> pending_;
+    bool closed_ = false;
+};
+
+bool is_tactical_move(const Move& move) {
+    return move.type == MoveType::Capture || move.type == MoveType::EnPassant || move.type == MoveType::Promotion;
+}
+
+// Plays one game and returns its samples with the result filled in.
+std::vector<PackedPosition> play_game(const GensfenOptions& options, MoveSelector& selector, std::mt19937_64& rng) {
+    Board board;
+
+    // Random opening; start over if it runs into a finished game.
+    for (int ply = 0; ply < options.random_plies; ++ply) {
+        auto moves = generate_legal_moves(&board, board.get_side_to_move());
+        if (!moves || moves->empty()) {
+            board.setup_initial_position();
+            ply = -1;
+            continue;
+        }
+        apply_move(board, (*moves)[std::uniform_int_distribution<size_t>(0, moves->size() - 1)(rng)]);
+    }
+
+    std::vector<PackedPosition> samples;
+    std::vector<uint64_t> keys{ zobrist_key(board) };
+    int result = 0; // from white's point of view
+    for (int ply = 0; ply < options.max_plies; ++ply) {
+        Color side = board.get_side_to_move();
+        auto moves = generate_legal_moves(&board, side);
+        bool in_check = king_in_check(board, side);
+        if (!moves || moves->empty()) {
+            if (in_check) result = side == Color::White ? -1 : 1;
+            break;
+        }
+        int halfmove_clock = board.get_halfmove_clock();
+        if (halfmove_clock >= 100 || insufficient_material(board) ||
+            std::count(keys.end() - std::min<size_t>(keys.size(), halfmove_clock + 1), keys.end(), keys.back()) >= 3)
+            break;
+
+        selector.set_game_history({ keys.begin(), keys.end() - 1 });
+        Move move = selector.search(board, side, options.limits);
+        int score = selector.last_score();
+        if (std::abs(score) > options.max_score) {
+            // Decided game: adjudicate rather than play out a long conversion.
+            result = (score > 0) == (side == Color::White) ? 1 : -1;
+            break;
+        }
+
+        bool quiet = !in_check && !is_tactical_move(move) &&
+                     std::abs(evaluate_board(board, side) - score) <= options.eval_margin;
+        if (quiet) {
+            if (auto packed = pack_position(board)) {
+                packed->score = static_cast<int16_t>(score);
+                packed->move = TranspositionTable::encode_move(move);
+                samples.push_back(*packed);
+            }
+        }
+
+        apply_move(board, move);
+        keys.push_back(zobrist_key(board));
+    }
+
+    for (auto& sample : samples) sample.result = static_cast<int8_t>(result);
+    return samples;
+}
+
+} // namespace
+
+std::optional<GensfenOptions> parse_gensfen_args(const std::vector<std::string>& args) {
+    GensfenOptions options;
+    bool has_depth = false;
+    try {
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if (arg == "--output" && has_value) options.output_path = args[++i];
+            else if (arg == "--append") options.append = true;
+            else if (arg == "--positions" && has_value) options.positions = std::stoull(args[++i]);
+            else if (arg == "--threads" && has_value) options.threads = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--depth" && has_value) { options.limits.depth = std::stoi(args[++i]); has_depth = true; }
+            else if (arg == "--nodes" && has_value) options.limits.nodes = std::stoull(args[++i]);
+            else if (arg == "--hash" && has_value) options.hash_mb = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--random-plies" && has_value) options.random_plies = std::max(0, std::stoi(args[++i]));
+            else if (arg == "--max-plies" && has_value) options.max_plies = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--max-score" && has_value) options.max_score = std::stoi(args[++i]);
+            else if (arg == "--eval-margin" && has_value) options.eval_margin = std::stoi(args[++i]);
+            else if (arg == "--flush-ms" && has_value) options.flush_interval_ms = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--seed" && has_value) options.seed = std::stoull(args[++i]);
+            else return std::nullopt;
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    if (options.output_path.empty()) return std::nullopt;
+    options.max_score = std::clamp(options.max_score, 1, int(INT16_MAX));
+    if (!has_depth && options.limits.nodes) options.limits.depth = SearchLimits::MaxDepth;
+    return options;
+}
+
+int run_gensfen(const GensfenOptions& options) {
+    PositionWriter writer;
+    if (!writer.open(options.output_path, options.append)) {
+        std::println(stderr, "Cannot write {}", options.output_path);
+        return 1;
+    }
+
+    std::println("gensfen: {} positions to {}, {} threads, depth {}{}", options.positions, options.output_path,
+                 options.threads, options.limits.depth,
+                 options.limits.nodes ? std::format(", {} nodes", options.limits.nodes) : std::string());
+
+    uint64_t seed = options.seed ? options.seed : std::random_device{}();
+    SampleQueue queue;
+    std::atomic<uint64_t> produced{0}, games{0};
+    auto start = std::chrono::steady_clock::now();
+
+    // The writer owns the file and flushes at least every flush_interval_ms,
+    // so a crash loses no more than that much work.
+    std::jthread writer_thread([&] {
+        auto interval = std::chrono::milliseconds(options.flush_interval_ms);
+        auto last_report = std::chrono::steady_clock::now();
+        uint64_t written = 0;
+        while (!queue.closed() && written < options.positions) {
+            for (const auto& sample : queue.take(interval)) {
+                if (written == options.positions) break;
+                writer.write(sample);
+                ++written;
+            }
+            writer.flush();
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_report >= std::chrono::seconds(10)) {
+                double seconds = std::chrono::duration<double>(now - start).count();
+                std::println("{} positions, {} games, {:.0f} positions/s", written, games.load(), written / seconds);
+                last_report = now;
+            }
+        }
+    });
+
+    {
+        std::vector<std::jthread> workers;
+        for (int i = 0; i < options.threads; ++i) {
+            workers.emplace_back([&, i] {
+                std::mt19937_64 rng(seed + i);
+                bind_thread_to_node(i);
+                TranspositionTable tt(options.hash_mb, TranspositionTable::Placement::Local);
+                MoveSelector selector(1);
+                selector.set_transposition_table(&tt);
+                while (produced.load() < options.positions) {
+                    auto samples = play_game(options, selector, rng);
+                    produced += samples.size();
+                    ++games;
+                    queue.push(std::move(samples));
+                }
+            });
+        }
+    }
+    queue.close();
+    writer_thread.join();
+
+    bool ok = writer.close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::println("Wrote {} positions from {} games in {:.1f} s ({:.0f} positions/s, seed {})", writer.count(),
+                 games.load(), seconds, seconds > 0 ? writer.count() / seconds : 0.0, seed);
+    if (!ok) {
+        std::println(stderr, "Write to {} failed", options.output_path);
+        return 1;
+    }
+    return 0;
+}
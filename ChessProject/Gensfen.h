@@ -0,0 +1,30 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Eval.h"
+
+struct GensfenOptions {
+    std::string output_path;      // PackedPosition container, see PositionWriter
+    bool append = false;
+    uint64_t positions = 100000;  // Stop once this many samples are written
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    SearchLimits limits{ 3 };
+    size_t hash_mb = 16;          // per thread
+    int random_plies = 8;         // Uniformly random opening moves before sampling starts
+    int max_plies = 400;          // Longer games are adjudicated as draws
+    int max_score = 3000;         // Skip samples (and end the game) beyond this score
+    int eval_margin = 200;        // Skip samples whose static eval is this far from the search score
+    int flush_interval_ms = 1000;
+    uint64_t seed = 0;            // 0 picks a random seed
+};
+
+// Parses the arguments following "gensfen" on the command line.
+std::optional<GensfenOptions> parse_gensfen_args(const std::vector<std::string>& args);
+
+// Plays self-play games on every thread and streams quiet positions with
+// their search score and the final game result to the output file.
+int run_gensfen(const GensfenOptions& options);
@@ -0,0 +1,218 @@
+#include "Json.h"
+#include <charconv>
+#include <cstdint>
+#include <format>
+
+namespace {
+
+class Parser {
+public:
+    explicit Parser(std::string_view text) : text_(text) {}
+
+    std::expected<JsonObject, std::string> object() {
+        JsonObject result;
+        if (!members(result)) return fail(error_.empty() ? "invalid object" : error_);
+        skip_space();
+        if (pos_ != text_.size()) return fail("trailing characters");
+        return result;
+    }
+
+private:
+    std::string_view text_;
+    size_t pos_ = 0;
+    int depth_ = 0;  // nesting of objects and arrays
+    std::string error_;
+
+    static constexpr int MaxDepth = 64;
+
+    std::unexpected<std::string> fail(std::string_view what) const {
+        return std::unexpected(std::format("{} at offset {}", what, pos_));
+    }
+
+    bool error(std::string_view what) {
+        if (error_.empty()) error_ = what;
+        return false;
+    }
+
+    // {"key":value,...}
+    bool members(JsonObject& out) {
+        skip_space();
+        if (!consume('{')) return error("expected '{'");
+        if (++depth_ > MaxDepth) return error("nested too deeply");
+        skip_space();
+        if (consume('}')) {
+            --depth_;
+            return true;
+        }
+        while (true) {
+            skip_space();
+            std::string key;
+            if (!string(key)) return error("expected a key");
+            skip_space();
+            if (!consume(':')) return error("expected ':'");
+            JsonValue value;
+            if (!this->value(value)) return error("invalid value");
+            out.insert_or_assign(std::move(key), std::move(value));
+            skip_space();
+            if (consume('}')) {
+                --depth_;
+                return true;
+            }
+            if (!consume(',')) return error("expected ',' or '}'");
+        }
+    }
+
+    void skip_space() {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\r' || text_[pos_] == '\n'))
+            ++pos_;
+    }
+
+    bool consume(char c) {
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(std::string_view word) {
+        if (text_.substr(pos_, word.size()) != word) return false;
+        pos_ += word.size();
+        return true;
+    }
+
+    bool value(JsonValue& out) {
+        skip_space();
+        if (pos_ >= text_.size()) return false;
+        char c = text_[pos_];
+        if (c == '"') {
+            out.type = JsonValue::Type::String;
+            return string(out.string);
+        }
+        if (c == '[') {
+            ++pos_;
+            if (++depth_ > MaxDepth) return error("nested too deeply");
+            out.type = JsonValue::Type::Array;
+            skip_space();
+            while (!consume(']')) {
+                if (!out.array.empty() && !consume(',')) return false;
+                JsonValue element;
+                if (!value(element)) return false;
+                out.array.push_back(std::move(element));
+                skip_space();
+            }
+            --depth_;
+            return true;
+        }
+        if (c == '{') {
+            auto object = std::make_shared<JsonObject>();
+            if (!members(*object)) return false;
+            out.type = JsonValue::Type::Object;
+            out.object = std::move(object);
+            return true;
+        }
+        if (literal("true")) {
+            out.type = JsonValue::Type::Bool;
+            out.boolean = true;
+            return true;
+        }
+        if (literal("false")) {
+            out.type = JsonValue::Type::Bool;
+            return true;
+        }
+        if (literal("null")) return true;
+
+        auto [end, ec] = std::from_chars(text_.data() + pos_, text_.data() + text_.size(), out.number);
+        if (ec != std::errc()) return false;
+        pos_ = end - text_.data();
+        out.type = JsonValue::Type::Number;
+        return true;
+    }
+
+    bool hex4(uint32_t& code) {
+        if (pos_ + 4 > text_.size()) return false;
+        auto [end, ec] = std::from_chars(text_.data() + pos_, text_.data() + pos_ + 4, code, 16);
+        if (ec != std::errc() || end != text_.data() + pos_ + 4) return false;
+        pos_ += 4;
+        return true;
+    }
+
+    static void append_utf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool string(std::string& out) {
+        if (!consume('"')) return false;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_++];
+            if (c == '"') return true;
+            if (static_cast<unsigned char>(c) < 0x20) return false;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos_ >= text_.size()) return false;
+            switch (text_[pos_++]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t code;
+                    if (!hex4(code)) return false;
+                    // A surrogate pair encodes one code point above U+FFFF.
+                    if (code >= 0xD800 && code < 0xDC00) {
+                        uint32_t low;
+                        if (!literal("\\u") || !hex4(low) || low < 0xDC00 || low > 0xDFFF) return false;
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, code);
+                    break;
+                }
+                default: return false;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+std::string json_escape(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) out += std::format("\\u{:04x}", c);
+                else out += c;
+        }
+    }
+    return out;
+}
+
+std::expected<JsonObject, std::string> parse_json_object(std::string_view text) {
+    return Parser(text).object();
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <expected>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Just enough JSON for the line protocols: output is formatted by hand with
+// json_escape, input is one object per line.
+
+struct JsonValue;
+using JsonObject = std::map<std::string, JsonValue, std::less<>>;
+
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::shared_ptr<const JsonObject> object;
+};
+
+// Escapes quotes, backslashes and control characters for a JSON string.
+std::string json_escape(std::string_view text);
+
+// Parses a single object such as {"fen":"...","moves":["e2e4"],"depth":6}.
+std::expected<JsonObject, std::string> parse_json_object(std::string_view text);
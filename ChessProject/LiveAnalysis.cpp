@@ -0,0 +1,280 @@
+#include "LiveAnalysis.h"
+#include "MoveGen.h"
+#include "Screen.h"
+#include "TranspositionTable.h"
+#include "Zobrist.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <format>
+#include <mutex>
+#include <print>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+volatile std::sig_atomic_t interrupted = 0;
+
+void on_interrupt(int) {
+    interrupted = 1;
+}
+
+// Layout of the 80x24 screen: board on the left, counters and the eval
+// graph to its right, the best lines below.
+constexpr int ScreenRows = 24;
+constexpr int ScreenCols = 80;
+constexpr int BoardTop = 2;
+constexpr int PanelCol = 22;
+constexpr int GraphTop = 10;
+constexpr int GraphRows = 4;
+constexpr int GraphRange = 400;  // centipawns at the top and bottom of the graph
+constexpr int LinesTop = 16;
+constexpr int StatusRow = ScreenRows - 1;
+
+constexpr CellStyle Title{ -1, -1, true };
+constexpr CellStyle Label{ 244, -1, false };
+
+// Lower eighth blocks U+2581..U+2588, for bars of 1/8 cell resolution.
+const char* const eighths[8] = {
+    "\xE2\x96\x81", "\xE2\x96\x82", "\xE2\x96\x83", "\xE2\x96\x84",
+    "\xE2\x96\x85", "\xE2\x96\x86", "\xE2\x96\x87", "\xE2\x96\x88"
+};
+
+// What the search publishes after each completed depth.
+struct Snapshot {
+    int depth = 0;
+    std::vector<RootLine> lines;
+    std::vector<int> scores;  // best score of every completed depth, for White
+    bool done = false;
+};
+
+class SearchFeed {
+public:
+    void publish(int depth, const std::vector<RootLine>& lines, int white_score) {
+        std::lock_guard lock(mutex_);
+        snapshot_.depth = depth;
+        snapshot_.lines = lines;
+        snapshot_.scores.push_back(white_score);
+    }
+
+    void finish() {
+        {
+            std::lock_guard lock(mutex_);
+            snapshot_.done = true;
+        }
+        finished_.notify_all();
+    }
+
+    // Sleeps for `interval` or until the search ends, then copies the state.
+    Snapshot wait(Clock::duration interval) {
+        std::unique_lock lock(mutex_);
+        finished_.wait_for(lock, interval, [&] { return snapshot_.done; });
+        return snapshot_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable finished_;
+    Snapshot snapshot_;
+};
+
+struct Progress {
+    uint64_t nodes;
+    double seconds;
+};
+
+std::string format_score(int centipawns) {
+    return std::format("{:+.2f}", centipawns / 100.0);
+}
+
+// The moves of `line` in SAN, numbered from the position `board`.
+std::string san_line(Board board, const std::vector<Move>& line) {
+    std::string text;
+    for (const Move& move : line) {
+        bool white = board.get_side_to_move() == Color::White;
+        if (white || text.empty()) text += std::format("{}{} ", board.get_fullmove_number(), white ? "." : "...");
+        text += move_to_san(board, move) + " ";
+        apply_move(board, move);
+    }
+    return text;
+}
+
+void draw_board(ScreenBuffer& screen, const Board& board, const Snapshot& snapshot) {
+    std::optional<Move> best;
+    if (!snapshot.lines.empty()) best = snapshot.lines.front().move;
+    for (int rank = Board::Size - 1; rank >= 0; --rank) {
+        int row = BoardTop + Board::Size - 1 - rank;
+        screen.print(row, 0, std::format("{}", rank + 1), Label);
+        for (int file = 0; file < Board::Size; ++file) {
+            bool light = (rank + file) % 2 != 0;
+            bool marked = best && ((best->from_rank == rank && best->from_file == file) ||
+                                   (best->to_rank == rank && best->to_file == file));
+            CellStyle style{ 232, static_cast<int16_t>(marked ? (light ? 186 : 143) : (light ? 230 : 101)), false };
+            const auto& square = board.at(rank, file);
+            int col = screen.print(row, 2 + 2 * file, square ? piece_glyph(*square) : " ", style);
+            screen.print(row, col, " ", style);
+        }
+    }
+    screen.print(BoardTop + Board::Size, 2, "a b c d e f g h", Label);
+}
+
+void draw_graph(ScreenBuffer& screen, const std::vector<int>& scores) {
+    screen.print(GraphTop - 1, PanelCol, std::format("Eval by depth, {} to {}", format_score(-GraphRange),
+                                                     format_score(GraphRange)), Label);
+    // Bars grow from the bottom; half the height is the zero line.
+    int columns = std::min<int>(static_cast<int>(scores.size()), ScreenCols - PanelCol);
+    for (int i = 0; i < columns; ++i) {
+        int score = std::clamp(scores[i], -GraphRange, GraphRange);
+        int height = (score + GraphRange) * GraphRows * 8 / (2 * GraphRange);
+        CellStyle style{ static_cast<int16_t>(score >= 0 ? 34 : 160), -1, false };
+        for (int level = 0; level < GraphRows; ++level) {
+            int fill = std::clamp(height - level * 8, 0, 8);
+            if (fill) screen.print(GraphTop + GraphRows - 1 - level, PanelCol + i, eighths[fill - 1], style);
+        }
+    }
+}
+
+void draw(ScreenBuffer& screen, const Board& board, const LiveOptions& options, const Snapshot& snapshot,
+          const Progress& progress) {
+    screen.clear();
+    screen.print(0, 0, std::format("Live analysis  {}", board.to_fen()), Title);
+    draw_board(screen, board, snapshot);
+
+    int max_depth = std::clamp(options.limits.depth, 1, SearchLimits::MaxDepth);
+    uint64_t nps = progress.seconds > 0 ? static_cast<uint64_t>(progress.nodes / progress.seconds) : 0;
+    std::string eval = snapshot.scores.empty() ? "-" : format_score(snapshot.scores.back());
+    const std::pair<const char*, std::string> fields[] = {
+        { "Depth", std::format("{}/{}", snapshot.depth, max_depth) },
+        { "Nodes", std::format("{}", progress.nodes) },
+        { "NPS", std::format("{}", nps) },
+        { "Time", std::format("{:.1f} s", progress.seconds) },
+        { "Eval", eval },
+        { "Threads", std::format("{}", options.threads) },
+    };
+    int row = BoardTop;
+    for (const auto& [label, value] : fields) {
+        screen.print(row, PanelCol, label, Label);
+        screen.print(row++, PanelCol + 9, value);
+    }
+    draw_graph(screen, snapshot.scores);
+
+    screen.print(LinesTop - 1, 0, "Best lines", Label);
+    Color side = board.get_side_to_move();
+    for (size_t i = 0; i < snapshot.lines.size() && LinesTop + static_cast<int>(i) < StatusRow - 1; ++i) {
+        const RootLine& line = snapshot.lines[i];
+        int white_score = side == Color::White ? line.score : -line.score;
+        screen.print(LinesTop + static_cast<int>(i), 0,
+                     std::format("{}. {:>6}  {}", i + 1, format_score(white_score), san_line(board, line.pv)));
+    }
+
+    if (!snapshot.done) {
+        screen.print(StatusRow, 0, "Searching, Ctrl-C stops", Label);
+    } else if (!snapshot.lines.empty()) {
+        screen.print(StatusRow, 0, std::format("Best move {}", move_to_san(board, snapshot.lines.front().move)), Title);
+    }
+}
+
+} // namespace
+
+std::optional<LiveOptions> parse_live_args(const std::vector<std::string>& args) {
+    LiveOptions options;
+    options.limits.depth = SearchLimits::MaxDepth;
+    try {
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if (arg == "--fen" && has_value) options.fen = args[++i];
+            else if (arg == "--moves") { while (i + 1 < args.size() && !args[i + 1].starts_with("--")) options.moves.push_back(args[++i]); }
+            else if (arg == "--depth" && has_value) options.limits.depth = std::stoi(args[++i]);
+            else if (arg == "--nodes" && has_value) options.limits.nodes = std::stoull(args[++i]);
+            else if (arg == "--movetime" && has_value) options.limits.movetime_ms = std::stoll(args[++i]);
+            else if (arg == "--threads" && has_value) options.threads = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--hash" && has_value) options.hash_mb = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--multipv" && has_value) options.multi_pv = std::clamp(std::stoi(args[++i]), 1, StatusRow - 1 - LinesTop);
+            else if (arg == "--refresh" && has_value) options.refresh_ms = std::max(10, std::stoi(args[++i]));
+            else return std::nullopt;
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    return options;
+}
+
+int run_live(const LiveOptions& options) {
+    Board board;
+    if (options.fen != "startpos" && !board.set_fen(options.fen)) {
+        std::println(stderr, "Invalid FEN {}", options.fen);
+        return 1;
+    }
+    std::vector<uint64_t> history;
+    for (const std::string& text : options.moves) {
+        auto move = parse_move(board, text);
+        if (!move) {
+            std::println(stderr, "Illegal move {}", text);
+            return 1;
+        }
+        history.push_back(zobrist_key(board));
+        apply_move(board, *move);
+    }
+    Color side = board.get_side_to_move();
+    auto legal = generate_legal_moves(&board, side);
+    if (!legal || legal->empty()) {
+        std::println(stderr, "No legal moves in this position");
+        return 1;
+    }
+
+    TranspositionTable tt(options.hash_mb);
+    MoveSelector selector(options.threads);
+    selector.set_transposition_table(&tt);
+    selector.set_multi_pv(options.multi_pv);
+    selector.set_game_history(std::move(history));
+
+    SearchFeed feed;
+    selector.set_iteration_callback([&](int depth, const std::vector<RootLine>& lines, const SearchStats&) {
+        int score = lines.empty() ? 0 : lines.front().score;
+        feed.publish(depth, lines, side == Color::White ? score : -score);
+    });
+
+    std::atomic<bool> stop{ false };
+    std::atomic<uint64_t> nodes{ 0 };
+    SearchLimits limits = options.limits;
+    limits.stop = &stop;
+    limits.nodes_searched = &nodes;
+
+    enable_vt_output();
+    std::signal(SIGINT, on_interrupt);
+    std::fputs("\033[?25l", stdout);  // hide the cursor while drawing
+
+    auto start = Clock::now();
+    std::thread view([&] {
+        ScreenBuffer screen(ScreenRows, ScreenCols);
+        std::string out;
+        while (true) {
+            Snapshot snapshot = feed.wait(std::chrono::milliseconds(options.refresh_ms));
+            if (interrupted) stop.store(true);
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            draw(screen, board, options, snapshot, { nodes.load(std::memory_order_relaxed), seconds });
+            out.clear();
+            screen.flush(out);
+            if (!out.empty()) {
+                std::fwrite(out.data(), 1, out.size(), stdout);
+                std::fflush(stdout);
+            }
+            if (snapshot.done) break;
+        }
+    });
+
+    selector.search(board, side, limits);
+    feed.finish();
+    view.join();
+    std::signal(SIGINT, SIG_DFL);
+
+    std::print("\033[{};1H\033[0m\033[?25h", ScreenRows + 1);
+    std::fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+#include "Eval.h"
+
+struct LiveOptions {
+    std::string fen = "startpos";    // "startpos" or a FEN
+    std::vector<std::string> moves;  // played from `fen` before the search
+    SearchLimits limits;             // depth defaults to SearchLimits::MaxDepth
+    int threads = 1;
+    size_t hash_mb = 64;
+    int multi_pv = 3;
+    int refresh_ms = 100;            // least time between two repaints
+};
+
+// Parses the arguments following "live" on the command line.
+std::optional<LiveOptions> parse_live_args(const std::vector<std::string>& args);
+
+// Searches the position while a full-screen view shows the board, the best
+// lines, depth, nodes per second and the evaluation of every completed
+// depth. The view runs on its own thread and only reads what the search
+// publishes after each iteration plus its node counter, so the search never
+// waits for the terminal. At most one frame is drawn per refresh interval,
+// and only the changed cells are sent. Ctrl-C stops the search.
+int run_live(const LiveOptions& options);
@@ -3,23 +3,200 @@
 #include <fstream>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <iomanip>
+#include <atomic>
+#include <array>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <bit>
+#include <cstring>
 
 enum class LogLevel { Info, Warning, Error, Debug };
 
 class Logger {
 public:
-    Logger(std::ostream& out = std::clog) : out_(out) {}
+    Logger(std::ostream& out = std::clog) : out_(out), id_(next_id()) {}
+    ~Logger() { stop_async(); }
 
-    void log(const std::string& msg, LogLevel level = LogLevel::Info) {
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Messages below this severity are dropped before any formatting.
+    void set_min_level(LogLevel level) { min_severity_.store(severity(level), std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const { return severity(level) >= min_severity_.load(std::memory_order_relaxed); }
+
+    void log(std::string_view msg, LogLevel level = LogLevel::Info) {
+        if (!enabled(level)) return;
+        if (async_.load(std::memory_order_acquire)) {
+            log_async(msg, level);
+            return;
+        }
         std::lock_guard<std::mutex> lock(mutex_);
-        out_ << "[" << timestamp() << "] " << to_string(level) << ": " << msg << std::endl;
+        out_ << "[" << timestamp(std::chrono::system_clock::now()) << "] " << to_string(level) << ": " << msg << std::endl;
+    }
+
+    // Async mode: log() copies the message into a per-thread lock-free ring
+    // and returns; a background thread formats and writes batches to `path`.
+    // When a ring is full the record is dropped and counted, never blocking.
+    // Messages longer than MaxMessage bytes are cut and end in "..." in the file.
+    bool start_async(const std::string& path, size_t ring_capacity = 1024) {
+        stop_async();
+        file_.open(path, std::ios::app);
+        if (!file_) return false;
+        ring_capacity_ = std::bit_ceil(std::max<size_t>(ring_capacity, 16));
+        writer_ = std::jthread([this](std::stop_token st) { writer_loop(st); });
+        async_.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void stop_async() {
+        if (!async_.exchange(false)) return;
+        writer_.request_stop();
+        writer_.join();
+        file_.close();
     }
 
 private:
+    static constexpr size_t MaxMessage = 240;
+
+    struct Record {
+        std::chrono::system_clock::time_point time;
+        LogLevel level;
+        uint16_t length;
+        bool truncated;
+        char text[MaxMessage];
+    };
+
+    // Single-producer (owning thread) / single-consumer (writer) ring.
+    struct Ring {
+        explicit Ring(size_t capacity) : records(capacity), mask(capacity - 1) {}
+        std::vector<Record> records;
+        size_t mask;
+        alignas(64) std::atomic<size_t> head{0}; // next slot to write (producer)
+        alignas(64) std::atomic<size_t> tail{0}; // next slot to read (writer)
+        std::atomic<uint64_t> dropped{0};
+        uint64_t dropped_reported = 0;           // writer-only
+    };
+
     std::ostream& out_;
     std::mutex mutex_;
+    const uint64_t id_;
+    std::atomic<int> min_severity_{0};
+
+    std::atomic<bool> async_{false};
+    size_t ring_capacity_ = 1024;
+    std::mutex rings_mutex_;                  // registration only, never on the log path
+    std::vector<std::unique_ptr<Ring>> rings_;
+    std::ofstream file_;
+    std::jthread writer_;
+
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+
+    static int severity(LogLevel level) {
+        switch (level) {
+            case LogLevel::Debug: return 0;
+            case LogLevel::Info: return 1;
+            case LogLevel::Warning: return 2;
+            case LogLevel::Error: return 3;
+        }
+        return 1;
+    }
+
+    // Ring owned by the calling thread, created on its first async log.
+    Ring& thread_ring() {
+        thread_local std::vector<std::pair<uint64_t, Ring*>> cache;
+        for (auto& [id, ring] : cache) {
+            if (id == id_) return *ring;
+        }
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.push_back(std::make_unique<Ring>(ring_capacity_));
+        cache.emplace_back(id_, rings_.back().get());
+        return *rings_.back();
+    }
+
+    void log_async(std::string_view msg, LogLevel level) {
+        Ring& ring = thread_ring();
+        size_t head = ring.head.load(std::memory_order_relaxed);
+        if (head - ring.tail.load(std::memory_order_acquire) > ring.mask) {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Record& rec = ring.records[head & ring.mask];
+        rec.time = std::chrono::system_clock::now();
+        rec.level = level;
+        rec.length = static_cast<uint16_t>(std::min(msg.size(), MaxMessage));
+        rec.truncated = msg.size() > MaxMessage;
+        std::memcpy(rec.text, msg.data(), rec.length);
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    void writer_loop(std::stop_token st) {
+        std::string batch;
+        std::vector<Ring*> rings;
+        while (true) {
+            bool stopping = st.stop_requested();
+            {
+                std::lock_guard<std::mutex> lock(rings_mutex_);
+                rings.clear();
+                for (auto& r : rings_) rings.push_back(r.get());
+            }
+            for (Ring* ring : rings) drain(*ring, batch);
+            if (!batch.empty()) {
+                file_.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+                file_.flush();
+                batch.clear();
+            }
+            if (stopping) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+
+    void drain(Ring& ring, std::string& batch) {
+        size_t tail = ring.tail.load(std::memory_order_relaxed);
+        size_t head = ring.head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            const Record& rec = ring.records[tail & ring.mask];
+            append_line(batch, rec.time, rec.level, std::string_view(rec.text, rec.length));
+            if (rec.truncated) batch.insert(batch.size() - 1, "...");
+        }
+        ring.tail.store(tail, std::memory_order_release);
+
+        uint64_t dropped = ring.dropped.load(std::memory_order_relaxed);
+        if (dropped != ring.dropped_reported) {
+            append_line(batch, std::chrono::system_clock::now(), LogLevel::Warning,
+                        "dropped " + std::to_string(dropped - ring.dropped_reported) + " log records (ring full)");
+            ring.dropped_reported = dropped;
+        }
+    }
+
+    void append_line(std::string& batch, std::chrono::system_clock::time_point time, LogLevel level, std::string_view msg) {
+        batch += '[';
+        batch += cached_timestamp(time);
+        batch += "] ";
+        batch += to_string(level);
+        batch += ": ";
+        batch += msg;
+        batch += '\n';
+    }
+
+    // strftime once per second on the writer thread.
+    const std::string& cached_timestamp(std::chrono::system_clock::time_point time) {
+        static thread_local std::time_t cached_second = 0;
+        static thread_local std::string cached;
+        std::time_t second = std::chrono::system_clock::to_time_t(time);
+        if (second != cached_second || cached.empty()) {
+            cached = timestamp(time);
+            cached_second = second;
+        }
+        return cached;
+    }
 
     static std::string to_string(LogLevel level) {
         switch (level) {
@@ -31,9 +208,8 @@ private:
         return "UNK";
     }
 
-    static std::string timestamp() {
+    static std::string timestamp(std::chrono::system_clock::time_point now) {
         using namespace std::chrono;
-        auto now = system_clock::now();
         auto itt = system_clock::to_time_t(now);
         std::tm tm;
 #ifdef _WIN32
@@ -45,4 +221,4 @@ private:
         std::strftime(buf, sizeof(buf), "%F %T", &tm);
         return buf;
     }
-};
\ No newline at end of file
+};
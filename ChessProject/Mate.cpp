@@ -0,0 +1,192 @@
+#include "Mate.h"
+#include "MoveGen.h"
+#include "Zobrist.h"
+#include <algorithm>
+#include <bit>
+
+namespace {
+
+// Proof or disproof number of a decided node. Sums saturate here, so the
+// search never sees a value past it.
+constexpr uint32_t Infinite = 1u << 30;
+
+} // namespace
+
+MateSearch::MateSearch(size_t megabytes) {
+    resize(megabytes);
+}
+
+void MateSearch::resize(size_t megabytes) {
+    size_t entries = std::max<size_t>(megabytes, 1) * 1024 * 1024 / sizeof(Entry);
+    entries = std::bit_floor(entries);
+    table_.assign(entries, Entry{});
+    mask_ = entries - 1;
+}
+
+void MateSearch::clear() {
+    std::fill(table_.begin(), table_.end(), Entry{});
+}
+
+// The same position is a different node for every number of plies left, so
+// the slot and the check include both.
+MateSearch::Numbers MateSearch::lookup(uint64_t key, int remaining) const {
+    const Entry& entry = table_[(key ^ (remaining * 0x9E3779B97F4A7C15ull)) & mask_];
+    if (entry.key == key && entry.remaining == remaining) return entry.numbers;
+    return Numbers{ 1, 1 };
+}
+
+void MateSearch::store(uint64_t key, int remaining, Numbers numbers) {
+    Entry& entry = table_[(key ^ (remaining * 0x9E3779B97F4A7C15ull)) & mask_];
+    entry.key = key;
+    entry.remaining = static_cast<int16_t>(remaining);
+    entry.numbers = numbers;
+}
+
+bool MateSearch::out_of_budget() {
+    if (options_.nodes && nodes_ >= options_.nodes) aborted_ = true;
+    // The clock is only read every 1024 nodes.
+    if (options_.movetime_ms > 0 && (nodes_ & 1023) == 0 && std::chrono::steady_clock::now() >= deadline_) aborted_ = true;
+    return aborted_;
+}
+
+// Legal moves with the resulting positions. The attacker's checks come first,
+// or are the only moves with checks_only, since df-pn breaks ties in order.
+std::vector<MateSearch::Child> MateSearch::children(const Board& board, bool attacker) const {
+    std::vector<Child> result;
+    auto moves = generate_legal_moves(&board, board.get_side_to_move());
+    if (!moves) return result;
+    result.reserve(moves->size());
+    for (const Move& move : *moves) {
+        Board next = board;
+        apply_move(next, move);
+        result.push_back(Child{ move, next, zobrist_key(next) });
+    }
+    if (attacker) {
+        auto gives_check = [](const Child& child) { return king_in_check(child.board, child.board.get_side_to_move()); };
+        if (options_.checks_only) {
+            std::erase_if(result, [&](const Child& child) { return !gives_check(child); });
+        } else {
+            std::stable_partition(result.begin(), result.end(), gives_check);
+        }
+    }
+    return result;
+}
+
+// Multiple iterative deepening step of df-pn: expands the node until its
+// phi or delta reaches the threshold, always descending into the child with
+// the smallest delta, then stores the new numbers.
+void MateSearch::mid(const Board& board, uint64_t key, int remaining, bool attacker, uint32_t th_phi, uint32_t th_delta) {
+    Numbers current = lookup(key, remaining);
+    if (current.phi >= th_phi || current.delta >= th_delta) return;
+    ++nodes_;
+    if (out_of_budget()) return;
+
+    auto moves = children(board, attacker);
+    if (moves.empty() || remaining == 0) {
+        bool mover_wins;
+        if (attacker) mover_wins = false;                         // no (checking) move or out of plies
+        else if (moves.empty()) mover_wins = !king_in_check(board, board.get_side_to_move()); // stalemate
+        else mover_wins = true;                                   // survived the last attacking move
+        store(key, remaining, mover_wins ? Numbers{ 0, Infinite } : Numbers{ Infinite, 0 });
+        return;
+    }
+
+    while (true) {
+        // phi is the smallest child delta, delta the sum of the child phis.
+        uint32_t phi = Infinite, second_delta = Infinite, best_phi = 0;
+        uint64_t delta = 0;
+        size_t best = 0;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            Numbers child = lookup(moves[i].key, remaining - 1);
+            if (child.delta < phi) {
+                second_delta = phi;
+                phi = child.delta;
+                best = i;
+                best_phi = child.phi;
+            } else if (child.delta < second_delta) {
+                second_delta = child.delta;
+            }
+            delta += child.phi;
+        }
+        delta = std::min<uint64_t>(delta, Infinite);
+
+        if (phi >= th_phi || delta >= th_delta) {
+            store(key, remaining, Numbers{ phi, static_cast<uint32_t>(delta) });
+            return;
+        }
+        uint32_t child_th_phi = static_cast<uint32_t>(th_delta + best_phi - delta);
+        uint32_t child_th_delta = std::min(th_phi, second_delta + 1);
+        mid(moves[best].board, moves[best].key, remaining - 1, !attacker, child_th_phi, child_th_delta);
+        if (aborted_) return;
+    }
+}
+
+MateSearch::Numbers MateSearch::solve(const Board& board, int remaining, bool attacker) {
+    uint64_t key = zobrist_key(board);
+    mid(board, key, remaining, attacker, Infinite, Infinite);
+    return lookup(key, remaining);
+}
+
+// Replays a proven mate of `plies` plies. The attacker plays any move that
+// keeps the mate within the remaining plies, the defender the reply after
+// which the shortest mate is longest.
+std::vector<Move> MateSearch::mating_line(const Board& board, int plies) {
+    std::vector<Move> line;
+    Board position = board;
+    int remaining = plies;
+    while (remaining > 0) {
+        auto attacks = children(position, true);
+        auto mating = std::find_if(attacks.begin(), attacks.end(),
+            [&](const Child& child) { return solve(child.board, remaining - 1, false).delta == 0; });
+        if (mating == attacks.end()) break;
+        line.push_back(mating->move);
+        position = mating->board;
+        --remaining;
+
+        auto replies = children(position, false);
+        const Child* longest = nullptr;
+        int longest_plies = 0;
+        for (const Child& reply : replies) {
+            for (int k = 1; k < remaining; k += 2) {
+                if (solve(reply.board, k, true).phi == 0) {
+                    if (k > longest_plies) {
+                        longest = &reply;
+                        longest_plies = k;
+                    }
+                    break;
+                }
+            }
+        }
+        if (!longest) break; // checkmate
+        line.push_back(longest->move);
+        position = longest->board;
+        remaining = longest_plies;
+    }
+    return line;
+}
+
+MateResult MateSearch::find(const Board& board, const MateOptions& options) {
+    auto start_time = std::chrono::steady_clock::now();
+    options_ = options;
+    nodes_ = 0;
+    aborted_ = false;
+    deadline_ = start_time + std::chrono::milliseconds(options.movetime_ms);
+
+    MateResult result;
+    for (int moves = 1; moves <= options.max_moves; ++moves) {
+        Numbers root = solve(board, 2 * moves - 1, true);
+        if (aborted_) break;
+        if (root.phi == 0) {
+            result.moves = moves;
+            // The proof is complete, so the line is replayed without a budget.
+            options_.nodes = 0;
+            options_.movetime_ms = 0;
+            result.line = mating_line(board, 2 * moves - 1);
+            break;
+        }
+    }
+    result.nodes = nodes_;
+    result.aborted = aborted_;
+    result.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    return result;
+}
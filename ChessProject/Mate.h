@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Board.h"
+#include "Move.h"
+
+// Forced mate search for "go mate N" and puzzle workloads. Uses depth-first
+// proof-number search (df-pn) with its own hash table instead of the minimax
+// search, so forcing lines are followed first and quiet defences cost one
+// proof number each instead of a full subtree.
+
+struct MateOptions {
+    int max_moves = 3;          // Longest mate looked for, in moves of the side to move
+    bool checks_only = false;   // The attacking side only considers checking moves
+    uint64_t nodes = 0;         // Node budget, 0 = unlimited
+    int64_t movetime_ms = 0;    // Time budget, 0 = unlimited
+};
+
+struct MateResult {
+    int moves = 0;              // Mate in `moves`, 0 when no mate was proven
+    std::vector<Move> line;     // Attacker and defender moves ending in mate
+    uint64_t nodes = 0;
+    double elapsed_ms = 0.0;
+    bool aborted = false;       // The budget ran out before every length was decided
+};
+
+class MateSearch {
+public:
+    explicit MateSearch(size_t megabytes = 16);
+
+    void resize(size_t megabytes);
+    void clear();
+
+    // Finds the shortest forced mate for the side to move of at most
+    // options.max_moves moves. Mate lengths are tried from 1 upward; the
+    // defender's moves in the returned line delay the mate the longest.
+    MateResult find(const Board& board, const MateOptions& options);
+
+private:
+    // Proof and disproof numbers from the side to move's point of view:
+    // phi == 0 means the side to move reaches its goal (mate for the
+    // attacker, survival for the defender), delta == 0 that it fails.
+    struct Numbers {
+        uint32_t phi;
+        uint32_t delta;
+    };
+
+    struct Entry {
+        uint64_t key = 0;
+        int16_t remaining = -1; // plies left, -1 for an empty slot
+        Numbers numbers{};
+    };
+
+    struct Child {
+        Move move;
+        Board board;
+        uint64_t key;
+    };
+
+    std::vector<Entry> table_;
+    size_t mask_ = 0;
+    MateOptions options_;
+    uint64_t nodes_ = 0;
+    bool aborted_ = false;
+    std::chrono::steady_clock::time_point deadline_{};
+
+    Numbers lookup(uint64_t key, int remaining) const;
+    void store(uint64_t key, int remaining, Numbers numbers);
+    bool out_of_budget();
+
+    std::vector<Child> children(const Board& board, bool attacker) const;
+    void mid(const Board& board, uint64_t key, int remaining, bool attacker, uint32_t th_phi, uint32_t th_delta);
+    Numbers solve(const Board& board, int remaining, bool attacker);
+    std::vector<Move> mating_line(const Board& board, int plies);
+};
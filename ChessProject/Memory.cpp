@@ -0,0 +1,249 @@
+#include "Memory.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+size_t round_up(size_t bytes, size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+#ifdef _WIN32
+// Large pages need SeLockMemoryPrivilege, which the account must hold and the
+// process must enable. Returns the large page size, or 0 when unavailable.
+size_t enable_large_pages() {
+    static const size_t page_size = [] {
+        size_t minimum = GetLargePageMinimum();
+        if (minimum == 0) return size_t{ 0 };
+        HANDLE token;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) return size_t{ 0 };
+        TOKEN_PRIVILEGES privileges{};
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        bool enabled = LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) &&
+                       AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+                       GetLastError() == ERROR_SUCCESS;
+        CloseHandle(token);
+        return enabled ? minimum : size_t{ 0 };
+    }();
+    return page_size;
+}
+#else
+// Parses a sysfs CPU or node list such as "0-7,16-23".
+std::vector<int> parse_cpu_list(std::string_view text) {
+    std::vector<int> cpus;
+    while (!text.empty()) {
+        size_t comma = text.find(',');
+        std::string_view range = text.substr(0, comma);
+        text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+        size_t dash = range.find('-');
+        int first = std::atoi(std::string(range.substr(0, dash)).c_str());
+        int last = dash == std::string_view::npos ? first : std::atoi(std::string(range.substr(dash + 1)).c_str());
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+#endif
+
+// CPUs of each NUMA node that has any, read once.
+const std::vector<std::vector<int>>& node_cpus() {
+    static const std::vector<std::vector<int>> nodes = [] {
+        std::vector<std::vector<int>> result;
+#ifdef _WIN32
+        ULONG highest = 0;
+        if (GetNumaHighestNodeNumber(&highest)) {
+            for (USHORT node = 0; node <= highest; ++node) {
+                GROUP_AFFINITY affinity{};
+                if (!GetNumaNodeProcessorMaskEx(node, &affinity) || affinity.Mask == 0) continue;
+                // Windows binds through the group mask; keep the node number only.
+                result.push_back({ node });
+            }
+        }
+#else
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string line;
+        if (!online || !std::getline(online, line)) return result;
+        for (int node : parse_cpu_list(line)) {
+            std::ifstream in(std::format("/sys/devices/system/node/node{}/cpulist", node));
+            if (!in || !std::getline(in, line)) continue;
+            auto cpus = parse_cpu_list(line);
+            if (!cpus.empty()) result.push_back(std::move(cpus));
+        }
+#endif
+        return result;
+    }();
+    return nodes;
+}
+
+thread_local int bound_node = -1;
+
+} // namespace
+
+LargeBuffer::LargeBuffer(size_t bytes) : bytes_(bytes) {
+    if (bytes == 0) return;
+#ifdef _WIN32
+    if (size_t large = enable_large_pages(); large && bytes >= large) {
+        mapped_ = round_up(bytes, large);
+        data_ = VirtualAlloc(nullptr, mapped_, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (data_) {
+            pages_ = Pages::Huge;
+            return;
+        }
+    }
+    mapped_ = bytes;
+    data_ = VirtualAlloc(nullptr, mapped_, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!data_) throw std::bad_alloc();
+#else
+    if (bytes >= HugePageSize) {
+        mapped_ = round_up(bytes, HugePageSize);
+#ifdef MAP_HUGETLB
+        void* huge = mmap(nullptr, mapped_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (huge != MAP_FAILED) {
+            data_ = huge;
+            pages_ = Pages::Huge;
+            return;
+        }
+#endif
+        // No reserved huge pages: map regular pages aligned to 2 MB and ask for
+        // transparent huge pages, which the kernel assembles on first touch.
+        size_t reserve = mapped_ + HugePageSize;
+        void* raw = mmap(nullptr, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        auto address = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = round_up(address, HugePageSize);
+        if (aligned > address) munmap(raw, aligned - address);
+        munmap(reinterpret_cast<void*>(aligned + mapped_), address + reserve - (aligned + mapped_));
+        data_ = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+        if (madvise(data_, mapped_, MADV_HUGEPAGE) == 0) pages_ = Pages::Transparent;
+#endif
+        return;
+    }
+    mapped_ = bytes;
+    data_ = mmap(nullptr, mapped_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data_ == MAP_FAILED) {
+        data_ = nullptr;
+        throw std::bad_alloc();
+    }
+#endif
+}
+
+LargeBuffer::~LargeBuffer() {
+    release();
+}
+
+LargeBuffer::LargeBuffer(LargeBuffer&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), bytes_(std::exchange(other.bytes_, 0)),
+      mapped_(std::exchange(other.mapped_, 0)), pages_(std::exchange(other.pages_, Pages::Regular)) {}
+
+LargeBuffer& LargeBuffer::operator=(LargeBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = std::exchange(other.data_, nullptr);
+        bytes_ = std::exchange(other.bytes_, 0);
+        mapped_ = std::exchange(other.mapped_, 0);
+        pages_ = std::exchange(other.pages_, Pages::Regular);
+    }
+    return *this;
+}
+
+void LargeBuffer::release() {
+    if (!data_) return;
+#ifdef _WIN32
+    VirtualFree(data_, 0, MEM_RELEASE);
+#else
+    munmap(data_, mapped_);
+#endif
+    data_ = nullptr;
+}
+
+std::string LargeBuffer::page_description() const {
+    switch (pages_) {
+        case Pages::Huge:
+#ifdef _WIN32
+            return std::format("{} MB large pages", enable_large_pages() / (1024 * 1024));
+#else
+            return std::format("{} MB huge pages", HugePageSize / (1024 * 1024));
+#endif
+        case Pages::Transparent: return "transparent huge pages";
+        case Pages::Regular: break;
+    }
+#ifdef _WIN32
+    return "4 KB pages";
+#else
+    return std::format("{} KB pages", sysconf(_SC_PAGESIZE) / 1024);
+#endif
+}
+
+int numa_node_count() {
+    return std::max<int>(1, static_cast<int>(node_cpus().size()));
+}
+
+int bind_thread_to_node(int index) {
+    const auto& nodes = node_cpus();
+    if (nodes.size() < 2) return -1;
+    int node = index % static_cast<int>(nodes.size());
+#ifdef _WIN32
+    GROUP_AFFINITY affinity{};
+    if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(nodes[node][0]), &affinity) ||
+        !SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr)) {
+        return -1;
+    }
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : nodes[node]) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) return -1;
+#endif
+    bound_node = node;
+    return node;
+}
+
+int current_thread_node() {
+    return bound_node;
+}
+
+void for_each_chunk_on_nodes(size_t count, size_t total_bytes, const std::function<void(size_t, size_t)>& body) {
+    // Enough threads to cover every node, and more for big tables since
+    // zeroing them is bound by page faults, not memory bandwidth.
+    size_t threads = std::max<size_t>(numa_node_count(), total_bytes / (64 * 1024 * 1024));
+    threads = std::clamp<size_t>(threads, 1, std::max(1u, std::thread::hardware_concurrency()));
+    if (threads == 1) {
+        body(0, count);
+        return;
+    }
+    std::vector<std::jthread> pool;
+    for (size_t i = 0; i < threads; ++i) {
+        pool.emplace_back([&, i] {
+            bind_thread_to_node(static_cast<int>(i));
+            body(count * i / threads, count * (i + 1) / threads);
+        });
+    }
+}
+
+std::string numa_description() {
+    int nodes = numa_node_count();
+    if (nodes == 1) return "NUMA: 1 node, threads not bound";
+    return std::format("NUMA: {} nodes, search threads bound round-robin", nodes);
+}
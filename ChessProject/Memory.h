@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// Large page allocation and NUMA placement for the big tables and the search
+// threads. Everything falls back to plain allocation and an unbound thread
+// when the host or the OS does not support it.
+
+// Zero-filled memory for a large table. Tries, in order: explicit huge pages
+// (MAP_HUGETLB, or MEM_LARGE_PAGES with the lock-memory privilege on Windows),
+// then 2 MB aligned memory marked for transparent huge pages, then regular
+// pages. Move-only; frees the memory on destruction.
+class LargeBuffer {
+public:
+    enum class Pages { Regular, Transparent, Huge };
+
+    LargeBuffer() = default;
+    explicit LargeBuffer(size_t bytes);
+    ~LargeBuffer();
+    LargeBuffer(LargeBuffer&& other) noexcept;
+    LargeBuffer& operator=(LargeBuffer&& other) noexcept;
+    LargeBuffer(const LargeBuffer&) = delete;
+    LargeBuffer& operator=(const LargeBuffer&) = delete;
+
+    void* data() const { return data_; }
+    size_t size() const { return bytes_; }
+    Pages pages() const { return pages_; }
+    // e.g. "2 MB huge pages", "transparent huge pages", "4 KB pages"
+    std::string page_description() const;
+
+private:
+    void* data_ = nullptr;
+    size_t bytes_ = 0;       // requested size
+    size_t mapped_ = 0;      // size actually allocated
+    Pages pages_ = Pages::Regular;
+
+    void release();
+};
+
+// Number of NUMA nodes with CPUs, 1 when the host is not NUMA.
+int numa_node_count();
+
+// Restricts the calling thread to the CPUs of node `index % numa_node_count()`
+// so that memory it touches first is allocated there. Returns the node, or -1
+// on single-node hosts where threads are left to the scheduler.
+int bind_thread_to_node(int index);
+
+// The node the calling thread was last bound to by bind_thread_to_node, or
+// -1 if it never was. Threads started by a bound thread use it to stay on
+// that node.
+int current_thread_node();
+
+// Runs body(begin, end) over [0, count) split into chunks, one thread per
+// chunk, each thread bound to a node in turn. Used to first-touch shared
+// tables of `total_bytes` so their pages are spread over all nodes.
+void for_each_chunk_on_nodes(size_t count, size_t total_bytes, const std::function<void(size_t, size_t)>& body);
+
+// One line for the startup log, e.g. "NUMA: 2 nodes, search threads bound round-robin".
+std::string numa_description();
@@ -1,4 +1,5 @@
 #include "Move.h"
+#include <cctype>
 
 Move::Move(int fr, int ff, int tr, int tf, MoveType t, std::optional<PieceType> promo)
     : from_rank(fr), from_file(ff), to_rank(tr), to_file(tf), type(t), promotion(promo) {}
@@ -22,4 +23,10 @@ std::string Move::to_algebraic(const Board& /*board*/) const {
         move_str += promo_char;
     }
     return move_str;
+}
+
+std::string uci_move(const Board& board, const Move& move) {
+    std::string text = move.to_algebraic(board);
+    for (char& c : text) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return text;
 }
\ No newline at end of file
@@ -15,4 +15,7 @@ public:
     Move(int fr, int ff, int tr, int tf, MoveType t, std::optional<PieceType> promo = std::nullopt);
 
     std::string to_algebraic(const Board& board) const;
-};
\ No newline at end of file
+};
+
+// Coordinate notation with a lower case promotion piece, as UCI expects.
+std::string uci_move(const Board& board, const Move& move);
\ No newline at end of file
@@ -1,8 +1,12 @@
 #include "MoveGen.h"
+#include "Attacks.h"
 #include "Move.h"
 #include "Board.h"
 #include <vector>
 #include <expected>
+#include <cctype>
+#include <algorithm>
+#include <cstdlib>
 
 // Helper: Check if a square is on the board
 constexpr bool on_board(int rank, int file) {
@@ -12,6 +16,7 @@ constexpr bool on_board(int rank, int file) {
 // Helper: Apply a move to a board copy (basic, does not handle special moves yet)
 void apply_move(Board& board, const Move& move) {
     auto piece = board.at(move.from_rank, move.from_file);
+    bool irreversible = is_capture_or_pawn_move(board, move);
     board.at(move.from_rank, move.from_file) = std::nullopt;
 
     // Update castling rights if king or rook moves
@@ -62,16 +67,27 @@ void apply_move(Board& board, const Move& move) {
     } else {
         board.at(move.to_rank, move.to_file) = piece;
     }
+
+    board.set_halfmove_clock(irreversible ? 0 : board.get_halfmove_clock() + 1);
+    if (piece) {
+        if (piece->color == Color::Black) board.set_fullmove_number(board.get_fullmove_number() + 1);
+        board.set_side_to_move(piece->color == Color::White ? Color::Black : Color::White);
+    }
 }
 
-// Helper: Check if the king of the given color is in check
-bool king_in_check(const Board& board, Color color) {
+// Helper: Check if the king of color Us is in check
+template <Color Us>
+bool king_in_check(const Board& board) {
+    constexpr Color enemy = opponent(Us);
+    // Enemy pawns attack from the rank in front of the king
+    constexpr int pawn_dir = (Us == Color::White) ? 1 : -1;
+
     // Find king position
     int king_rank = -1, king_file = -1;
-    for (int rank = 0; rank < Board::Size; ++rank) {
+    for (int rank = 0; rank < Board::Size && king_rank == -1; ++rank) {
         for (int file = 0; file < Board::Size; ++file) {
             const auto& sq = board.at(rank, file);
-            if (sq && sq->type == PieceType::King && sq->color == color) {
+            if (sq && sq->type == PieceType::King && sq->color == Us) {
                 king_rank = rank;
                 king_file = file;
                 break;
@@ -80,14 +96,12 @@ bool king_in_check(const Board& board, Color color) {
     }
     if (king_rank == -1) return true; // No king found, treat as in check
 
-    Color enemy = (color == Color::White) ? Color::Black : Color::White;
-
     // Check for knight attacks
-    const int knight_moves[8][2] = {
+    constexpr int knight_moves[8][2] = {
         {2, 1}, {1, 2}, {-1, 2}, {-2, 1},
         {-2, -1}, {-1, -2}, {1, -2}, {2, -1}
     };
-    for (auto [dr, df] : knight_moves) {
+    for (const auto& [dr, df] : knight_moves) {
         int r = king_rank + dr, f = king_file + df;
         if (on_board(r, f)) {
             const auto& sq = board.at(r, f);
@@ -97,7 +111,6 @@ bool king_in_check(const Board& board, Color color) {
     }
 
     // Check for pawn attacks
-    int pawn_dir = (color == Color::White) ? -1 : 1;
     for (int df : {-1, 1}) {
         int r = king_rank + pawn_dir, f = king_file + df;
         if (on_board(r, f)) {
@@ -108,7 +121,7 @@ bool king_in_check(const Board& board, Color color) {
     }
 
     // Check for sliding piece attacks (rook/queen and bishop/queen)
-    const int directions[8][2] = {
+    constexpr int directions[8][2] = {
         {1,0}, {-1,0}, {0,1}, {0,-1}, // Rook/Queen
         {1,1}, {1,-1}, {-1,1}, {-1,-1} // Bishop/Queen
     };
@@ -136,218 +149,415 @@ bool king_in_check(const Board& board, Color color) {
     return false;
 }
 
-// ... your generate_legal_moves implementation ...
-std::expected<std::vector<Move>, std::string>
-generate_legal_moves(const Board* board, Color side_to_move) {
-    std::vector<Move> legal_moves;
+template bool king_in_check<Color::White>(const Board& board);
+template bool king_in_check<Color::Black>(const Board& board);
+
+bool king_in_check(const Board& board, Color color) {
+    return color == Color::White ? king_in_check<Color::White>(board) : king_in_check<Color::Black>(board);
+}
 
-    // Add sliding piece move generation for Bishop, Rook, Queen
-    auto add_sliding_moves = [&](int rank, int file, const int directions[][2], int dir_count, PieceType type) {
-        for (int d = 0; d < dir_count; ++d) {
-            int dr = directions[d][0], df = directions[d][1];
-            int tr = rank + dr, tf = file + df;
-            while (on_board(tr, tf)) {
-                const auto& target = board->at(tr, tf);
-                if (!target) {
-                    Move move(rank, file, tr, tf, MoveType::Normal);
-                    Board test_board = *board;
-                    apply_move(test_board, move);
-                    if (!king_in_check(test_board, side_to_move))
-                        legal_moves.push_back(move);
+namespace {
+
+// Direction tables of the stepping and sliding pieces, indexed by PieceType.
+template <PieceType Type> struct PieceDirections;
+template <> struct PieceDirections<PieceType::Knight> {
+    static constexpr int dirs[8][2] = { {2, 1}, {1, 2}, {-1, 2}, {-2, 1}, {-2, -1}, {-1, -2}, {1, -2}, {2, -1} };
+};
+template <> struct PieceDirections<PieceType::Bishop> {
+    static constexpr int dirs[4][2] = { {1,1}, {1,-1}, {-1,1}, {-1,-1} };
+};
+template <> struct PieceDirections<PieceType::Rook> {
+    static constexpr int dirs[4][2] = { {1,0}, {-1,0}, {0,1}, {0,-1} };
+};
+template <> struct PieceDirections<PieceType::Queen> {
+    static constexpr int dirs[8][2] = { {1,0}, {-1,0}, {0,1}, {0,-1}, {1,1}, {1,-1}, {-1,1}, {-1,-1} };
+};
+template <> struct PieceDirections<PieceType::King> {
+    static constexpr int dirs[8][2] = { {1,0}, {-1,0}, {0,1}, {0,-1}, {1,1}, {1,-1}, {-1,1}, {-1,-1} };
+};
+
+// Keeps a pseudo-legal move of side Us if it does not leave Us in check.
+// King moves, and out of check the moves of the other pieces, are decided
+// from the attack maps; only evasions and en passant are played on a copy
+// and tested.
+template <Color Us>
+void add_if_legal(const Board& board, const AttackInfo& attacks, const Move& move, std::vector<Move>& legal_moves) {
+    constexpr int enemy = static_cast<int>(opponent(Us));
+    if (attacks.king_rank >= 0 && move.type != MoveType::EnPassant) {
+        int king_rank = attacks.king_rank, king_file = attacks.king_file;
+        if (move.from_rank == king_rank && move.from_file == king_file) {
+            if (!(attacks.attacked[enemy] & square_bit(move.to_rank, move.to_file))) legal_moves.push_back(move);
+            return;
+        }
+        if (!attacks.in_check()) {
+            // A pinned piece stays on the line from the king through it.
+            bool free = !(attacks.pinned & square_bit(move.from_rank, move.from_file));
+            int pin_dr = move.from_rank - king_rank, pin_df = move.from_file - king_file;
+            int to_dr = move.to_rank - king_rank, to_df = move.to_file - king_file;
+            if (free || (pin_dr * to_df == pin_df * to_dr && pin_dr * to_dr + pin_df * to_df > 0))
+                legal_moves.push_back(move);
+            return;
+        }
+    }
+    Board test_board = board;
+    apply_move(test_board, move);
+    if (!king_in_check<Us>(test_board))
+        legal_moves.push_back(move);
+}
+
+template <Color Us>
+void add_pawn_moves(const Board& board, const AttackInfo& attacks, int rank, int file, std::vector<Move>& legal_moves) {
+    constexpr int dir = (Us == Color::White) ? 1 : -1;
+    constexpr int start_rank = (Us == Color::White) ? 1 : 6;
+    constexpr int promotion_rank = (Us == Color::White) ? 7 : 0;
+    constexpr PieceType promotions[] = { PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight };
+
+    // Forward move
+    int fwd_rank = rank + dir;
+    if (on_board(fwd_rank, file) && !board.at(fwd_rank, file)) {
+        // Promotion
+        if (fwd_rank == promotion_rank) {
+            for (PieceType promo : promotions)
+                add_if_legal<Us>(board, attacks, Move(rank, file, fwd_rank, file, MoveType::Promotion, promo), legal_moves);
+        } else {
+            add_if_legal<Us>(board, attacks, Move(rank, file, fwd_rank, file, MoveType::Normal), legal_moves);
+        }
+        // Double move from start
+        if (rank == start_rank && !board.at(rank + 2 * dir, file))
+            add_if_legal<Us>(board, attacks, Move(rank, file, rank + 2 * dir, file, MoveType::Normal), legal_moves);
+    }
+    // Captures
+    for (int df : {-1, 1}) {
+        int cap_file = file + df;
+        if (on_board(fwd_rank, cap_file)) {
+            const auto& target = board.at(fwd_rank, cap_file);
+            if (target && target->color != Us) {
+                // Promotion capture
+                if (fwd_rank == promotion_rank) {
+                    for (PieceType promo : promotions)
+                        add_if_legal<Us>(board, attacks, Move(rank, file, fwd_rank, cap_file, MoveType::Promotion, promo), legal_moves);
                 } else {
-                    if (target->color != side_to_move) {
-                        Move move(rank, file, tr, tf, MoveType::Capture);
-                        Board test_board = *board;
-                        apply_move(test_board, move);
-                        if (!king_in_check(test_board, side_to_move))
-                            legal_moves.push_back(move);
-                    }
-                    break; // Blocked by any piece
+                    add_if_legal<Us>(board, attacks, Move(rank, file, fwd_rank, cap_file, MoveType::Capture), legal_moves);
                 }
-                tr += dr;
-                tf += df;
             }
         }
-    };
+    }
+    // En passant
+    if (const auto& ep = board.get_en_passant_target()) {
+        if (fwd_rank == ep->first && std::abs(file - ep->second) == 1)
+            add_if_legal<Us>(board, attacks, Move(rank, file, ep->first, ep->second, MoveType::EnPassant), legal_moves);
+    }
+}
 
+// Knight and king moves: one step in each direction.
+template <Color Us, PieceType Type>
+void add_step_moves(const Board& board, const AttackInfo& attacks, int rank, int file, std::vector<Move>& legal_moves) {
+    for (const auto& [dr, df] : PieceDirections<Type>::dirs) {
+        int tr = rank + dr, tf = file + df;
+        if (!on_board(tr, tf)) continue;
+        const auto& target = board.at(tr, tf);
+        if (!target || target->color != Us)
+            add_if_legal<Us>(board, attacks, Move(rank, file, tr, tf, target ? MoveType::Capture : MoveType::Normal), legal_moves);
+    }
+}
+
+// Bishop, rook and queen moves: rays until the first piece.
+template <Color Us, PieceType Type>
+void add_sliding_moves(const Board& board, const AttackInfo& attacks, int rank, int file, std::vector<Move>& legal_moves) {
+    for (const auto& [dr, df] : PieceDirections<Type>::dirs) {
+        int tr = rank + dr, tf = file + df;
+        while (on_board(tr, tf)) {
+            const auto& target = board.at(tr, tf);
+            if (!target) {
+                add_if_legal<Us>(board, attacks, Move(rank, file, tr, tf, MoveType::Normal), legal_moves);
+            } else {
+                if (target->color != Us)
+                    add_if_legal<Us>(board, attacks, Move(rank, file, tr, tf, MoveType::Capture), legal_moves);
+                break; // Blocked by any piece
+            }
+            tr += dr;
+            tf += df;
+        }
+    }
+}
+
+// Castling to file 6 (kingside) or 2 (queenside). The king may not be in
+// check, pass through check or land in check.
+template <Color Us, bool Kingside>
+void add_castling(const Board& board, const AttackInfo& attacks, std::vector<Move>& legal_moves) {
+    constexpr int rank = (Us == Color::White) ? 0 : 7;
+    constexpr int rook_file = Kingside ? 7 : 0;
+    constexpr int step = Kingside ? 1 : -1;
+    bool right = Us == Color::White ? (Kingside ? board.white_kingside_castle : board.white_queenside_castle)
+                                    : (Kingside ? board.black_kingside_castle : board.black_queenside_castle);
+    if (!right) return;
+    for (int file = 4 + step; file != rook_file; file += step) {
+        if (board.at(rank, file)) return;
+    }
+    const auto& rook = board.at(rank, rook_file);
+    if (!rook || rook->type != PieceType::Rook || rook->color != Us) return;
+
+    uint64_t path = square_bit(rank, 4 + step) | square_bit(rank, 4 + 2 * step);
+    if (attacks.attacked[static_cast<int>(opponent(Us))] & path) return;
+    add_if_legal<Us>(board, attacks, Move(rank, 4, rank, 4 + 2 * step, MoveType::Castling), legal_moves);
+}
+
+template <Color Us>
+void add_king_moves(const Board& board, const AttackInfo& attacks, int rank, int file, std::vector<Move>& legal_moves) {
+    add_step_moves<Us, PieceType::King>(board, attacks, rank, file, legal_moves);
+    if (rank == (Us == Color::White ? 0 : 7) && file == 4 && !attacks.in_check()) {
+        add_castling<Us, true>(board, attacks, legal_moves);
+        add_castling<Us, false>(board, attacks, legal_moves);
+    }
+}
+
+} // namespace
+
+template <Color Us>
+std::expected<std::vector<Move>, std::string> generate_legal_moves(const Board& board) {
+    return generate_legal_moves<Us>(board, compute_attacks(board, Us));
+}
+
+template <Color Us>
+std::expected<std::vector<Move>, std::string> generate_legal_moves(const Board& board, const AttackInfo& attacks) {
+    std::vector<Move> legal_moves;
     for (int rank = 0; rank < Board::Size; ++rank) {
         for (int file = 0; file < Board::Size; ++file) {
-            const auto& sq = board->at(rank, file);
-            if (!sq || sq->color != side_to_move) continue;
-
-            PieceType type = sq->type;
-            // Pawn moves
-            if (type == PieceType::Pawn) {
-                int dir = (side_to_move == Color::White) ? 1 : -1;
-                int start_rank = (side_to_move == Color::White) ? 1 : 6;
-                int promotion_rank = (side_to_move == Color::White) ? 7 : 0;
-
-                // Forward move
-                int fwd_rank = rank + dir;
-                if (on_board(fwd_rank, file) && !board->at(fwd_rank, file)) {
-                    // Promotion
-                    if (fwd_rank == promotion_rank) {
-                        for (PieceType promo : {PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight}) {
-                            Move move(rank, file, fwd_rank, file, MoveType::Promotion, promo);
-                            Board test_board = *board;
-                            apply_move(test_board, move);
-                            if (!king_in_check(test_board, side_to_move))
-                                legal_moves.push_back(move);
-                        }
-                    } else {
-                        Move move(rank, file, fwd_rank, file, MoveType::Normal);
-                        Board test_board = *board;
-                        apply_move(test_board, move);
-                        if (!king_in_check(test_board, side_to_move))
-                            legal_moves.push_back(move);
-                    }
-                    // Double move from start
-                    if (rank == start_rank && !board->at(rank + 2 * dir, file)) {
-                        Move move(rank, file, rank + 2 * dir, file, MoveType::Normal);
-                        Board test_board = *board;
-                        apply_move(test_board, move);
-                        if (!king_in_check(test_board, side_to_move))
-                            legal_moves.push_back(move);
-                    }
-                }
-                // Captures
-                for (int df : {-1, 1}) {
-                    int cap_file = file + df;
-                    if (on_board(fwd_rank, cap_file)) {
-                        const auto& target = board->at(fwd_rank, cap_file);
-                        if (target && target->color != side_to_move) {
-                            // Promotion capture
-                            if (fwd_rank == promotion_rank) {
-                                for (PieceType promo : {PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight}) {
-                                    Move move(rank, file, fwd_rank, cap_file, MoveType::Promotion, promo);
-                                    Board test_board = *board;
-                                    apply_move(test_board, move);
-                                    if (!king_in_check(test_board, side_to_move))
-                                        legal_moves.push_back(move);
-                                }
-                            } else {
-                                Move move(rank, file, fwd_rank, cap_file, MoveType::Capture);
-                                Board test_board = *board;
-                                apply_move(test_board, move);
-                                if (!king_in_check(test_board, side_to_move))
-                                    legal_moves.push_back(move);
-                            }
-                        }
-                    }
-                }
-                // En passant (assuming en_passant_target is a std::optional<std::pair<int, int>>)
-                if (board->get_en_passant_target()) {
-                    int ep_rank = board->get_en_passant_target()->first;
-                    int ep_file = board->get_en_passant_target()->second;
-                    if (fwd_rank == ep_rank && std::abs(file - ep_file) == 1) {
-                        Move move(rank, file, ep_rank, ep_file, MoveType::EnPassant);
-                        Board test_board = *board;
-                        apply_move(test_board, move); // Remove captured pawn in apply_move
-                        if (!king_in_check(test_board, side_to_move))
-                            legal_moves.push_back(move);
-                    }
-                }
+            const auto& sq = board.at(rank, file);
+            if (!sq || sq->color != Us) continue;
+
+            switch (sq->type) {
+                case PieceType::Pawn:   add_pawn_moves<Us>(board, attacks, rank, file, legal_moves); break;
+                case PieceType::Knight: add_step_moves<Us, PieceType::Knight>(board, attacks, rank, file, legal_moves); break;
+                case PieceType::Bishop: add_sliding_moves<Us, PieceType::Bishop>(board, attacks, rank, file, legal_moves); break;
+                case PieceType::Rook:   add_sliding_moves<Us, PieceType::Rook>(board, attacks, rank, file, legal_moves); break;
+                case PieceType::Queen:  add_sliding_moves<Us, PieceType::Queen>(board, attacks, rank, file, legal_moves); break;
+                case PieceType::King:   add_king_moves<Us>(board, attacks, rank, file, legal_moves); break;
             }
-            // Knight moves
-            else if (type == PieceType::Knight) {
-                const int knight_moves[8][2] = {
-                    {2, 1}, {1, 2}, {-1, 2}, {-2, 1},
-                    {-2, -1}, {-1, -2}, {1, -2}, {2, -1}
-                };
-                for (auto [dr, df] : knight_moves) {
-                    int tr = rank + dr, tf = file + df;
-                    if (!on_board(tr, tf)) continue;
-                    const auto& target = board->at(tr, tf);
-                    if (!target || target->color != side_to_move) {
-                        Move move(rank, file, tr, tf, target ? MoveType::Capture : MoveType::Normal);
-                        Board test_board = *board;
-                        apply_move(test_board, move);
-                        if (!king_in_check(test_board, side_to_move))
-                            legal_moves.push_back(move);
-                    }
+        }
+    }
+    return legal_moves;
+}
+
+template std::expected<std::vector<Move>, std::string> generate_legal_moves<Color::White>(const Board& board);
+template std::expected<std::vector<Move>, std::string> generate_legal_moves<Color::Black>(const Board& board);
+template std::expected<std::vector<Move>, std::string> generate_legal_moves<Color::White>(const Board& board,
+                                                                                         const AttackInfo& attacks);
+template std::expected<std::vector<Move>, std::string> generate_legal_moves<Color::Black>(const Board& board,
+                                                                                         const AttackInfo& attacks);
+
+std::expected<std::vector<Move>, std::string>
+generate_legal_moves(const Board* board, Color side_to_move) {
+    return side_to_move == Color::White ? generate_legal_moves<Color::White>(*board)
+                                        : generate_legal_moves<Color::Black>(*board);
+}
+
+std::optional<Move> parse_move(const Board& board, const std::string& text) {
+    auto result = generate_legal_moves(&board, board.get_side_to_move());
+    if (!result) return std::nullopt;
+    for (const auto& move : *result) {
+        std::string candidate = move.to_algebraic(board);
+        if (candidate.size() == text.size() &&
+            std::equal(candidate.begin(), candidate.end(), text.begin(),
+                [](char a, char b) { return std::tolower(a) == std::tolower(b); })) {
+            return move;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string move_to_san(const Board& board, const Move& move) {
+    Color side = board.get_side_to_move();
+    std::string san;
+    if (move.type == MoveType::Castling) {
+        san = move.to_file == 6 ? "O-O" : "O-O-O";
+    } else {
+        const auto& piece = board.at(move.from_rank, move.from_file);
+        PieceType type = piece ? piece->type : PieceType::Pawn;
+        bool capture = move.type == MoveType::EnPassant || board.at(move.to_rank, move.to_file).has_value();
+        std::string target{ static_cast<char>('a' + move.to_file), static_cast<char>('1' + move.to_rank) };
+
+        if (type == PieceType::Pawn) {
+            if (capture) san += static_cast<char>('a' + move.from_file);
+        } else {
+            san += "PNBRQK"[static_cast<int>(type)];
+            // Disambiguate between pieces of the same type reaching the same square.
+            bool ambiguous = false, same_file = false, same_rank = false;
+            if (auto moves = generate_legal_moves(&board, side)) {
+                for (const auto& other : *moves) {
+                    if (other.to_rank != move.to_rank || other.to_file != move.to_file) continue;
+                    if (other.from_rank == move.from_rank && other.from_file == move.from_file) continue;
+                    const auto& other_piece = board.at(other.from_rank, other.from_file);
+                    if (!other_piece || other_piece->type != type) continue;
+                    ambiguous = true;
+                    if (other.from_file == move.from_file) same_file = true;
+                    if (other.from_rank == move.from_rank) same_rank = true;
                 }
             }
-            // Bishop moves
-            else if (type == PieceType::Bishop) {
-                const int bishop_dirs[4][2] = { {1,1}, {1,-1}, {-1,1}, {-1,-1} };
-                add_sliding_moves(rank, file, bishop_dirs, 4, PieceType::Bishop);
-            }
-            // Rook moves
-            else if (type == PieceType::Rook) {
-                const int rook_dirs[4][2] = { {1,0}, {-1,0}, {0,1}, {0,-1} };
-                add_sliding_moves(rank, file, rook_dirs, 4, PieceType::Rook);
+            if (ambiguous) {
+                if (!same_file) san += static_cast<char>('a' + move.from_file);
+                else if (!same_rank) san += static_cast<char>('1' + move.from_rank);
+                else san += std::string{ static_cast<char>('a' + move.from_file), static_cast<char>('1' + move.from_rank) };
             }
-            // Queen moves
-            else if (type == PieceType::Queen) {
-                const int queen_dirs[8][2] = { {1,0}, {-1,0}, {0,1}, {0,-1}, {1,1}, {1,-1}, {-1,1}, {-1,-1} };
-                add_sliding_moves(rank, file, queen_dirs, 8, PieceType::Queen);
-            }
-            // King moves (non-castling)
-            else if (type == PieceType::King) {
-                const int king_moves[8][2] = { {1,0}, {-1,0}, {0,1}, {0,-1}, {1,1}, {1,-1}, {-1,1}, {-1,-1} };
-                for (auto [dr, df] : king_moves) {
-                    int tr = rank + dr, tf = file + df;
-                    if (!on_board(tr, tf)) continue;
-                    const auto& target = board->at(tr, tf);
-                    if (!target || target->color != side_to_move) {
-                        MoveType mt = target ? MoveType::Capture : MoveType::Normal;
-                        Move move(rank, file, tr, tf, mt);
-                        Board test_board = *board;
-                        apply_move(test_board, move);
-                        if (!king_in_check(test_board, side_to_move))
-                            legal_moves.push_back(move);
-                    }
+        }
+        if (capture) san += 'x';
+        san += target;
+        if (move.promotion) {
+            san += '=';
+            san += "PNBRQK"[static_cast<int>(*move.promotion)];
+        }
+    }
+
+    // Check and mate suffix
+    Board next = board;
+    apply_move(next, move);
+    Color opponent = side == Color::White ? Color::Black : Color::White;
+    if (king_in_check(next, opponent)) {
+        auto replies = generate_legal_moves(&next, opponent);
+        san += (replies && replies->empty()) ? '#' : '+';
+    }
+    return san;
+}
+
+std::optional<Move> parse_san(const Board& board, std::string_view san) {
+    // Drop check marks and annotation glyphs: "Nf3+", "e4!?", "Qxf7#"
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?'))
+        san.remove_suffix(1);
+    if (san.size() < 2) return std::nullopt;
+
+    Color side = board.get_side_to_move();
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        int to_file = san.size() == 3 ? 6 : 2;
+        auto moves = generate_legal_moves(&board, side);
+        if (!moves) return std::nullopt;
+        for (const auto& move : *moves) {
+            if (move.type == MoveType::Castling && move.to_file == to_file) return move;
+        }
+        return std::nullopt;
+    }
+
+    auto piece_of = [](char c) -> std::optional<PieceType> {
+        switch (c) {
+            case 'N': return PieceType::Knight;
+            case 'B': return PieceType::Bishop;
+            case 'R': return PieceType::Rook;
+            case 'Q': return PieceType::Queen;
+            case 'K': return PieceType::King;
+            default: return std::nullopt;
+        }
+    };
+
+    PieceType type = PieceType::Pawn;
+    if (auto p = piece_of(san.front())) {
+        type = *p;
+        san.remove_prefix(1);
+    }
+
+    // Promotion suffix, with or without '=': "e8=Q", "bxa1N"
+    std::optional<PieceType> promotion;
+    if (type == PieceType::Pawn && !san.empty()) {
+        if (auto p = piece_of(san.back()); p && *p != PieceType::King) {
+            promotion = p;
+            san.remove_suffix(1);
+            if (!san.empty() && san.back() == '=') san.remove_suffix(1);
+        }
+    }
+    if (san.size() < 2) return std::nullopt;
+
+    int to_file = san[san.size() - 2] - 'a';
+    int to_rank = san[san.size() - 1] - '1';
+    if (!on_board(to_rank, to_file)) return std::nullopt;
+    san.remove_suffix(2);
+    // Pawns promote exactly when they reach the last rank: "e8" and "e6=Q" are both invalid.
+    if (type == PieceType::Pawn && promotion.has_value() != (to_rank == (side == Color::White ? 7 : 0)))
+        return std::nullopt;
+
+    // What is left is the disambiguation and the capture sign: "b", "1", "b1", "x", "bx"
+    int from_file = -1, from_rank = -1;
+    for (char c : san) {
+        if (c >= 'a' && c <= 'h') from_file = c - 'a';
+        else if (c >= '1' && c <= '8') from_rank = c - '1';
+        else if (c != 'x' && c != ':') return std::nullopt;
+    }
+
+    const auto& target = board.at(to_rank, to_file);
+    if (target && target->color == side) return std::nullopt;
+    int dir = side == Color::White ? 1 : -1;
+    bool en_passant = type == PieceType::Pawn && !target && from_file >= 0 && from_file != to_file &&
+                      board.get_en_passant_target() == std::make_pair(to_rank, to_file);
+
+    // Can the piece on (rank, file) reach the target, ignoring pins?
+    auto reaches = [&](int rank, int file) {
+        int dr = to_rank - rank, df = to_file - file;
+        switch (type) {
+            case PieceType::Pawn:
+                if (df == 0) {
+                    if (target) return false;
+                    if (dr == dir) return true;
+                    int start_rank = side == Color::White ? 1 : 6;
+                    return dr == 2 * dir && rank == start_rank && !board.at(rank + dir, file);
                 }
-                // Castling moves
-                if (!king_in_check(*board, side_to_move) && rank == (side_to_move == Color::White ? 0 : 7) && file == 4) {
-                    // Kingside castling
-                    bool can_castle_kingside = (side_to_move == Color::White ? board->white_kingside_castle : board->black_kingside_castle)
-                        && !board->at(rank, 5) && !board->at(rank, 6)
-                        && board->at(rank, 7) && board->at(rank, 7)->type == PieceType::Rook && board->at(rank, 7)->color == side_to_move;
-                    if (can_castle_kingside) {
-                        // Check king does not pass through or land in check
-                        Board board_step1 = *board;
-                        board_step1.at(rank, 5) = board_step1.at(rank, 4);
-                        board_step1.at(rank, 4) = std::nullopt;
-                        if (!king_in_check(board_step1, side_to_move)) {
-                            Board board_step2 = board_step1;
-                            board_step2.at(rank, 6) = board_step2.at(rank, 5);
-                            board_step2.at(rank, 5) = std::nullopt;
-                            if (!king_in_check(board_step2, side_to_move)) {
-                                Move move(rank, file, rank, 6, MoveType::Castling);
-                                Board test_board = *board;
-                                apply_move(test_board, move);
-                                if (!king_in_check(test_board, side_to_move))
-                                    legal_moves.push_back(move);
-                            }
-                        }
-                    }
-                    // Queenside castling
-                    bool can_castle_queenside = (side_to_move == Color::White ? board->white_queenside_castle : board->black_queenside_castle)
-                        && !board->at(rank, 1) && !board->at(rank, 2) && !board->at(rank, 3)
-                        && board->at(rank, 0) && board->at(rank, 0)->type == PieceType::Rook && board->at(rank, 0)->color == side_to_move;
-                    if (can_castle_queenside) {
-                        // Check king does not pass through or land in check
-                        Board board_step1 = *board;
-                        board_step1.at(rank, 3) = board_step1.at(rank, 4);
-                        board_step1.at(rank, 4) = std::nullopt;
-                        if (!king_in_check(board_step1, side_to_move)) {
-                            Board board_step2 = board_step1;
-                            board_step2.at(rank, 2) = board_step2.at(rank, 3);
-                            board_step2.at(rank, 3) = std::nullopt;
-                            if (!king_in_check(board_step2, side_to_move)) {
-                                Move move(rank, file, rank, 2, MoveType::Castling);
-                                Board test_board = *board;
-                                apply_move(test_board, move);
-                                if (!king_in_check(test_board, side_to_move))
-                                    legal_moves.push_back(move);
-                            }
-                        }
-                    }
+                return dr == dir && std::abs(df) == 1 && (target.has_value() || en_passant);
+            case PieceType::Knight:
+                return std::abs(dr * df) == 2;
+            case PieceType::King:
+                return std::max(std::abs(dr), std::abs(df)) == 1;
+            default: {
+                bool straight = dr == 0 || df == 0;
+                bool diagonal = std::abs(dr) == std::abs(df);
+                if ((type == PieceType::Rook && !straight) || (type == PieceType::Bishop && !diagonal) ||
+                    (!straight && !diagonal) || (dr == 0 && df == 0))
+                    return false;
+                int sr = (dr > 0) - (dr < 0), sf = (df > 0) - (df < 0);
+                for (int r = rank + sr, f = file + sf; r != to_rank || f != to_file; r += sr, f += sf) {
+                    if (board.at(r, f)) return false;
                 }
+                return true;
             }
         }
+    };
+
+    std::optional<Move> found;
+    for (int rank = 0; rank < Board::Size; ++rank) {
+        if (from_rank >= 0 && rank != from_rank) continue;
+        for (int file = 0; file < Board::Size; ++file) {
+            if (from_file >= 0 && file != from_file) continue;
+            const auto& sq = board.at(rank, file);
+            if (!sq || sq->color != side || sq->type != type || !reaches(rank, file)) continue;
+
+            MoveType move_type = promotion ? MoveType::Promotion
+                               : en_passant ? MoveType::EnPassant
+                               : target ? MoveType::Capture : MoveType::Normal;
+            Move move(rank, file, to_rank, to_file, move_type, promotion);
+            Board test_board = board;
+            apply_move(test_board, move);
+            if (king_in_check(test_board, side)) continue;
+            if (found) return std::nullopt; // ambiguous
+            found = move;
+        }
     }
+    return found;
+}
 
-    return legal_moves;
-}
\ No newline at end of file
+bool is_capture_or_pawn_move(const Board& board, const Move& move) {
+    const auto& piece = board.at(move.from_rank, move.from_file);
+    return move.type == MoveType::EnPassant || board.at(move.to_rank, move.to_file).has_value() ||
+           (piece && piece->type == PieceType::Pawn);
+}
+
+// Neither side can mate: bare kings, a single minor piece, or bishops on one color.
+bool insufficient_material(const Board& board) {
+    int minors = 0, knights = 0;
+    int bishop_colors[2] = {};
+    for (int rank = 0; rank < Board::Size; ++rank) {
+        for (int file = 0; file < Board::Size; ++file) {
+            const auto& sq = board.at(rank, file);
+            if (!sq || sq->type == PieceType::King) continue;
+            if (sq->type == PieceType::Knight) { ++minors; ++knights; }
+            else if (sq->type == PieceType::Bishop) { ++minors; ++bishop_colors[(rank + file) & 1]; }
+            else return false;
+        }
+    }
+    if (minors <= 1) return true;
+    return knights == 0 && (bishop_colors[0] == 0 || bishop_colors[1] == 0);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <expected>
+#include <string_view>
 #include "Move.h"
 #include "Board.h"
 
@@ -11,4 +12,36 @@ generate_legal_moves(const Board* board, Color side_to_move);
 // Applies a move to the board (modifies the board)
 void apply_move(Board& board, const Move& move);
 
-bool king_in_check(const Board& board, Color color);
\ No newline at end of file
+bool king_in_check(const Board& board, Color color);
+
+// Side-specialized versions of the two functions above: pawn directions, home
+// ranks and castling rights are constants. The runtime versions dispatch to
+// these once per call; instantiated for both colors in MoveGen.cpp.
+template <Color Us>
+std::expected<std::vector<Move>, std::string> generate_legal_moves(const Board& board);
+
+template <Color Us>
+bool king_in_check(const Board& board);
+
+struct AttackInfo;
+
+// Legal moves from attack maps the caller already computed for this
+// position with Us to move (see Attacks.h), e.g. once per search node.
+template <Color Us>
+std::expected<std::vector<Move>, std::string> generate_legal_moves(const Board& board, const AttackInfo& attacks);
+
+// Finds the legal move for the side to move matching a coordinate move such as "e2e4" or "e7e8q"
+std::optional<Move> parse_move(const Board& board, const std::string& text);
+
+// Standard algebraic notation for a legal move of the side to move, e.g. "Nbd7", "exd6", "O-O", "e8=Q+"
+std::string move_to_san(const Board& board, const Move& move);
+
+// Resolves a SAN move ("Nbd7", "exd6", "O-O", "e8=Q+") for the side to move; nullopt if it is
+// not a unique legal move
+std::optional<Move> parse_san(const Board& board, std::string_view san);
+
+// Captures, en passant and pawn moves, which reset the fifty move counter
+bool is_capture_or_pawn_move(const Board& board, const Move& move);
+
+// Neither side can mate: bare kings, a single minor piece, or bishops on one color
+bool insufficient_material(const Board& board);
@@ -0,0 +1,218 @@
+#include "PackedPosition.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <print>
+
+namespace {
+
+constexpr char FileMagic[8] = { 'C', 'H', 'P', 'O', 'S', '0', '0', '1' };
+
+struct FileHeader {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t reserved;
+};
+static_assert(sizeof(FileHeader) == 16);
+
+constexpr size_t BufferRecords = 4096;
+
+bool valid_header(const uint8_t* data, size_t size) {
+    if (size < sizeof(FileHeader) || (size - sizeof(FileHeader)) % sizeof(PackedPosition) != 0) return false;
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    return std::memcmp(header.magic, FileMagic, sizeof(FileMagic)) == 0 && header.record_size == sizeof(PackedPosition);
+}
+
+} // namespace
+
+std::optional<PackedPosition> pack_position(const Board& board) {
+    PackedPosition packed;
+    int count = 0;
+    for (int sq = 0; sq < 64; ++sq) {
+        const auto& piece = board.at(sq / 8, sq % 8);
+        if (!piece) continue;
+        if (count == 32) return std::nullopt;
+        uint8_t code = static_cast<uint8_t>(static_cast<int>(piece->color) << 3 | static_cast<int>(piece->type));
+        packed.pieces[count / 2] |= static_cast<uint8_t>(code << (count % 2 * 4));
+        packed.occupancy |= uint64_t(1) << sq;
+        ++count;
+    }
+
+    packed.flags = (board.get_side_to_move() == Color::Black ? 1 : 0) | (board.white_kingside_castle ? 2 : 0) |
+                   (board.white_queenside_castle ? 4 : 0) | (board.black_kingside_castle ? 8 : 0) |
+                   (board.black_queenside_castle ? 16 : 0);
+    if (const auto& ep = board.get_en_passant_target()) packed.en_passant = static_cast<uint8_t>(ep->first * 8 + ep->second);
+    packed.halfmove_clock = static_cast<uint8_t>(std::clamp(board.get_halfmove_clock(), 0, 255));
+    return packed;
+}
+
+bool PackedPosition::valid() const {
+    int count = std::popcount(occupancy);
+    if (count > 32 || (en_passant >= 64 && en_passant != NoSquare)) return false;
+    for (int index = 0; index < count; ++index) {
+        if (((pieces[index / 2] >> (index % 2 * 4)) & 7) > static_cast<int>(PieceType::King)) return false;
+    }
+    return true;
+}
+
+bool unpack_position(const PackedPosition& packed, Board& board) {
+    board.clear_board();
+    if (!packed.valid()) return false;
+    int index = 0;
+    for (uint64_t bits = packed.occupancy; bits; bits &= bits - 1, ++index) {
+        int sq = std::countr_zero(bits);
+        int code = (packed.pieces[index / 2] >> (index % 2 * 4)) & 0xF;
+        board.set_piece(sq / 8, sq % 8, static_cast<PieceType>(code & 7), static_cast<Color>(code >> 3));
+    }
+
+    board.set_side_to_move(packed.flags & 1 ? Color::Black : Color::White);
+    board.white_kingside_castle = packed.flags & 2;
+    board.white_queenside_castle = packed.flags & 4;
+    board.black_kingside_castle = packed.flags & 8;
+    board.black_queenside_castle = packed.flags & 16;
+    if (packed.en_passant < 64) board.set_en_passant_target(std::make_pair(packed.en_passant / 8, packed.en_passant % 8));
+    else board.set_en_passant_target(std::nullopt);
+    board.set_halfmove_clock(packed.halfmove_clock);
+    return true;
+}
+
+bool PositionWriter::open(const std::string& path, bool append) {
+    close();
+    failed_ = false;
+    count_ = 0;
+
+    bool existing = false;
+    if (append) {
+        MappedFile file;
+        if (file.open(path)) {
+            if (!valid_header(file.data(), file.size())) return false;
+            existing = true;
+        }
+    }
+    out_.open(path, std::ios::binary | (existing ? std::ios::app : std::ios::trunc));
+    if (!out_) return false;
+    if (!existing) {
+        FileHeader header{};
+        std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+        header.record_size = sizeof(PackedPosition);
+        out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    buffer_.reserve(BufferRecords);
+    return static_cast<bool>(out_);
+}
+
+void PositionWriter::write(const PackedPosition& position) {
+    buffer_.push_back(position);
+    ++count_;
+    if (buffer_.size() == BufferRecords) flush();
+}
+
+void PositionWriter::flush() {
+    if (!buffer_.empty()) {
+        out_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size() * sizeof(PackedPosition));
+        buffer_.clear();
+    }
+    out_.flush();
+    if (!out_) failed_ = true;
+}
+
+bool PositionWriter::close() {
+    if (!out_.is_open()) return !failed_;
+    flush();
+    out_.close();
+    return !failed_ && !out_.fail();
+}
+
+bool PositionReader::open(const std::string& path) {
+    close();
+    if (!file_.open(path) || !valid_header(file_.data(), file_.size())) {
+        file_.close();
+        return false;
+    }
+    records_ = std::span(reinterpret_cast<const PackedPosition*>(file_.data() + sizeof(FileHeader)),
+                         (file_.size() - sizeof(FileHeader)) / sizeof(PackedPosition));
+    return true;
+}
+
+void PositionReader::close() {
+    file_.close();
+    records_ = {};
+    cursor_ = 0;
+}
+
+std::optional<PackOptions> parse_pack_args(const std::vector<std::string>& args) {
+    PackOptions options;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        bool has_value = i + 1 < args.size();
+        if (arg == "--input" && has_value) options.input_path = args[++i];
+        else if (arg == "--output" && has_value) options.output_path = args[++i];
+        else if (arg == "--append") options.append = true;
+        else return std::nullopt;
+    }
+    if (options.input_path.empty() || options.output_path.empty()) return std::nullopt;
+    return options;
+}
+
+int run_pack(const PackOptions& options) {
+    std::ifstream in(options.input_path);
+    if (!in) {
+        std::println(stderr, "Cannot open {}", options.input_path);
+        return 1;
+    }
+    PositionWriter writer;
+    if (!writer.open(options.output_path, options.append)) {
+        std::println(stderr, "Cannot write {}", options.output_path);
+        return 1;
+    }
+
+    // Text side: parse every line with set_fen, as the FEN pipelines do.
+    auto start = std::chrono::steady_clock::now();
+    std::string line;
+    uint64_t text_bytes = 0, skipped = 0;
+    Board board;
+    while (std::getline(in, line)) {
+        auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        text_bytes += line.size() + 1;
+
+        std::optional<PackedPosition> packed;
+        if (board.set_fen(line)) packed = pack_position(board);
+        if (!packed) {
+            ++skipped;
+            continue;
+        }
+        writer.write(*packed);
+    }
+    if (!writer.close()) {
+        std::println(stderr, "Write to {} failed", options.output_path);
+        return 1;
+    }
+    double text_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    PositionReader reader;
+    if (!reader.open(options.output_path)) {
+        std::println(stderr, "Cannot read back {}", options.output_path);
+        return 1;
+    }
+    start = std::chrono::steady_clock::now();
+    uint64_t pieces = 0, invalid = 0;
+    while (const PackedPosition* packed = reader.next()) {
+        if (unpack_position(*packed, board)) pieces += std::popcount(packed->occupancy);
+        else ++invalid;
+    }
+    double decode_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t written = writer.count();
+    std::println("{} positions written ({} skipped), {} in the file", written, skipped, reader.size());
+    if (invalid) std::println("{} records in the file are not valid positions", invalid);
+    if (written) {
+        std::println("text {:.1f} bytes/position, packed {} bytes/position", double(text_bytes) / written, sizeof(PackedPosition));
+        std::println("FEN parse {:.0f} positions/s, packed decode {:.0f} positions/s ({} pieces)",
+                     text_seconds > 0 ? written / text_seconds : 0.0,
+                     decode_seconds > 0 ? reader.size() / decode_seconds : 0.0, pieces);
+    }
+    return 0;
+}
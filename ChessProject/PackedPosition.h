@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include "Board.h"
+#include "MappedFile.h"
+
+// 32-byte position record for training and analysis datasets. Occupied
+// squares (a1 = bit 0) are listed in the bitmask and their pieces follow as
+// 4-bit codes in square order, so a position with at most 32 pieces always
+// fits. Records are stored as-is in little-endian files.
+struct PackedPosition {
+    static constexpr uint8_t NoSquare = 0xFF;
+    static constexpr int8_t NoResult = -128;
+    static constexpr int16_t NoScore = INT16_MIN;
+
+    uint64_t occupancy = 0;
+    uint8_t pieces[16] = {};       // color << 3 | piece type, low nibble first
+    uint8_t flags = 0;             // bit 0: black to move, bits 1-4: castling KQkq
+    uint8_t en_passant = NoSquare; // target square
+    uint8_t halfmove_clock = 0;
+    int8_t result = NoResult;      // 1, 0 or -1 from white's point of view
+    int16_t score = NoScore;       // centipawns for the side to move
+    uint16_t move = 0;             // best move, TranspositionTable::encode_move
+
+    bool has_result() const { return result != NoResult; }
+    bool has_score() const { return score != NoScore; }
+    bool has_move() const { return move != 0; }
+
+    // At most 32 pieces, each code a color and a PieceType, and an en
+    // passant square on the board or none. Records read from a file are
+    // only decoded after this check.
+    bool valid() const;
+};
+static_assert(sizeof(PackedPosition) == 32);
+
+// Nullopt when the board has more than 32 pieces.
+std::optional<PackedPosition> pack_position(const Board& board);
+
+// Overwrites every field of `board` except the fullmove number, which is
+// not stored. False, with `board` left empty, if the record is not valid().
+bool unpack_position(const PackedPosition& packed, Board& board);
+
+// Container file: a 16-byte header ("CHPOS001", record size, reserved)
+// followed by the records, so the count follows from the file size and
+// files can be concatenated by appending records.
+class PositionWriter {
+public:
+    ~PositionWriter() { close(); }
+
+    // Creates `path`, or appends to an existing container when `append` is set.
+    bool open(const std::string& path, bool append = false);
+    void write(const PackedPosition& position);
+    // Writes buffered records through to the file.
+    void flush();
+    // Flushes buffered records; false if any write failed.
+    bool close();
+
+    uint64_t count() const { return count_; }
+
+private:
+    std::ofstream out_;
+    std::vector<PackedPosition> buffer_;
+    uint64_t count_ = 0;
+    bool failed_ = false;
+};
+
+// Maps a container file for sequential or random access without copying.
+// Records are not checked when the file is opened; unpack_position and
+// evaluate_batch reject the ones that are not valid().
+class PositionReader {
+public:
+    bool open(const std::string& path);
+    void close();
+
+    size_t size() const { return records_.size(); }
+    const PackedPosition& operator[](size_t index) const { return records_[index]; }
+    std::span<const PackedPosition> records() const { return records_; }
+
+    // Streaming access: the next record, or nullptr at the end of the file.
+    const PackedPosition* next() { return cursor_ < records_.size() ? &records_[cursor_++] : nullptr; }
+    void rewind() { cursor_ = 0; }
+
+private:
+    MappedFile file_;
+    std::span<const PackedPosition> records_;
+    size_t cursor_ = 0;
+};
+
+struct PackOptions {
+    std::string input_path;   // FEN or EPD per line
+    std::string output_path;
+    bool append = false;
+};
+
+// Parses the arguments following "pack" on the command line.
+std::optional<PackOptions> parse_pack_args(const std::vector<std::string>& args);
+
+// Converts FEN/EPD lines to a container file, then decodes it again and
+// reports the size and decode rate against the text input.
+int run_pack(const PackOptions& options);
@@ -0,0 +1,93 @@
+#include "Perft.h"
+#include "MoveGen.h"
+#include <algorithm>
+#include <chrono>
+#include <print>
+#include <stdexcept>
+
+namespace {
+
+struct SuitePosition {
+    const char* fen;
+    std::vector<uint64_t> counts;  // perft 1, 2, ...
+};
+
+// https://www.chessprogramming.org/Perft_Results, then double checks by a
+// rook and a pawn on the rank in front of the king: blocking the rook with
+// the knight leaves the pawn check, so only the king moves.
+const std::vector<SuitePosition> suite = {
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", { 20, 400, 8902, 197281 } },
+    { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", { 48, 2039, 97862, 4085603 } },
+    { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", { 14, 191, 2812, 43238, 674624 } },
+    { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", { 6, 264, 9467, 422333 } },
+    { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", { 44, 1486, 62379, 2103487 } },
+    { "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", { 46, 2079, 89890, 3894594 } },
+    { "4k3/8/8/8/8/4N3/3p4/r3K3 w - - 0 1", { 3 } },
+    { "R3k3/3P4/4n3/8/8/8/8/4K3 b - - 0 1", { 3 } },
+};
+
+} // namespace
+
+uint64_t perft(const Board& board, int depth) {
+    auto moves = generate_legal_moves(&board, board.get_side_to_move());
+    if (!moves) return 0;
+    if (depth <= 1) return depth == 1 ? moves->size() : 1;
+    uint64_t count = 0;
+    for (const Move& move : *moves) {
+        Board next = board;
+        apply_move(next, move);
+        count += perft(next, depth - 1);
+    }
+    return count;
+}
+
+std::optional<PerftOptions> parse_perft_args(const std::vector<std::string>& args) {
+    PerftOptions options;
+    try {
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if (arg == "--fen" && has_value) options.fen = args[++i];
+            else if (arg == "--depth" && has_value) options.depth = std::stoi(args[++i]);
+            else return std::nullopt;
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    if (options.depth < 1) return std::nullopt;
+    return options;
+}
+
+int run_perft(const PerftOptions& options) {
+    auto start = std::chrono::steady_clock::now();
+    auto seconds = [&] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+    Board board;
+    if (!options.fen.empty()) {
+        if (!board.set_fen(options.fen)) {
+            std::println(stderr, "Invalid FEN {}", options.fen);
+            return 1;
+        }
+        // Counted before the clock is read: argument evaluation order is unspecified.
+        uint64_t nodes = perft(board, options.depth);
+        double elapsed = seconds();
+        std::println("{} nodes in {:.2f} s", nodes, elapsed);
+        return 0;
+    }
+
+    int failed = 0;
+    uint64_t nodes = 0;
+    for (const SuitePosition& position : suite) {
+        board.set_fen(position.fen);
+        int depth = std::min<int>(options.depth, static_cast<int>(position.counts.size()));
+        uint64_t count = perft(board, depth);
+        nodes += count;
+        bool ok = count == position.counts[depth - 1];
+        if (!ok) ++failed;
+        std::println("{} depth {} {} (expected {}) {}", ok ? "ok  " : "FAIL", depth, count, position.counts[depth - 1],
+                     position.fen);
+    }
+    double elapsed = seconds();
+    std::println("{} of {} positions match, {} nodes in {:.2f} s", suite.size() - failed, suite.size(), nodes, elapsed);
+    return failed ? 1 : 0;
+}
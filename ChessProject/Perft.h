@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Board.h"
+
+// Number of move sequences `depth` plies long from `board`, the standard
+// check of move generation against published counts.
+uint64_t perft(const Board& board, int depth);
+
+struct PerftOptions {
+    std::string fen;  // empty: the built-in suite
+    int depth = 4;    // for the suite, the deepest reference count checked
+};
+
+// Parses the arguments following "perft" on the command line.
+std::optional<PerftOptions> parse_perft_args(const std::vector<std::string>& args);
+
+// Prints the perft count of one position, or checks every position of the
+// built-in suite against its reference counts and exits with 1 on any
+// mismatch. The suite holds the six standard perft positions and double
+// checks that include a pawn check.
+int run_perft(const PerftOptions& options);
@@ -0,0 +1,268 @@
+#include "Pgn.h"
+#include "MoveGen.h"
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <format>
+#include <mutex>
+#include <print>
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Position of the next line that starts with '[' at or after `pos`, outside
+// of brace comments; the end of the text if there is none.
+size_t find_tag_line(std::string_view text, size_t pos) {
+    bool line_start = pos == 0 || text[pos - 1] == '\n';
+    bool in_comment = false;
+    for (; pos < text.size(); ++pos) {
+        char c = text[pos];
+        if (in_comment) {
+            if (c == '}') in_comment = false;
+        } else if (c == '{') {
+            in_comment = true;
+        } else if (c == '[' && line_start) {
+            return pos;
+        }
+        line_start = c == '\n' || (line_start && (c == ' ' || c == '\t' || c == '\r'));
+    }
+    return text.size();
+}
+
+// Position of the '[' of the first tag line, at or after the line starting
+// at `pos`, that follows a blank line; npos if there is none. Blank lines
+// may hold spaces, tabs and the '\r' of CRLF files.
+size_t find_game_start(std::string_view text, size_t pos) {
+    bool after_blank = false;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        std::string_view line = text.substr(pos, eol == std::string_view::npos ? eol : eol - pos);
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos) {
+            after_blank = true;
+        } else {
+            if (after_blank && line[first] == '[') return pos + first;
+            after_blank = false;
+        }
+        if (eol == std::string_view::npos) break;
+        pos = eol + 1;
+    }
+    return std::string_view::npos;
+}
+
+bool is_result(std::string_view token) {
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+// Skips a brace comment, rest-of-line comment or (possibly nested)
+// variation starting at `pos`; returns the position after it.
+size_t skip_annotation(std::string_view text, size_t pos) {
+    char open = text[pos];
+    if (open == '{') {
+        size_t end = text.find('}', pos);
+        return end == std::string_view::npos ? text.size() : end + 1;
+    }
+    if (open == ';') {
+        size_t end = text.find('\n', pos);
+        return end == std::string_view::npos ? text.size() : end + 1;
+    }
+    int depth = 0;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (c == '{' || c == ';') {
+            pos = skip_annotation(text, pos);
+            continue;
+        }
+        if (c == '(') ++depth;
+        else if (c == ')' && --depth == 0) return pos + 1;
+        ++pos;
+    }
+    return pos;
+}
+
+} // namespace
+
+std::string_view PgnGame::tag(std::string_view name) const {
+    for (const auto& [key, value] : tags) {
+        if (key == name) return value;
+    }
+    return {};
+}
+
+bool PgnReader::open(const std::string& path) {
+    if (!file_.open(path)) return false;
+    text_ = std::string_view(reinterpret_cast<const char*>(file_.data()), file_.size());
+    pos_ = 0;
+    return true;
+}
+
+bool PgnReader::next(PgnGame& game) {
+    game.tags.clear();
+    game.movetext = {};
+
+    while (pos_ < text_.size() && is_space(text_[pos_])) ++pos_;
+    if (pos_ >= text_.size()) return false;
+
+    // Tag section: one [Name "value"] per line
+    while (pos_ < text_.size() && text_[pos_] == '[') {
+        size_t eol = text_.find('\n', pos_);
+        if (eol == std::string_view::npos) eol = text_.size();
+        std::string_view line = text_.substr(pos_ + 1, eol - pos_ - 1);
+        pos_ = eol;
+        while (pos_ < text_.size() && is_space(text_[pos_])) ++pos_;
+
+        size_t name_end = line.find_first_of(" \t");
+        size_t open = line.find('"');
+        size_t close = line.rfind('"');
+        if (name_end == std::string_view::npos || open == std::string_view::npos || close <= open) continue;
+        game.tags.emplace_back(line.substr(0, name_end), line.substr(open + 1, close - open - 1));
+    }
+
+    size_t end = find_tag_line(text_, pos_);
+    game.movetext = text_.substr(pos_, end - pos_);
+    pos_ = end;
+    return true;
+}
+
+std::vector<std::string_view> PgnReader::split(std::string_view text, int parts) {
+    std::vector<std::string_view> ranges;
+    size_t begin = 0;
+    for (int i = 1; i < parts && begin < text.size(); ++i) {
+        size_t guess = std::max(begin + 1, text.size() * i / parts);
+        if (guess >= text.size()) break;
+        // Move to the next line start, then forward past the movetext of the
+        // game in progress to the first tag line of the following game.
+        size_t line = text.find('\n', guess);
+        if (line == std::string_view::npos) break;
+        size_t cut = find_game_start(text, line + 1);
+        if (cut == std::string_view::npos) break;
+        ranges.push_back(text.substr(begin, cut - begin));
+        begin = cut;
+    }
+    if (begin < text.size()) ranges.push_back(text.substr(begin));
+    return ranges;
+}
+
+std::expected<int, std::string> replay_game(const PgnGame& game, const PgnMoveVisitor& visit) {
+    Board board;
+    if (auto fen = game.tag("FEN"); !fen.empty()) {
+        if (!board.set_fen(fen)) return std::unexpected(std::format("invalid FEN \"{}\"", fen));
+    } else {
+        board.setup_initial_position();
+    }
+
+    std::string_view text = game.movetext;
+    int moves = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (is_space(c) || c == '.') {
+            ++pos;
+            continue;
+        }
+        if (c == '{' || c == ';' || c == '(') {
+            pos = skip_annotation(text, pos);
+            continue;
+        }
+
+        size_t end = pos;
+        while (end < text.size() && !is_space(text[end]) && text[end] != '{' && text[end] != '(' &&
+               text[end] != ';' && text[end] != ')')
+            ++end;
+        std::string_view token = text.substr(pos, std::max(end, pos + 1) - pos);
+        pos = std::max(end, pos + 1);
+
+        if (token.front() == '$' || token == ")") continue; // NAG, stray parenthesis
+        if (is_result(token)) break;
+        // Move numbers: "12." and "12..." (possibly glued to the move: "12.e4")
+        if (std::isdigit(static_cast<unsigned char>(token.front())) && !token.starts_with("0-0")) {
+            size_t digits = token.find_first_not_of("0123456789");
+            if (digits == std::string_view::npos) continue;
+            token.remove_prefix(digits);
+            while (!token.empty() && token.front() == '.') token.remove_prefix(1);
+            if (token.empty()) continue;
+        }
+
+        auto move = parse_san(board, token);
+        if (!move) return std::unexpected(std::format("move {}: cannot decode \"{}\"", moves / 2 + 1, token));
+        if (visit && !visit(board, *move, token)) return moves + 1;
+        apply_move(board, *move);
+        ++moves;
+    }
+    return moves;
+}
+
+std::optional<PgnOptions> parse_pgn_args(const std::vector<std::string>& args) {
+    PgnOptions options;
+    try {
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if (arg == "--input" && has_value) options.input_path = args[++i];
+            else if (arg == "--threads" && has_value) options.threads = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--verify-san") options.verify_san = true;
+            else return std::nullopt;
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    if (options.input_path.empty()) return std::nullopt;
+    return options;
+}
+
+int run_pgn(const PgnOptions& options) {
+    PgnReader reader;
+    if (!reader.open(options.input_path)) {
+        std::println(stderr, "Cannot open {}", options.input_path);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto ranges = PgnReader::split(reader.text(), options.threads);
+    std::atomic<uint64_t> games{0}, moves{0}, errors{0}, san_mismatches{0};
+    std::mutex print_mutex;
+    {
+        std::vector<std::jthread> pool;
+        for (std::string_view range : ranges) {
+            pool.emplace_back([&, range] {
+                PgnReader part(range);
+                PgnGame game;
+                PgnStats local;
+                uint64_t mismatches = 0;
+                PgnMoveVisitor check_san;
+                if (options.verify_san) {
+                    check_san = [&](const Board& board, const Move& move, std::string_view san) {
+                        while (!san.empty() && (san.back() == '!' || san.back() == '?')) san.remove_suffix(1);
+                        if (move_to_san(board, move) != san) ++mismatches;
+                        return true;
+                    };
+                }
+                while (part.next(game)) {
+                    ++local.games;
+                    auto result = replay_game(game, check_san);
+                    if (result) {
+                        local.moves += *result;
+                        continue;
+                    }
+                    ++local.errors;
+                    std::lock_guard<std::mutex> lock(print_mutex);
+                    std::println(stderr, "{} vs {} ({}): {}", game.tag("White"), game.tag("Black"),
+                                 game.tag("Date"), result.error());
+                }
+                games += local.games;
+                moves += local.moves;
+                errors += local.errors;
+                san_mismatches += mismatches;
+            });
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::println("{} games, {} moves, {} errors in {:.2f} s ({:.0f} moves/s, {} threads)", games.load(), moves.load(),
+                 errors.load(), seconds, seconds > 0 ? moves / seconds : 0.0, ranges.size());
+    if (options.verify_san) std::println("{} moves re-encoded to different SAN", san_mismatches.load());
+    return errors ? 2 : 0;
+}
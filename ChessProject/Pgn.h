@@ -0,0 +1,73 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Board.h"
+#include "MappedFile.h"
+#include "Move.h"
+
+// One game of a PGN database. All views point into the reader's text, so a
+// game stays valid only as long as its reader (or the mapped file) does.
+struct PgnGame {
+    std::vector<std::pair<std::string_view, std::string_view>> tags; // [Name "value"], value not unescaped
+    std::string_view movetext;                                       // everything after the tag section
+
+    std::string_view tag(std::string_view name) const;
+};
+
+// Reads games one at a time from a memory-mapped file or from any text
+// range, without copying. Move text is only decoded by replay_game.
+class PgnReader {
+public:
+    PgnReader() = default;
+    explicit PgnReader(std::string_view text) : text_(text) {}
+
+    bool open(const std::string& path);
+    std::string_view text() const { return text_; }
+
+    // Fills `game` with the next game; false at the end of the input.
+    bool next(PgnGame& game);
+
+    // Cuts `text` into at most `parts` consecutive ranges that each start at
+    // a game's tag section, for parsing on separate threads.
+    static std::vector<std::string_view> split(std::string_view text, int parts);
+
+private:
+    MappedFile file_;
+    std::string_view text_;
+    size_t pos_ = 0;
+};
+
+// Called with the position before each move and the SAN token it came from;
+// returning false stops the replay.
+using PgnMoveVisitor = std::function<bool(const Board&, const Move&, std::string_view san)>;
+
+// Plays the main line from the FEN tag (or the initial position), skipping
+// comments, variations, NAGs and move numbers. Returns the number of moves
+// played, or an error naming the first move that could not be decoded.
+std::expected<int, std::string> replay_game(const PgnGame& game, const PgnMoveVisitor& visit = {});
+
+struct PgnStats {
+    uint64_t games = 0;
+    uint64_t moves = 0;
+    uint64_t errors = 0;
+};
+
+struct PgnOptions {
+    std::string input_path;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    bool verify_san = false;   // re-encode every move with move_to_san and compare
+};
+
+// Parses the arguments following "pgn" on the command line.
+std::optional<PgnOptions> parse_pgn_args(const std::vector<std::string>& args);
+
+// Replays every game of the database and prints throughput and errors.
+int run_pgn(const PgnOptions& options);
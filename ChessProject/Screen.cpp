@@ -0,0 +1,130 @@
+#include "Screen.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+
+size_t code_point_length(unsigned char lead) {
+    if (lead >= 0xF0) return 4;
+    if (lead >= 0xE0) return 3;
+    if (lead >= 0xC0) return 2;
+    return 1;
+}
+
+void append_number(std::string& out, int value) {
+    char digits[12];
+    out.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+// CSI row;col H, 1-based.
+void move_to(std::string& out, int row, int col) {
+    out += "\033[";
+    append_number(out, row + 1);
+    out += ';';
+    append_number(out, col + 1);
+    out += 'H';
+}
+
+void set_style(std::string& out, const CellStyle& style) {
+    out += "\033[0";
+    if (style.bold) out += ";1";
+    if (style.fg >= 0) {
+        out += ";38;5;";
+        append_number(out, style.fg);
+    }
+    if (style.bg >= 0) {
+        out += ";48;5;";
+        append_number(out, style.bg);
+    }
+    out += 'm';
+}
+
+} // namespace
+
+bool ScreenBuffer::Cell::operator==(const Cell& other) const {
+    return length == other.length && style == other.style && std::memcmp(glyph, other.glyph, length) == 0;
+}
+
+ScreenBuffer::ScreenBuffer(int rows, int cols)
+    : rows_(rows), cols_(cols), back_(static_cast<size_t>(rows) * cols), front_(back_.size()) {}
+
+void ScreenBuffer::clear() {
+    std::fill(back_.begin(), back_.end(), Cell{});
+}
+
+int ScreenBuffer::print(int row, int col, std::string_view text, CellStyle style) {
+    if (row < 0 || row >= rows_) return col;
+    size_t pos = 0;
+    while (pos < text.size() && col < cols_) {
+        size_t length = std::min(code_point_length(static_cast<unsigned char>(text[pos])), text.size() - pos);
+        if (col >= 0) {
+            Cell& cell = back_[static_cast<size_t>(row) * cols_ + col];
+            std::memcpy(cell.glyph, text.data() + pos, length);
+            cell.length = static_cast<uint8_t>(length);
+            cell.style = style;
+        }
+        pos += length;
+        ++col;
+    }
+    return col;
+}
+
+void ScreenBuffer::flush(std::string& out) {
+    // Unknown after "clear screen": force the first style and cursor move.
+    int cursor_row = -1, cursor_col = -1;
+    bool style_known = false;
+    CellStyle style;
+    if (repaint_) {
+        out += "\033[0m\033[2J";
+        style_known = true;
+    }
+    for (int row = 0; row < rows_; ++row) {
+        for (int col = 0; col < cols_; ++col) {
+            size_t index = static_cast<size_t>(row) * cols_ + col;
+            const Cell& cell = back_[index];
+            if (!repaint_ && cell == front_[index]) continue;
+            // Across a short gap of unchanged cells in the current style,
+            // rewriting them is cheaper than a cursor move.
+            bool gap_rewritten = false;
+            if (row == cursor_row && col > cursor_col && col - cursor_col <= 3) {
+                size_t gap = static_cast<size_t>(row) * cols_ + cursor_col;
+                gap_rewritten = std::all_of(back_.begin() + gap, back_.begin() + index,
+                                            [&](const Cell& skipped) { return skipped.style == style; });
+                if (gap_rewritten) {
+                    for (size_t i = gap; i < index; ++i) out.append(back_[i].glyph, back_[i].length);
+                }
+            }
+            if (!gap_rewritten && (row != cursor_row || col != cursor_col)) move_to(out, row, col);
+            if (!style_known || cell.style != style) {
+                set_style(out, cell.style);
+                style = cell.style;
+                style_known = true;
+            }
+            out.append(cell.glyph, cell.length);
+            cursor_row = row;
+            cursor_col = col + 1;
+        }
+    }
+    if (style_known && style != CellStyle{}) out += "\033[0m";
+    front_ = back_;
+    repaint_ = false;
+}
+
+bool enable_vt_output() {
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (console == INVALID_HANDLE_VALUE || !GetConsoleMode(console, &mode)) return false;
+    return SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+#else
+    return true;
+#endif
+}
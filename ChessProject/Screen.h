@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Character-cell screen for VT100 terminals. Frames are drawn into a back
+// buffer; flush() compares it with the frame the terminal already shows and
+// emits cursor-addressed updates for the changed cells only, so an idle
+// screen costs no output and a ticking counter costs a few bytes.
+
+struct CellStyle {
+    int16_t fg = -1;    // 256-colour palette index, -1 for the terminal default
+    int16_t bg = -1;
+    bool bold = false;
+
+    bool operator==(const CellStyle&) const = default;
+};
+
+class ScreenBuffer {
+public:
+    ScreenBuffer(int rows, int cols);
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+
+    // Blanks the back buffer before a new frame is drawn.
+    void clear();
+    // Writes UTF-8 text from (row, col), one cell per code point, clipped
+    // at the right edge. Returns the column after the text.
+    int print(int row, int col, std::string_view text, CellStyle style = {});
+
+    // Appends to `out` the escape sequences that turn the frame on the
+    // terminal into the back buffer. The first flush, and the first after
+    // invalidate(), clears the terminal and paints every cell.
+    void flush(std::string& out);
+    void invalidate() { repaint_ = true; }
+
+private:
+    struct Cell {
+        char glyph[4] = { ' ' };
+        uint8_t length = 1;
+        CellStyle style;
+
+        bool operator==(const Cell& other) const;
+    };
+
+    int rows_;
+    int cols_;
+    std::vector<Cell> back_;
+    std::vector<Cell> front_;
+    bool repaint_ = true;
+};
+
+// Makes the console interpret VT100 sequences and UTF-8 output, which
+// Windows consoles do not by default. No-op elsewhere.
+bool enable_vt_output();
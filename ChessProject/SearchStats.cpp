@@ -0,0 +1,58 @@
+#include "SearchStats.h"
+#include <cmath>
+#include <format>
+
+void ThreadStats::merge(const ThreadStats& other) {
+    for (int ply = 0; ply < MaxPly; ++ply) {
+        nodes_per_ply[ply] += other.nodes_per_ply[ply];
+    }
+    nodes += other.nodes;
+    leaf_evals += other.leaf_evals;
+    terminal_nodes += other.terminal_nodes;
+    tb_hits += other.tb_hits;
+    tt_hits += other.tt_hits;
+    draw_cutoffs += other.draw_cutoffs;
+    movegen_calls += other.movegen_calls;
+    eval_calls += other.eval_calls;
+    movegen_ns += other.movegen_ns;
+    eval_ns += other.eval_ns;
+}
+
+// Geometric mean growth of the node count from the root to the deepest ply.
+double SearchStats::effective_branching_factor() const {
+    int deepest = 0;
+    for (int ply = 1; ply < ThreadStats::MaxPly; ++ply) {
+        if (total.nodes_per_ply[ply] > 0) deepest = ply;
+    }
+    if (deepest == 0 || total.nodes_per_ply[0] == 0) return 0.0;
+    double ratio = static_cast<double>(total.nodes_per_ply[deepest]) / static_cast<double>(total.nodes_per_ply[0]);
+    return std::pow(ratio, 1.0 / deepest);
+}
+
+std::string SearchStats::to_json() const {
+    std::string json = std::format("{{\"depth\":{},\"threads\":{},\"elapsed_ms\":{:.3f},\"nodes\":{},\"nps\":{},",
+        depth, threads, elapsed_ms, total.nodes,
+        elapsed_ms > 0 ? static_cast<uint64_t>(total.nodes * 1000.0 / elapsed_ms) : 0);
+
+    json += "\"nodes_per_ply\":[";
+    int last = 0;
+    for (int ply = 0; ply < ThreadStats::MaxPly; ++ply) {
+        if (total.nodes_per_ply[ply] > 0) last = ply;
+    }
+    for (int ply = 0; ply <= last; ++ply) {
+        json += std::format("{}{}", ply ? "," : "", total.nodes_per_ply[ply]);
+    }
+    json += "],";
+
+    json += std::format("\"leaf_evals\":{},\"terminal_nodes\":{},\"tb_hits\":{},\"tt_hits\":{},\"draw_cutoffs\":{},\"ebf\":{:.3f},",
+        total.leaf_evals, total.terminal_nodes, total.tb_hits, total.tt_hits, total.draw_cutoffs, effective_branching_factor());
+    json += std::format("\"movegen_calls\":{},\"movegen_ms\":{:.3f},\"eval_calls\":{},\"eval_ms\":{:.3f},",
+        total.movegen_calls, total.movegen_ns / 1e6, total.eval_calls, total.eval_ns / 1e6);
+
+    json += "\"thread_nodes\":[";
+    for (size_t i = 0; i < thread_nodes.size(); ++i) {
+        json += std::format("{}{}", i ? "," : "", thread_nodes[i]);
+    }
+    json += "]}";
+    return json;
+}
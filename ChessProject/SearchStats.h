@@ -0,0 +1,73 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Search instrumentation. Counters live per thread and are merged at the end
+// of MoveSelector::select_best_move. Build with CHESS_SEARCH_STATS=0 to strip
+// every counter and timer from the search.
+#ifndef CHESS_SEARCH_STATS
+#define CHESS_SEARCH_STATS 1
+#endif
+
+struct ThreadStats {
+    static constexpr int MaxPly = 64;
+
+    std::array<uint64_t, MaxPly> nodes_per_ply{};
+    uint64_t nodes = 0;
+    uint64_t leaf_evals = 0;      // depth-0 evaluations
+    uint64_t terminal_nodes = 0;  // no legal moves (mate/stalemate)
+    uint64_t movegen_calls = 0;
+    uint64_t eval_calls = 0;
+    uint64_t movegen_ns = 0;
+    uint64_t eval_ns = 0;
+    uint64_t tb_hits = 0;         // successful tablebase probes
+    uint64_t tt_hits = 0;         // transposition table cutoffs
+    uint64_t draw_cutoffs = 0;    // repetitions and fifty move rule draws
+    int root_depth = 0;
+
+    void merge(const ThreadStats& other);
+};
+
+struct SearchStats {
+    int depth = 0;
+    int threads = 0;
+    double elapsed_ms = 0.0;
+    ThreadStats total;
+    std::vector<uint64_t> thread_nodes;
+
+    double effective_branching_factor() const;
+    std::string to_json() const;
+};
+
+#if CHESS_SEARCH_STATS
+// Stats of the search running on the calling thread, or nullptr.
+inline thread_local ThreadStats* current_thread_stats = nullptr;
+
+// Adds the lifetime of the scope to a nanosecond counter.
+class StatTimer {
+public:
+    explicit StatTimer(uint64_t* counter)
+        : counter_(counter), start_(counter ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}) {}
+    ~StatTimer() {
+        if (counter_) {
+            *counter_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+        }
+    }
+private:
+    uint64_t* counter_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#define STATS_INC(field) do { if (current_thread_stats) ++current_thread_stats->field; } while (0)
+#define STATS_NODE(depth) do { if (auto* s_ = current_thread_stats) { \
+        ++s_->nodes; int ply_ = s_->root_depth - (depth); \
+        if (ply_ >= 0 && ply_ < ThreadStats::MaxPly) ++s_->nodes_per_ply[ply_]; } } while (0)
+#define STATS_TIMER(field) StatTimer stat_timer_##field(current_thread_stats ? &current_thread_stats->field : nullptr)
+#else
+#define STATS_INC(field) do {} while (0)
+#define STATS_NODE(depth) do {} while (0)
+#define STATS_TIMER(field) do {} while (0)
+#endif
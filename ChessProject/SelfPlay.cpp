@@ -0,0 +1,434 @@
+#include "SelfPlay.h"
+#include "Fen.h"
+#include "MoveGen.h"
+#include "UciEngine.h"
+#include "Zobrist.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <print>
+#include <sstream>
+
+namespace {
+
+const std::string StartFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+class Player {
+public:
+    virtual ~Player() = default;
+    virtual bool new_game() = 0;
+    // Move for the side to move on `board`, which was reached from `start_fen` by `moves`
+    // through the positions with the Zobrist keys in `history`.
+    virtual std::optional<Move> go(const Board& board, const std::string& start_fen,
+                                   const std::vector<std::string>& moves, const std::vector<uint64_t>& history) = 0;
+};
+
+class InProcessPlayer : public Player {
+public:
+    explicit InProcessPlayer(const EngineConfig& config)
+        : selector_(config.threads), limits_(config.limits) {}
+
+    bool new_game() override { return true; }
+
+    std::optional<Move> go(const Board& board, const std::string&, const std::vector<std::string>&,
+                           const std::vector<uint64_t>& history) override {
+        selector_.set_game_history(history);
+        return selector_.search(board, board.get_side_to_move(), limits_);
+    }
+
+private:
+    MoveSelector selector_;
+    SearchLimits limits_;
+};
+
+class UciPlayer : public Player {
+public:
+    explicit UciPlayer(const EngineConfig& config) : config_(config) {}
+
+    bool new_game() override {
+        if (!engine_.is_running()) {
+            if (!engine_.start(config_.command)) return false;
+            for (const auto& [name, value] : config_.options) {
+                engine_.send("setoption name " + name + " value " + value);
+            }
+        }
+        engine_.send("ucinewgame");
+        engine_.send("isready");
+        return engine_.wait_for("readyok", std::chrono::seconds(30)).has_value();
+    }
+
+    std::optional<Move> go(const Board& board, const std::string& start_fen,
+                           const std::vector<std::string>& moves, const std::vector<uint64_t>&) override {
+        std::string position = "position fen " + start_fen;
+        if (!moves.empty()) {
+            position += " moves";
+            for (const auto& m : moves) position += " " + m;
+        }
+        engine_.send(position);
+
+        const SearchLimits& limits = config_.limits;
+        std::string go = "go";
+        if (limits.depth < SearchLimits::MaxDepth) go += " depth " + std::to_string(limits.depth);
+        if (limits.nodes) go += " nodes " + std::to_string(limits.nodes);
+        if (limits.movetime_ms) go += " movetime " + std::to_string(limits.movetime_ms);
+        engine_.send(go);
+
+        // Generous margin over the move time before the engine is declared hung.
+        auto timeout = std::chrono::milliseconds(limits.movetime_ms ? limits.movetime_ms * 5 + 5000 : 300000);
+        auto reply = engine_.wait_for("bestmove", timeout);
+        if (!reply) {
+            engine_.stop(); // restarted for the next game
+            return std::nullopt;
+        }
+        std::istringstream iss(*reply);
+        std::string token, text;
+        iss >> token >> text;
+        return parse_move(board, text);
+    }
+
+private:
+    EngineConfig config_;
+    UciEngine engine_;
+};
+
+std::unique_ptr<Player> make_player(const EngineConfig& config) {
+    if (config.command.empty()) return std::make_unique<InProcessPlayer>(config);
+    return std::make_unique<UciPlayer>(config);
+}
+
+struct Opening {
+    std::string fen;
+};
+
+// Accepts full FENs and EPD lines (whose operations follow the fourth field).
+std::vector<Opening> load_openings(const std::string& path) {
+    std::vector<Opening> openings;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        Board board;
+        if (parse_fen(line, board)) openings.push_back({ board.to_fen() });
+    }
+    return openings;
+}
+
+struct GameRecord {
+    std::string white;
+    std::string black;
+    std::string start_fen;
+    std::vector<std::string> san;
+    std::string result;      // "1-0", "0-1" or "1/2-1/2"
+    std::string termination;
+};
+
+GameRecord play_game(Player& white, Player& black, const EngineConfig& white_config,
+                     const EngineConfig& black_config, const Opening& opening, int max_plies) {
+    GameRecord game{ white_config.name, black_config.name, opening.fen, {}, "1/2-1/2", "" };
+    Board board;
+    board.set_fen(opening.fen);
+    std::vector<uint64_t> keys{ zobrist_key(board) };
+    std::vector<std::string> uci_moves;
+
+    auto win_for = [&](Color winner, const std::string& reason) {
+        game.result = winner == Color::White ? "1-0" : "0-1";
+        game.termination = reason;
+    };
+
+    if (!white.new_game()) { win_for(Color::Black, "white engine failed to start"); return game; }
+    if (!black.new_game()) { win_for(Color::White, "black engine failed to start"); return game; }
+
+    for (int ply = 0;; ++ply) {
+        Color side = board.get_side_to_move();
+        Color opponent = side == Color::White ? Color::Black : Color::White;
+        auto legal = generate_legal_moves(&board, side);
+        if (!legal || legal->empty()) {
+            if (king_in_check(board, side)) win_for(opponent, "checkmate");
+            else game.termination = "stalemate";
+            break;
+        }
+        int halfmove_clock = board.get_halfmove_clock();
+        if (halfmove_clock >= 100) { game.termination = "fifty move rule"; break; }
+        if (std::count(keys.end() - std::min<size_t>(keys.size(), halfmove_clock + 1), keys.end(), keys.back()) >= 3) {
+            game.termination = "threefold repetition";
+            break;
+        }
+        if (insufficient_material(board)) { game.termination = "insufficient material"; break; }
+        if (ply >= max_plies) { game.termination = "adjudicated draw (game length)"; break; }
+
+        Player& player = side == Color::White ? white : black;
+        auto move = player.go(board, opening.fen, uci_moves, { keys.begin(), keys.end() - 1 });
+        if (!move) {
+            win_for(opponent, "engine failure or illegal move");
+            break;
+        }
+
+        game.san.push_back(move_to_san(board, *move));
+        uci_moves.push_back(uci_move(board, *move));
+        apply_move(board, *move);
+        keys.push_back(zobrist_key(board));
+    }
+    return game;
+}
+
+std::string pgn_date() {
+    std::time_t now = std::time(nullptr);
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &now);
+#else
+    localtime_r(&now, &tm);
+#endif
+    char buf[16];
+    std::strftime(buf, sizeof(buf), "%Y.%m.%d", &tm);
+    return buf;
+}
+
+std::string to_pgn(const GameRecord& game, int round) {
+    std::string pgn;
+    pgn += "[Event \"Self-play\"]\n";
+    pgn += "[Site \"local\"]\n";
+    pgn += "[Date \"" + pgn_date() + "\"]\n";
+    pgn += "[Round \"" + std::to_string(round) + "\"]\n";
+    pgn += "[White \"" + game.white + "\"]\n";
+    pgn += "[Black \"" + game.black + "\"]\n";
+    pgn += "[Result \"" + game.result + "\"]\n";
+    if (game.start_fen != StartFen) {
+        pgn += "[SetUp \"1\"]\n";
+        pgn += "[FEN \"" + game.start_fen + "\"]\n";
+    }
+    pgn += "[Termination \"" + game.termination + "\"]\n\n";
+
+    std::istringstream fen(game.start_fen);
+    std::string skip, stm;
+    int move_number = 1;
+    fen >> skip >> stm >> skip >> skip >> skip >> move_number;
+    bool white_to_move = stm != "b";
+
+    // Movetext wrapped at 80 columns
+    std::string line;
+    auto emit = [&](const std::string& token) {
+        if (!line.empty() && line.size() + 1 + token.size() > 80) {
+            pgn += line + "\n";
+            line.clear();
+        }
+        line += (line.empty() ? "" : " ") + token;
+    };
+    for (size_t i = 0; i < game.san.size(); ++i) {
+        if (white_to_move) emit(std::to_string(move_number) + ".");
+        else if (i == 0) emit(std::to_string(move_number) + "...");
+        emit(game.san[i]);
+        if (!white_to_move) ++move_number;
+        white_to_move = !white_to_move;
+    }
+    emit(game.result);
+    pgn += line + "\n\n";
+    return pgn;
+}
+
+double score_to_elo(double score) {
+    score = std::clamp(score, 1e-6, 1.0 - 1e-6);
+    return 400.0 * std::log10(score / (1.0 - score));
+}
+
+double elo_to_score(double elo) {
+    return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+} // namespace
+
+double MatchScore::elo() const {
+    if (games() == 0) return 0.0;
+    return score_to_elo((wins + 0.5 * draws) / games());
+}
+
+double MatchScore::elo_error() const {
+    int n = games();
+    if (n == 0) return 0.0;
+    double w = double(wins) / n, d = double(draws) / n, l = double(losses) / n;
+    double s = w + 0.5 * d;
+    double variance = w * (1 - s) * (1 - s) + d * (0.5 - s) * (0.5 - s) + l * s * s;
+    double margin = 1.959964 * std::sqrt(variance / n);
+    return (score_to_elo(s + margin) - score_to_elo(s - margin)) / 2.0;
+}
+
+// Generalised SPRT with the normal approximation to the trinomial game
+// outcome, as used by common engine testing frameworks.
+double MatchScore::llr(double elo0, double elo1) const {
+    int n = games();
+    if (n == 0) return 0.0;
+    double w = double(wins) / n, d = double(draws) / n, l = double(losses) / n;
+    double s = w + 0.5 * d;
+    double variance = w * (1 - s) * (1 - s) + d * (0.5 - s) * (0.5 - s) + l * s * s;
+    if (variance <= 0.0) return 0.0;
+    double s0 = elo_to_score(elo0), s1 = elo_to_score(elo1);
+    return n * (s1 - s0) * (2 * s - s0 - s1) / (2 * variance);
+}
+
+double SprtParams::lower_bound() const {
+    return std::log(beta / (1 - alpha));
+}
+
+double SprtParams::upper_bound() const {
+    return std::log((1 - beta) / alpha);
+}
+
+std::optional<EngineConfig> parse_engine_config(const std::string& spec) {
+    EngineConfig config;
+    bool has_depth = false;
+    std::istringstream iss(spec);
+    std::string item;
+    try {
+        while (std::getline(iss, item, ',')) {
+            auto eq = item.find('=');
+            if (eq == std::string::npos) return std::nullopt;
+            std::string key = item.substr(0, eq), value = item.substr(eq + 1);
+            if (key == "name") config.name = value;
+            else if (key == "cmd") config.command = value;
+            else if (key == "threads") config.threads = std::stoi(value);
+            else if (key == "depth") { config.limits.depth = std::stoi(value); has_depth = true; }
+            else if (key == "nodes") config.limits.nodes = std::stoull(value);
+            else if (key == "movetime") config.limits.movetime_ms = std::stoll(value);
+            else if (key.starts_with("option.")) config.options.emplace_back(key.substr(7), value);
+            else return std::nullopt;
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    // The built-in search has no UCI options to set.
+    if (config.command.empty() && !config.options.empty()) return std::nullopt;
+    if (!has_depth && (config.limits.nodes || config.limits.movetime_ms)) config.limits.depth = SearchLimits::MaxDepth;
+    if (config.name.empty()) config.name = config.command.empty() ? "engine" : config.command;
+    return config;
+}
+
+std::optional<SelfPlayOptions> parse_selfplay_args(const std::vector<std::string>& args) {
+    SelfPlayOptions options;
+    int engines = 0;
+    try {
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if (arg == "--engine" && has_value && engines < 2) {
+                auto config = parse_engine_config(args[++i]);
+                if (!config) return std::nullopt;
+                options.engines[engines++] = *config;
+            }
+            else if (arg == "--openings" && has_value) options.openings_path = args[++i];
+            else if (arg == "--games" && has_value) options.games = std::stoi(args[++i]);
+            else if (arg == "--concurrency" && has_value) options.concurrency = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--max-plies" && has_value) options.max_plies = std::stoi(args[++i]);
+            else if (arg == "--pgn" && has_value) options.pgn_path = args[++i];
+            else if (arg == "--sprt" && has_value) {
+                // elo0,elo1[,alpha,beta]
+                SprtParams sprt;
+                std::istringstream iss(args[++i]);
+                std::string value;
+                double* fields[] = { &sprt.elo0, &sprt.elo1, &sprt.alpha, &sprt.beta };
+                for (double* field : fields) {
+                    if (!std::getline(iss, value, ',')) break;
+                    *field = std::stod(value);
+                }
+                options.sprt = sprt;
+            }
+            else return std::nullopt;
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    if (engines != 2) return std::nullopt;
+    if (options.engines[0].name == options.engines[1].name) {
+        options.engines[0].name += "-1";
+        options.engines[1].name += "-2";
+    }
+    return options;
+}
+
+int run_selfplay(const SelfPlayOptions& options) {
+    std::vector<Opening> openings;
+    if (!options.openings_path.empty()) {
+        openings = load_openings(options.openings_path);
+        if (openings.empty()) {
+            std::println(stderr, "No usable positions in {}", options.openings_path);
+            return 1;
+        }
+    } else {
+        openings.push_back({ StartFen });
+    }
+
+    std::ofstream pgn;
+    if (!options.pgn_path.empty()) {
+        pgn.open(options.pgn_path, std::ios::trunc);
+        if (!pgn) {
+            std::println(stderr, "Cannot write {}", options.pgn_path);
+            return 1;
+        }
+    }
+
+    const EngineConfig& first = options.engines[0];
+    const EngineConfig& second = options.engines[1];
+    std::println("Self-play {} vs {}: {} games, {} concurrent", first.name, second.name, options.games, options.concurrency);
+
+    MatchScore score;
+    std::mutex result_mutex;
+    std::atomic<int> next_game{0};
+    std::atomic<bool> stop{false};
+    int finished = 0;
+
+    // One game per worker at a time; each worker owns its engine instances.
+    auto worker = [&] {
+        auto first_player = make_player(first);
+        auto second_player = make_player(second);
+        while (!stop.load()) {
+            int game_idx = next_game.fetch_add(1);
+            if (game_idx >= options.games) break;
+
+            const Opening& opening = openings[(game_idx / 2) % openings.size()];
+            bool first_is_white = game_idx % 2 == 0;
+            GameRecord game = first_is_white
+                ? play_game(*first_player, *second_player, first, second, opening, options.max_plies)
+                : play_game(*second_player, *first_player, second, first, opening, options.max_plies);
+
+            std::lock_guard<std::mutex> lock(result_mutex);
+            if (stop.load()) break; // decided while this game was running
+            if (game.result == "1/2-1/2") ++score.draws;
+            else if ((game.result == "1-0") == first_is_white) ++score.wins;
+            else ++score.losses;
+            ++finished;
+            if (pgn) pgn << to_pgn(game, game_idx + 1) << std::flush;
+
+            std::string line = std::format("Game {:>4} {} vs {}: {} ({})  Score {}-{}-{}  Elo {:+.1f} +/- {:.1f}",
+                finished, game.white, game.black, game.result, game.termination,
+                score.wins, score.losses, score.draws, score.elo(), score.elo_error());
+            if (options.sprt) {
+                const SprtParams& sprt = *options.sprt;
+                double llr = score.llr(sprt.elo0, sprt.elo1);
+                line += std::format("  LLR {:.2f} [{:.2f}, {:.2f}]", llr, sprt.lower_bound(), sprt.upper_bound());
+                if (llr >= sprt.upper_bound() || llr <= sprt.lower_bound()) stop = true;
+            }
+            std::println("{}", line);
+        }
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        for (int i = 0; i < options.concurrency; ++i) workers.emplace_back(worker);
+    }
+
+    std::println("Finished {} games: {} wins, {} losses, {} draws for {}. Elo {:+.1f} +/- {:.1f}",
+        score.games(), score.wins, score.losses, score.draws, first.name, score.elo(), score.elo_error());
+    if (options.sprt) {
+        const SprtParams& sprt = *options.sprt;
+        double llr = score.llr(sprt.elo0, sprt.elo1);
+        std::string verdict = llr >= sprt.upper_bound() ? "H1 accepted" : llr <= sprt.lower_bound() ? "H0 accepted" : "inconclusive";
+        std::println("SPRT elo0={} elo1={} alpha={} beta={}: LLR {:.2f}, {}", sprt.elo0, sprt.elo1, sprt.alpha, sprt.beta, llr, verdict);
+    }
+    return 0;
+}
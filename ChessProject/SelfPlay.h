@@ -0,0 +1,60 @@
+#pragma once
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Eval.h"
+
+// One side of a self-play match: the built-in search unless `command` names
+// an external UCI engine to run as a subprocess.
+struct EngineConfig {
+    std::string name;
+    std::string command;
+    std::vector<std::pair<std::string, std::string>> options; // sent with setoption to UCI engines
+    int threads = 1;
+    SearchLimits limits;
+};
+
+// Parses "name=dev,cmd=./engine,depth=5,nodes=20000,movetime=100,threads=1,option.Hash=64".
+// option.* keys need cmd: they are rejected for the built-in search.
+std::optional<EngineConfig> parse_engine_config(const std::string& spec);
+
+// Results from the point of view of the first engine.
+struct MatchScore {
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+
+    int games() const { return wins + draws + losses; }
+    double elo() const;
+    double elo_error() const; // half width of the 95% confidence interval
+    double llr(double elo0, double elo1) const;
+};
+
+struct SprtParams {
+    double elo0 = 0.0;
+    double elo1 = 5.0;
+    double alpha = 0.05;
+    double beta = 0.05;
+
+    double lower_bound() const;
+    double upper_bound() const;
+};
+
+struct SelfPlayOptions {
+    EngineConfig engines[2];
+    std::string openings_path;  // One FEN or EPD per line; the start position when empty
+    int games = 100;            // Played in pairs, each opening once with either color
+    int concurrency = std::max(1u, std::thread::hardware_concurrency());
+    int max_plies = 400;        // Longer games are adjudicated as draws
+    std::string pgn_path;
+    std::optional<SprtParams> sprt;
+};
+
+// Parses the arguments following "selfplay" on the command line.
+std::optional<SelfPlayOptions> parse_selfplay_args(const std::vector<std::string>& args);
+
+// Plays the match and prints the running score; returns the process exit code.
+int run_selfplay(const SelfPlayOptions& options);
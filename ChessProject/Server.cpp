@@ -0,0 +1,566 @@
+#include "Server.h"
+#include "Fen.h"
+#include "Json.h"
+#include "Memory.h"
+#include "MoveGen.h"
+#include "TranspositionTable.h"
+#include "Zobrist.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <print>
+#include "Socket.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t MaxLineLength = 64 * 1024;
+// Answers a client has not read yet; beyond this it is disconnected.
+constexpr size_t MaxPendingOutput = 4 * 1024 * 1024;
+constexpr int MaxMultiPv = 256;
+// Upper bound for node counts, milliseconds and microseconds taken from a
+// request: far beyond any real limit, and exact in every type it is cast to.
+constexpr double MaxRequestCount = 1e15;
+
+// Numeric ids are echoed as integers when they are whole: the shortest form
+// of 100000.0 is "1e+05", which a client matching on its own id misses.
+std::string format_id(double id) {
+    constexpr double MaxExactInteger = 9007199254740992.0;  // 2^53
+    if (std::trunc(id) == id && std::abs(id) <= MaxExactInteger) return std::format("{}", static_cast<int64_t>(id));
+    return std::format("{}", id);
+}
+
+volatile std::sig_atomic_t interrupted = 0;
+
+void on_interrupt(int) {
+    interrupted = 1;
+}
+
+double elapsed_ms(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+struct Request {
+    std::string id;  // encoded as JSON, echoed in the answer
+    Board board;
+    std::vector<uint64_t> history;
+    SearchLimits limits;
+    int multi_pv = 1;
+    Clock::time_point received;
+    std::optional<Clock::time_point> deadline;
+    std::atomic<bool> cancelled{false};
+};
+
+// One connection, or stdin/stdout in --stdio mode. The input is read by the
+// I/O thread only. Answers are written by whichever worker finished the
+// request, as far as the non-blocking socket takes them; the rest waits in
+// `output_` for the I/O thread, so a client that stops reading never
+// blocks a worker or the I/O thread.
+class Client {
+public:
+    explicit Client(Socket socket) : socket_(socket) {}
+    explicit Client(std::ostream& out) : socket_(InvalidSocket), out_(&out) {}
+    ~Client() { close(); }
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    Socket socket() const { return socket_; }
+
+    // Writes or queues one line; dropped once the connection is closed or
+    // broken.
+    void send(const std::string& line) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        if (out_) {
+            *out_ << line << std::endl;
+            return;
+        }
+        if (socket_ == InvalidSocket || broken_) return;
+        output_ += line;
+        output_ += '\n';
+        if (output_.size() > MaxPendingOutput) {
+            broken_ = true;
+            output_.clear();
+            return;
+        }
+        write_pending();
+    }
+
+    // For the I/O thread: whether to wait until the socket takes more output,
+    // and whether the connection failed or overflowed and should be dropped.
+    bool has_output() {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        return !output_.empty();
+    }
+    bool broken() {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        return broken_;
+    }
+    void flush() {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        write_pending();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        output_.clear();
+        if (socket_ == InvalidSocket) return;
+        close_socket(socket_);
+        socket_ = InvalidSocket;
+    }
+
+    std::string input;  // bytes after the last complete line
+
+    // Guarded by Server::mutex_
+    std::deque<std::shared_ptr<Request>> queue;
+    std::vector<std::shared_ptr<Request>> running;
+    bool gone = false;
+
+private:
+    // Called with write_mutex_ held.
+    void write_pending() {
+        if (output_.empty() || socket_ == InvalidSocket || broken_) return;
+        long long sent = send_some(socket_, output_);
+        if (sent < 0) {
+            broken_ = true;
+            output_.clear();
+            return;
+        }
+        output_.erase(0, static_cast<size_t>(sent));
+    }
+
+    Socket socket_;
+    std::ostream* out_ = nullptr;
+    std::mutex write_mutex_;
+    std::string output_;  // accepted lines the socket has not taken yet
+    bool broken_ = false;
+};
+
+class Server {
+public:
+    explicit Server(const ServerOptions& options) : options_(options), tt_(options.hash_mb) {}
+
+    int run();
+
+private:
+    const ServerOptions& options_;
+    TranspositionTable tt_;
+
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable request_done_;
+    // Clients with queued requests; a worker serves the front one and sends
+    // it to the back if it has more, which shares the workers round-robin.
+    std::deque<std::shared_ptr<Client>> turns_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> served_{0};
+
+    Socket open_listener(std::string& address) const;
+    void serve_connections(Socket listener);
+    void serve_stdio();
+    void handle_line(const std::shared_ptr<Client>& client, std::string_view line);
+    std::expected<std::shared_ptr<Request>, std::string> make_request(const JsonObject& object, std::string id) const;
+    void cancel(const std::shared_ptr<Client>& client, const std::string& id);
+    void disconnect(const std::shared_ptr<Client>& client);
+
+    std::pair<std::shared_ptr<Client>, std::shared_ptr<Request>> next_request();
+    std::string analyse(MoveSelector& selector, Request& request);
+    void worker(int index);
+};
+
+Socket Server::open_listener(std::string& address) const {
+    Socket listener = InvalidSocket;
+    if (options_.port) {
+        address = std::format("127.0.0.1:{}", options_.port);
+        listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listener == InvalidSocket) return InvalidSocket;
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(options_.port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close_socket(listener);
+            return InvalidSocket;
+        }
+    } else {
+        address = options_.socket_path;
+        sockaddr_un addr{};
+        if (options_.socket_path.size() >= sizeof(addr.sun_path)) return InvalidSocket;
+        addr.sun_family = AF_UNIX;
+        options_.socket_path.copy(addr.sun_path, options_.socket_path.size());
+        // A socket left behind by a server that did not shut down cleanly.
+        std::error_code ec;
+        if (std::filesystem::is_socket(options_.socket_path, ec)) std::filesystem::remove(options_.socket_path, ec);
+        listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener == InvalidSocket) return InvalidSocket;
+        if (bind(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close_socket(listener);
+            return InvalidSocket;
+        }
+    }
+    if (listen(listener, SOMAXCONN) != 0) {
+        close_socket(listener);
+        return InvalidSocket;
+    }
+    return listener;
+}
+
+// Accepts connections and reads requests until interrupted. Searches never
+// run on this thread, so a busy pool does not delay cancellations.
+void Server::serve_connections(Socket listener) {
+    std::vector<std::shared_ptr<Client>> clients;
+    std::vector<pollfd> fds;
+    std::array<char, 4096> buffer;
+
+    while (!interrupted) {
+        fds.clear();
+        fds.push_back({ listener, POLLIN, 0 });
+        for (const auto& client : clients) {
+            short events = client->has_output() ? POLLIN | POLLOUT : POLLIN;
+            fds.push_back({ client->socket(), events, 0 });
+        }
+        // The timeout bounds how long an interrupt, or a client a worker found
+        // broken, goes unnoticed.
+        if (poll_sockets(fds.data(), fds.size(), 200) < 0) continue;
+
+        for (size_t i = 1; i < fds.size(); ++i) {
+            const auto& client = clients[i - 1];
+            if (fds[i].revents & POLLOUT) client->flush();
+            if (client->broken()) {
+                disconnect(client);
+                continue;
+            }
+            if (!(fds[i].revents & ~POLLOUT)) continue;
+            auto n = recv(client->socket(), buffer.data(), static_cast<int>(buffer.size()), 0);
+            if (n <= 0) {
+                disconnect(client);
+                continue;
+            }
+            client->input.append(buffer.data(), static_cast<size_t>(n));
+            size_t start = 0;
+            for (size_t end; (end = client->input.find('\n', start)) != std::string::npos; start = end + 1) {
+                std::string_view line(client->input.data() + start, end - start);
+                if (line.ends_with('\r')) line.remove_suffix(1);
+                if (line.find_first_not_of(" \t") != std::string_view::npos) handle_line(client, line);
+            }
+            client->input.erase(0, start);
+            if (client->input.size() > MaxLineLength) {
+                client->send("{\"id\":null,\"error\":\"line too long\"}");
+                disconnect(client);
+            }
+        }
+        std::erase_if(clients, [](const auto& client) { return client->gone; });
+
+        if (fds[0].revents & POLLIN) {
+            Socket socket = accept(listener, nullptr, nullptr);
+            if (socket != InvalidSocket && set_nonblocking(socket)) clients.push_back(std::make_shared<Client>(socket));
+            else if (socket != InvalidSocket) close_socket(socket);
+        }
+    }
+    for (const auto& client : clients) disconnect(client);
+}
+
+// Reads requests from stdin and answers on stdout, for a coordinator that
+// runs this process over pipes. End of input waits for the answers.
+void Server::serve_stdio() {
+    auto client = std::make_shared<Client>(std::cout);
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.ends_with('\r')) line.pop_back();
+        if (line.find_first_not_of(" \t") != std::string::npos) handle_line(client, line);
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    request_done_.wait(lock, [&] { return client->queue.empty() && client->running.empty(); });
+}
+
+void Server::handle_line(const std::shared_ptr<Client>& client, std::string_view line) {
+    auto object = parse_json_object(line);
+    if (!object) {
+        client->send(std::format("{{\"id\":null,\"error\":\"{}\"}}", json_escape(object.error())));
+        return;
+    }
+
+    std::string id = "null";
+    if (auto it = object->find("id"); it != object->end()) {
+        if (it->second.type == JsonValue::Type::String) id = std::format("\"{}\"", json_escape(it->second.string));
+        else if (it->second.type == JsonValue::Type::Number) id = format_id(it->second.number);
+    }
+    if (auto it = object->find("cancel"); it != object->end() && it->second.boolean) {
+        cancel(client, id);
+        return;
+    }
+
+    auto request = make_request(*object, id);
+    if (!request) {
+        client->send(std::format("{{\"id\":{},\"error\":\"{}\"}}", id, json_escape(request.error())));
+        return;
+    }
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (client->queue.size() < options_.max_pending) {
+            if (client->queue.empty()) turns_.push_back(client);
+            client->queue.push_back(std::move(*request));
+            queued = true;
+        }
+    }
+    if (!queued) {
+        client->send(std::format("{{\"id\":{},\"error\":\"queue full\"}}", id));
+        return;
+    }
+    work_ready_.notify_one();
+}
+
+std::expected<std::shared_ptr<Request>, std::string> Server::make_request(const JsonObject& object, std::string id) const {
+    auto request = std::make_shared<Request>();
+    request->id = std::move(id);
+    request->received = Clock::now();
+
+    auto number = [&](std::string_view key) -> std::optional<double> {
+        auto it = object.find(key);
+        if (it == object.end() || it->second.type != JsonValue::Type::Number) return std::nullopt;
+        return it->second.number;
+    };
+
+    auto fen = object.find("fen");
+    if (fen == object.end() || fen->second.type != JsonValue::Type::String) return std::unexpected("missing fen");
+    if (fen->second.string == "startpos") request->board.setup_initial_position();
+    else if (!parse_fen(fen->second.string, request->board, FenMode::Strict)) return std::unexpected("invalid position");
+
+    if (auto moves = object.find("moves"); moves != object.end()) {
+        if (moves->second.type != JsonValue::Type::Array) return std::unexpected("moves must be an array");
+        for (const JsonValue& text : moves->second.array) {
+            if (text.type != JsonValue::Type::String) return std::unexpected("moves must be strings");
+            auto move = parse_move(request->board, text.string);
+            if (!move) return std::unexpected(std::format("illegal move {}", text.string));
+            request->history.push_back(zobrist_key(request->board));
+            apply_move(request->board, *move);
+        }
+    }
+
+    // Values are clamped before the casts, which are undefined out of range.
+    for (std::string_view key : { "depth", "nodes", "movetime", "multipv", "deadline" }) {
+        if (auto value = number(key); value && !std::isfinite(*value)) return std::unexpected(std::format("invalid {}", key));
+    }
+    auto depth = number("depth");
+    auto nodes = number("nodes");
+    auto movetime = number("movetime");
+    if (depth && *depth < 0) return std::unexpected("invalid depth");
+    if (!depth && !nodes && !movetime) {
+        request->limits = options_.limits;
+    } else {
+        request->limits.depth = depth ? static_cast<int>(std::clamp(*depth, 1.0, double(SearchLimits::MaxDepth)))
+                                      : SearchLimits::MaxDepth;
+        request->limits.nodes = nodes ? static_cast<uint64_t>(std::clamp(*nodes, 0.0, MaxRequestCount)) : 0;
+        request->limits.movetime_ms = movetime ? static_cast<int64_t>(std::clamp(*movetime, 0.0, MaxRequestCount)) : 0;
+    }
+    if (auto lines = number("multipv")) request->multi_pv = static_cast<int>(std::clamp(*lines, 1.0, double(MaxMultiPv)));
+    if (auto deadline = number("deadline"); deadline && *deadline > 0) {
+        auto micros = static_cast<int64_t>(std::min(*deadline * 1000, MaxRequestCount));
+        request->deadline = request->received + std::chrono::microseconds(micros);
+    }
+    return request;
+}
+
+void Server::cancel(const std::shared_ptr<Client>& client, const std::string& id) {
+    size_t dropped = 0;
+    bool running = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dropped = std::erase_if(client->queue, [&](const auto& request) { return request->id == id; });
+        if (dropped && client->queue.empty()) std::erase(turns_, client);
+        for (const auto& request : client->running) {
+            if (request->id != id) continue;
+            request->cancelled.store(true, std::memory_order_relaxed);
+            running = true;
+        }
+    }
+    // A running request is answered by its worker, with the depth it reached.
+    for (size_t i = 0; i < dropped; ++i) client->send(std::format("{{\"id\":{},\"cancelled\":true}}", id));
+    if (!dropped && !running) client->send(std::format("{{\"id\":{},\"error\":\"no such request\"}}", id));
+}
+
+void Server::disconnect(const std::shared_ptr<Client>& client) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (client->gone) return;
+        client->gone = true;
+        if (!client->queue.empty()) std::erase(turns_, client);
+        client->queue.clear();
+        for (const auto& request : client->running) request->cancelled.store(true, std::memory_order_relaxed);
+    }
+    client->close();
+}
+
+std::pair<std::shared_ptr<Client>, std::shared_ptr<Request>> Server::next_request() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_ready_.wait(lock, [&] { return !turns_.empty() || stopping_; });
+    if (stopping_) return {};
+    auto client = std::move(turns_.front());
+    turns_.pop_front();
+    auto request = std::move(client->queue.front());
+    client->queue.pop_front();
+    if (!client->queue.empty()) turns_.push_back(client);
+    client->running.push_back(request);
+    return { std::move(client), std::move(request) };
+}
+
+std::string Server::analyse(MoveSelector& selector, Request& request) {
+    auto start = Clock::now();
+    double queue_ms = elapsed_ms(request.received, start);
+    std::string json = std::format("{{\"id\":{},", request.id);
+    if (request.cancelled.load()) return json + "\"cancelled\":true}";
+    if (request.deadline && start >= *request.deadline) {
+        return json + std::format("\"error\":\"deadline expired\",\"queue_ms\":{:.1f}}}", queue_ms);
+    }
+
+    const Board& board = request.board;
+    Color side = board.get_side_to_move();
+    auto moves = generate_legal_moves(&board, side);
+    if (!moves) return json + std::format("\"error\":\"{}\"}}", json_escape(moves.error()));
+    if (moves->empty()) {
+        return json + std::format("\"bestmove\":null,\"result\":\"{}\"}}",
+                                  king_in_check(board, side) ? "checkmate" : "stalemate");
+    }
+
+    SearchLimits limits = request.limits;
+    limits.stop = &request.cancelled;
+    if (request.deadline) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(*request.deadline - start).count();
+        remaining = std::max<int64_t>(remaining, 1);
+        limits.movetime_ms = limits.movetime_ms ? std::min(limits.movetime_ms, remaining) : remaining;
+    }
+    selector.set_game_history(request.history);
+    selector.set_multi_pv(request.multi_pv);
+    Move best = selector.search(board, side, limits);
+    const SearchStats& stats = selector.last_stats();
+
+    json += std::format("\"bestmove\":\"{}\",\"score\":{},\"depth\":{},\"nodes\":{},\"time_ms\":{:.1f},\"queue_ms\":{:.1f},",
+                        uci_move(board, best), selector.last_score(), stats.depth, stats.total.nodes, stats.elapsed_ms,
+                        queue_ms);
+    if (request.cancelled.load()) json += "\"cancelled\":true,";
+    json += "\"lines\":[";
+    const auto& lines = selector.last_lines();
+    for (size_t i = 0; i < lines.size(); ++i) {
+        json += std::format("{}{{\"multipv\":{},\"score\":{},\"pv\":[", i ? "," : "", i + 1, lines[i].score);
+        Board line = board;
+        for (size_t ply = 0; ply < lines[i].pv.size(); ++ply) {
+            json += std::format("{}\"{}\"", ply ? "," : "", uci_move(line, lines[i].pv[ply]));
+            apply_move(line, lines[i].pv[ply]);
+        }
+        json += "]}";
+    }
+    return json + "]}";
+}
+
+void Server::worker(int index) {
+    bind_thread_to_node(index);
+    MoveSelector selector(1);
+    selector.set_transposition_table(&tt_);
+    while (true) {
+        auto [client, request] = next_request();
+        if (!request) return;
+        std::string answer = analyse(selector, *request);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::erase(client->running, request);
+        }
+        request_done_.notify_all();
+        client->send(answer);
+        served_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+int Server::run() {
+    std::string address = "stdin";
+    Socket listener = InvalidSocket;
+    if (!options_.stdio) {
+        listener = open_listener(address);
+        if (listener == InvalidSocket) {
+            std::println(stderr, "Cannot listen on {}", address);
+            return 1;
+        }
+    }
+    std::println(stderr, "Serving on {}: {} workers, {} MB hash, {}; {}", address, options_.workers, tt_.megabytes(),
+                 tt_.page_description(), numa_description());
+
+    auto start = Clock::now();
+    {
+        std::vector<std::jthread> pool;
+        for (int i = 0; i < options_.workers; ++i) pool.emplace_back([this, i] { worker(i); });
+        if (options_.stdio) serve_stdio();
+        else serve_connections(listener);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_ready_.notify_all();
+    }
+    if (listener != InvalidSocket) {
+        close_socket(listener);
+        std::error_code ec;
+        if (!options_.port) std::filesystem::remove(options_.socket_path, ec);
+    }
+
+    double seconds = elapsed_ms(start, Clock::now()) / 1000;
+    uint64_t served = served_.load();
+    std::println(stderr, "Served {} requests in {:.1f} s ({:.1f} requests/s)", served, seconds,
+                 seconds > 0 ? served / seconds : 0.0);
+    return 0;
+}
+
+} // namespace
+
+std::optional<ServerOptions> parse_server_args(const std::vector<std::string>& args) {
+    ServerOptions options;
+    bool has_depth = false;
+    try {
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if (arg == "--socket" && has_value) options.socket_path = args[++i];
+            else if (arg == "--port" && has_value) options.port = std::stoi(args[++i]);
+            else if (arg == "--stdio") options.stdio = true;
+            else if (arg == "--workers" && has_value) options.workers = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--hash" && has_value) options.hash_mb = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--depth" && has_value) { options.limits.depth = std::stoi(args[++i]); has_depth = true; }
+            else if (arg == "--nodes" && has_value) options.limits.nodes = std::stoull(args[++i]);
+            else if (arg == "--movetime" && has_value) options.limits.movetime_ms = std::stoll(args[++i]);
+            else if (arg == "--max-pending" && has_value) options.max_pending = std::max(1, std::stoi(args[++i]));
+            else return std::nullopt;
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    if (!options.socket_path.empty() + (options.port != 0) + options.stdio != 1) return std::nullopt;
+    if (options.port < 0 || options.port > 65535) return std::nullopt;
+    if (!has_depth && (options.limits.nodes || options.limits.movetime_ms)) options.limits.depth = SearchLimits::MaxDepth;
+    return options;
+}
+
+int run_server(const ServerOptions& options) {
+    if (!sockets_startup()) {
+        std::println(stderr, "Cannot initialise sockets");
+        return 1;
+    }
+    // Over pipes the coordinator ends the process by closing its input.
+    if (!options.stdio) {
+        std::signal(SIGINT, on_interrupt);
+        std::signal(SIGTERM, on_interrupt);
+    }
+    int result = Server(options).run();
+    sockets_cleanup();
+    return result;
+}
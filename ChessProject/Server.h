@@ -0,0 +1,35 @@
+#pragma once
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Eval.h"
+
+struct ServerOptions {
+    std::string socket_path;   // Unix domain socket to listen on
+    int port = 0;              // TCP port on 127.0.0.1, used instead of socket_path when set
+    bool stdio = false;        // requests on stdin, answers on stdout, e.g. as a coordinator's worker
+    int workers = std::max(1u, std::thread::hardware_concurrency());
+    size_t hash_mb = 256;      // one table shared by all workers
+    SearchLimits limits;       // for requests that give no depth, nodes or movetime
+    size_t max_pending = 256;  // queued requests per client
+};
+
+// Parses the arguments following "serve" on the command line.
+std::optional<ServerOptions> parse_server_args(const std::vector<std::string>& args);
+
+// Serves analysis requests until interrupted. Clients send one JSON object
+// per line and get one JSON object back per request, in completion order:
+//
+//   {"id":"q1","fen":"<fen>"|"startpos","moves":["e2e4"],"depth":8,"nodes":n,
+//    "movetime":ms,"multipv":3,"deadline":ms}
+//   {"id":"q1","cancel":true}
+//
+// Requests run single-threaded on a pool of workers sharing one warm hash
+// table. Each client has its own queue and the workers take from the queues
+// in turn, so a client with a long backlog does not hold up the others. A
+// deadline, in ms from arrival, drops a request still queued when it passes
+// and caps the search time of a running one. Cancelling a running request
+// answers it with the last completed depth.
+int run_server(const ServerOptions& options);
@@ -0,0 +1,115 @@
+#include "Socket.h"
+#include <csignal>
+#ifdef _WIN32
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <cerrno>
+#include <fcntl.h>
+#endif
+
+bool sockets_startup() {
+#ifdef _WIN32
+    WSADATA wsa;
+    return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+#else
+    std::signal(SIGPIPE, SIG_IGN);
+    return true;
+#endif
+}
+
+void sockets_cleanup() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void close_socket(Socket socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    ::close(socket);
+#endif
+}
+
+int poll_sockets(pollfd* fds, size_t count, int timeout_ms) {
+#ifdef _WIN32
+    return WSAPoll(fds, static_cast<ULONG>(count), timeout_ms);
+#else
+    return ::poll(fds, count, timeout_ms);
+#endif
+}
+
+bool send_all(Socket socket, std::string_view data) {
+    while (!data.empty()) {
+        auto n = ::send(socket, data.data(), static_cast<int>(data.size()), 0);
+        if (n <= 0) return false;
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return true;
+}
+
+bool set_nonblocking(Socket socket) {
+#ifdef _WIN32
+    u_long on = 1;
+    return ioctlsocket(socket, FIONBIO, &on) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL);
+    return flags != -1 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+long long send_some(Socket socket, std::string_view data) {
+    long long sent = 0;
+    while (!data.empty()) {
+        auto n = ::send(socket, data.data(), static_cast<int>(data.size()), 0);
+        if (n <= 0) {
+#ifdef _WIN32
+            bool would_block = n < 0 && WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+            bool would_block = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+#endif
+            return would_block ? sent : -1;
+        }
+        sent += n;
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return sent;
+}
+
+Socket connect_socket(const std::string& address) {
+    if (address.starts_with("unix:")) {
+        std::string path = address.substr(5);
+        sockaddr_un addr{};
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) return InvalidSocket;
+        addr.sun_family = AF_UNIX;
+        path.copy(addr.sun_path, path.size());
+        Socket socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socket == InvalidSocket) return InvalidSocket;
+        if (connect(socket, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close_socket(socket);
+            return InvalidSocket;
+        }
+        return socket;
+    }
+
+    if (!address.starts_with("tcp:")) return InvalidSocket;
+    size_t colon = address.rfind(':');
+    if (colon <= 4) return InvalidSocket;
+    std::string host = address.substr(4, colon - 4);
+    std::string port = address.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) return InvalidSocket;
+    Socket socket = InvalidSocket;
+    for (addrinfo* ai = found; ai; ai = ai->ai_next) {
+        socket = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (socket == InvalidSocket) continue;
+        if (connect(socket, ai->ai_addr, static_cast<int>(ai->ai_addrlen)) == 0) break;
+        close_socket(socket);
+        socket = InvalidSocket;
+    }
+    freeaddrinfo(found);
+    return socket;
+}
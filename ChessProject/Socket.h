@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// Thin layer over BSD sockets and Winsock for the serve and coordinate modes.
+// Pulls in the platform socket headers, so include it from .cpp files only.
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+using Socket = SOCKET;
+constexpr Socket InvalidSocket = INVALID_SOCKET;
+#else
+using Socket = int;
+constexpr Socket InvalidSocket = -1;
+#endif
+
+// Winsock needs initialising once per process; no-ops elsewhere. Also stops
+// a write to a closed connection from raising SIGPIPE.
+bool sockets_startup();
+void sockets_cleanup();
+
+void close_socket(Socket socket);
+int poll_sockets(pollfd* fds, size_t count, int timeout_ms);
+
+// Writes all of `data`; false when the connection is gone.
+bool send_all(Socket socket, std::string_view data);
+
+// Makes send and recv return at once instead of waiting for the peer.
+bool set_nonblocking(Socket socket);
+
+// Writes as much of `data` as a non-blocking socket takes now: the byte
+// count, possibly 0, or -1 when the connection is gone.
+long long send_some(Socket socket, std::string_view data);
+
+// Connects to "unix:/path/to/socket" or "tcp:host:port". Returns
+// InvalidSocket when the address is malformed or nothing listens there.
+Socket connect_socket(const std::string& address);
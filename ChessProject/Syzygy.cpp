@@ -0,0 +1,919 @@
+#include "Syzygy.h"
+#include "MoveGen.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+// Port of the Syzygy probing code (originally by Ronald de Man) to the
+// engine's mailbox board. Squares are numbered a1 = 0 ... h8 = 63 and pieces
+// use the file format coding: white P..K = 1..6, black P..K = 9..14.
+
+namespace {
+
+constexpr int TbPieces = 7;
+
+enum TbFlag { STM = 1, Mapped = 2, WinPlies = 4, LossPlies = 8, Wide = 16, SingleValue = 128 };
+enum ProbeState { Fail = 0, Ok = 1, ChangeStm = -1, ZeroingBestMove = 2 };
+
+int map_pawns[64];
+int map_b1h1h7[64];
+int map_a1d1d4[64];
+int map_kk[10][64];
+int binomial[6][64];
+int lead_pawn_idx[6][64];
+int lead_pawns_size[6][4];
+
+int file_of(int sq) { return sq & 7; }
+int rank_of(int sq) { return sq >> 3; }
+int off_a1h8(int sq) { return rank_of(sq) - file_of(sq); }
+
+uint16_t read_le16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t read_le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+uint32_t read_be32(const uint8_t* p) { return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+uint64_t read_be64(const uint8_t* p) { return (static_cast<uint64_t>(read_be32(p)) << 32) | read_be32(p + 4); }
+
+WdlScore negate(WdlScore w) { return static_cast<WdlScore>(-static_cast<int>(w)); }
+
+// DTZ tables do not store the value of zeroing moves; recover it from the WDL.
+int dtz_before_zeroing(WdlScore wdl) {
+    switch (wdl) {
+        case WdlScore::Win: return 1;
+        case WdlScore::CursedWin: return 101;
+        case WdlScore::BlessedLoss: return -101;
+        case WdlScore::Loss: return -1;
+        default: return 0;
+    }
+}
+
+template <typename T> int sign_of(T v) { return (T(0) < v) - (v < T(0)); }
+
+using Sym = uint16_t;
+
+// Btree entry: 3 bytes holding the left (low 12 bits) and right (high 12 bits) child symbol.
+Sym lr_left(const uint8_t* lr) { return static_cast<Sym>(((lr[1] & 0xF) << 8) | lr[0]); }
+Sym lr_right(const uint8_t* lr) { return static_cast<Sym>((lr[2] << 4) | (lr[1] >> 4)); }
+
+// Decoding information for one sub-table (side to move x leading pawn file).
+struct PairsData {
+    uint8_t flags = 0;
+    uint8_t max_sym_len = 0;
+    uint8_t min_sym_len = 0;
+    uint32_t num_blocks = 0;
+    size_t block_size = 0;
+    size_t span = 0;
+    const uint8_t* lowest_sym = nullptr;   // LE uint16 per symbol length
+    const uint8_t* btree = nullptr;        // 3-byte pair entries
+    const uint8_t* block_length = nullptr; // LE uint16 per block
+    uint32_t block_length_size = 0;
+    const uint8_t* sparse_index = nullptr; // 6-byte entries: block (LE32), offset (LE16)
+    size_t sparse_index_size = 0;
+    const uint8_t* data = nullptr;
+    std::vector<uint64_t> base64;
+    std::vector<uint8_t> symlen;
+    int pieces[TbPieces] = {};
+    uint64_t group_idx[TbPieces + 1] = {};
+    int group_len[TbPieces + 1] = {};
+    uint16_t map_idx[4] = {};              // Win, Loss, CursedWin, BlessedLoss (DTZ only)
+};
+
+struct TbTable {
+    bool is_wdl = true;
+    std::string name;                      // e.g. "KRPvKR"
+    std::string path;
+    std::atomic<bool> ready{false};
+    MappedFile file;
+    bool mapped_ok = false;
+    const uint8_t* dtz_map = nullptr;
+    uint64_t key = 0;                      // material key with the first side white
+    uint64_t key2 = 0;                     // material key with the colors swapped
+    int piece_count = 0;
+    bool has_pawns = false;
+    bool has_unique_pieces = false;
+    uint8_t pawn_count[2] = {};            // [lead color, other color]
+    PairsData items[2][4];                 // [side to move][leading pawn file]
+
+    int sides() const { return is_wdl ? 2 : 1; }
+    PairsData* get(int stm, int f) { return &items[stm % sides()][has_pawns ? f : 0]; }
+};
+
+// Material key: 4 bits per (color, piece type) count.
+uint64_t material_key(const int counts[2][6]) {
+    uint64_t key = 0;
+    for (int c = 0; c < 2; ++c)
+        for (int t = 0; t < 6; ++t)
+            key |= static_cast<uint64_t>(counts[c][t] & 0xF) << (4 * (6 * c + t));
+    return key;
+}
+
+// Board reduced to what the encoder needs.
+struct TbPosition {
+    uint8_t piece[64] = {};  // 0 = empty, otherwise the file format coding
+    int stm = 0;             // 0 = white, 1 = black
+    int counts[2][6] = {};
+    uint64_t key = 0;
+    int total = 0;
+};
+
+TbPosition make_position(const Board& board) {
+    TbPosition pos;
+    for (int rank = 0; rank < Board::Size; ++rank) {
+        for (int file = 0; file < Board::Size; ++file) {
+            const auto& sq = board.at(rank, file);
+            if (!sq) continue;
+            int c = sq->color == Color::White ? 0 : 1;
+            int t = static_cast<int>(sq->type);
+            pos.piece[rank * 8 + file] = static_cast<uint8_t>((c << 3) | (t + 1));
+            ++pos.counts[c][t];
+            ++pos.total;
+        }
+    }
+    pos.stm = board.get_side_to_move() == Color::White ? 0 : 1;
+    pos.key = material_key(pos.counts);
+    return pos;
+}
+
+class TbRegistry {
+public:
+    void clear() {
+        index_.clear();
+        wdl_.clear();
+        dtz_.clear();
+        max_pieces_ = 0;
+    }
+
+    void add(const std::string& name, const std::vector<std::string>& dirs);
+    int size() const { return static_cast<int>(wdl_.size()); }
+    int max_pieces() const { return max_pieces_; }
+
+    std::pair<TbTable*, TbTable*> find(uint64_t key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) return { nullptr, nullptr };
+        return { &wdl_[it->second], &dtz_[it->second] };
+    }
+
+private:
+    std::unordered_map<uint64_t, size_t> index_;
+    std::deque<TbTable> wdl_;
+    std::deque<TbTable> dtz_;
+    int max_pieces_ = 0;
+};
+
+TbRegistry registry;
+std::mutex map_mutex;
+
+std::string find_file(const std::vector<std::string>& dirs, const std::string& file) {
+    for (const auto& dir : dirs) {
+        std::filesystem::path p = std::filesystem::path(dir) / file;
+        std::error_code ec;
+        if (std::filesystem::is_regular_file(p, ec)) return p.string();
+    }
+    return {};
+}
+
+void TbRegistry::add(const std::string& name, const std::vector<std::string>& dirs) {
+    int counts[2][6] = {};
+    int side = 0;
+    for (char ch : name) {
+        if (ch == 'v') { side = 1; continue; }
+        const char* types = "PNBRQK";
+        const char* p = std::strchr(types, ch);
+        if (!p || !*p) return;
+        ++counts[side][p - types];
+    }
+    if (side != 1 || counts[0][5] != 1 || counts[1][5] != 1) return;
+
+    int swapped[2][6];
+    for (int t = 0; t < 6; ++t) {
+        swapped[0][t] = counts[1][t];
+        swapped[1][t] = counts[0][t];
+    }
+    uint64_t key = material_key(counts);
+    if (index_.count(key)) return;
+
+    TbTable& wdl = wdl_.emplace_back();
+    wdl.is_wdl = true;
+    wdl.name = name;
+    wdl.path = find_file(dirs, name + ".rtbw");
+    wdl.key = key;
+    wdl.key2 = material_key(swapped);
+    for (int c = 0; c < 2; ++c)
+        for (int t = 0; t < 6; ++t) {
+            wdl.piece_count += counts[c][t];
+            if (t < 5 && counts[c][t] == 1) wdl.has_unique_pieces = true;
+        }
+    wdl.has_pawns = counts[0][0] + counts[1][0] > 0;
+
+    // The leading color is the one with fewer pawns (better compression).
+    bool white_leads = !counts[1][0] || (counts[0][0] && counts[1][0] >= counts[0][0]);
+    wdl.pawn_count[0] = static_cast<uint8_t>(white_leads ? counts[0][0] : counts[1][0]);
+    wdl.pawn_count[1] = static_cast<uint8_t>(white_leads ? counts[1][0] : counts[0][0]);
+
+    TbTable& dtz = dtz_.emplace_back();
+    dtz.is_wdl = false;
+    dtz.name = name;
+    dtz.path = find_file(dirs, name + ".rtbz");
+    dtz.key = wdl.key;
+    dtz.key2 = wdl.key2;
+    dtz.piece_count = wdl.piece_count;
+    dtz.has_pawns = wdl.has_pawns;
+    dtz.has_unique_pieces = wdl.has_unique_pieces;
+    dtz.pawn_count[0] = wdl.pawn_count[0];
+    dtz.pawn_count[1] = wdl.pawn_count[1];
+
+    index_[wdl.key] = wdl_.size() - 1;
+    index_[wdl.key2] = wdl_.size() - 1;
+    max_pieces_ = std::max(max_pieces_, wdl.piece_count);
+}
+
+void init_index_tables() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        // map_b1h1h7 encodes a square below the a1-h8 diagonal to 0..27
+        int code = 0;
+        for (int s = 0; s < 64; ++s)
+            if (off_a1h8(s) < 0) map_b1h1h7[s] = code++;
+
+        // map_a1d1d4 encodes a square in the a1-d1-d4 triangle to 0..9,
+        // diagonal squares last
+        std::vector<int> diagonal;
+        code = 0;
+        for (int s : { 0, 1, 2, 3, 9, 10, 11, 18, 19, 27 }) {
+            if (off_a1h8(s) < 0) map_a1d1d4[s] = code++;
+            else if (!off_a1h8(s)) diagonal.push_back(s);
+        }
+        for (int s : diagonal) map_a1d1d4[s] = code++;
+
+        // map_kk encodes the 462 legal placements of two kings with the first
+        // in the a1-d1-d4 triangle; both-on-diagonal placements come last.
+        std::vector<std::pair<int, int>> both_on_diagonal;
+        code = 0;
+        for (int idx = 0; idx < 10; ++idx)
+            for (int s1 = 0; s1 <= 27; ++s1)
+                if (map_a1d1d4[s1] == idx && (idx || s1 == 1)) {
+                    for (int s2 = 0; s2 < 64; ++s2) {
+                        if (std::abs(rank_of(s1) - rank_of(s2)) <= 1 && std::abs(file_of(s1) - file_of(s2)) <= 1)
+                            continue; // adjacent or same square
+                        else if (!off_a1h8(s1) && off_a1h8(s2) > 0)
+                            continue; // first on diagonal, second above
+                        else if (!off_a1h8(s1) && !off_a1h8(s2))
+                            both_on_diagonal.emplace_back(idx, s2);
+                        else
+                            map_kk[idx][s2] = code++;
+                    }
+                }
+        for (auto [idx, s2] : both_on_diagonal) map_kk[idx][s2] = code++;
+
+        // binomial[k][n]: ways to choose k of n
+        binomial[0][0] = 1;
+        for (int n = 1; n < 64; ++n)
+            for (int k = 0; k < 6 && k <= n; ++k)
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+
+        // map_pawns encodes a2-h7 to 0..47; the leading pawn is the one with the
+        // highest value (nearest the edge, then lowest rank).
+        int available = 47;
+        for (int lead = 1; lead <= 5; ++lead)
+            for (int f = 0; f < 4; ++f) {
+                int idx = 0;
+                for (int r = 1; r <= 6; ++r) {
+                    int sq = r * 8 + f;
+                    if (lead == 1) {
+                        map_pawns[sq] = available--;
+                        map_pawns[sq ^ 7] = available--;
+                    }
+                    lead_pawn_idx[lead][sq] = idx;
+                    idx += binomial[lead - 1][map_pawns[sq]];
+                }
+                lead_pawns_size[lead][f] = idx;
+            }
+    });
+}
+
+int decompress_pairs(PairsData* d, uint64_t idx) {
+    if (d->flags & SingleValue) return d->min_sym_len;
+
+    // Locate the block through the sparse index, then walk to the exact block.
+    uint32_t k = static_cast<uint32_t>(idx / d->span);
+    const uint8_t* entry = d->sparse_index + 6 * static_cast<size_t>(k);
+    uint32_t block = read_le32(entry);
+    int offset = read_le16(entry + 4);
+    int diff = static_cast<int>(idx % d->span) - static_cast<int>(d->span / 2);
+    offset += diff;
+
+    while (offset < 0) offset += read_le16(d->block_length + 2 * static_cast<size_t>(--block)) + 1;
+    while (offset > read_le16(d->block_length + 2 * static_cast<size_t>(block)))
+        offset -= read_le16(d->block_length + 2 * static_cast<size_t>(block++)) + 1;
+
+    const uint8_t* ptr = d->data + static_cast<uint64_t>(block) * d->block_size;
+    uint64_t buf64 = read_be64(ptr);
+    ptr += 8;
+    int buf64_size = 64;
+    Sym sym;
+
+    while (true) {
+        int len = 0;
+        while (buf64 < d->base64[len]) ++len;
+
+        sym = static_cast<Sym>((buf64 - d->base64[len]) >> (64 - len - d->min_sym_len));
+        sym = static_cast<Sym>(sym + read_le16(d->lowest_sym + 2 * len));
+
+        if (offset < d->symlen[sym] + 1) break;
+
+        offset -= d->symlen[sym] + 1;
+        len += d->min_sym_len;
+        buf64 <<= len;
+        buf64_size -= len;
+        if (buf64_size <= 32) {
+            buf64_size += 32;
+            buf64 |= static_cast<uint64_t>(read_be32(ptr)) << (64 - buf64_size);
+            ptr += 4;
+        }
+    }
+
+    // Expand the pair symbol down to the leaf holding the value.
+    while (d->symlen[sym]) {
+        Sym left = lr_left(d->btree + 3 * sym);
+        if (offset < d->symlen[left] + 1) {
+            sym = left;
+        } else {
+            offset -= d->symlen[left] + 1;
+            sym = lr_right(d->btree + 3 * sym);
+        }
+    }
+    return lr_left(d->btree + 3 * sym);
+}
+
+bool check_dtz_stm(TbTable* entry, int stm, int f) {
+    if (entry->is_wdl) return true;
+    int flags = entry->get(stm, f)->flags;
+    return (flags & STM) == stm || (entry->key == entry->key2 && !entry->has_pawns);
+}
+
+int map_score(TbTable* entry, int f, int value, WdlScore wdl) {
+    if (entry->is_wdl) return value - 2;
+
+    constexpr int wdl_map[] = { 1, 3, 0, 2, 0 };
+    PairsData* d = entry->get(0, f);
+    int flags = d->flags;
+    const uint8_t* map = entry->dtz_map;
+    uint16_t idx = d->map_idx[wdl_map[static_cast<int>(wdl) + 2]];
+    if (flags & Mapped) {
+        if (flags & Wide) value = read_le16(map + 2 * (static_cast<size_t>(idx) + value));
+        else value = map[idx + value];
+    }
+
+    // Convert moves to plies where the table stores moves.
+    if ((wdl == WdlScore::Win && !(flags & WinPlies)) ||
+        (wdl == WdlScore::Loss && !(flags & LossPlies)) ||
+        wdl == WdlScore::CursedWin || wdl == WdlScore::BlessedLoss)
+        value *= 2;
+
+    return value + 1;
+}
+
+// Encodes the position as a table index and reads the stored value.
+int do_probe_table(const TbPosition& pos, TbTable* entry, WdlScore wdl, ProbeState* result) {
+    int squares[TbPieces];
+    int pieces[TbPieces];
+    uint64_t idx;
+    int next = 0, size = 0, lead_pawns_cnt = 0;
+    uint64_t lead_pawns = 0;
+    int tb_file = 0;
+
+    // Symmetric tables only store white to move; tables store the stronger
+    // side as white. Otherwise flip colors and squares.
+    bool symmetric_black_to_move = (entry->key == entry->key2 && pos.stm);
+    bool black_stronger = (pos.key != entry->key);
+    bool flip = symmetric_black_to_move || black_stronger;
+    int flip_color = flip ? 8 : 0;
+    int flip_squares = flip ? 56 : 0;
+    int stm = (flip ? 1 : 0) ^ pos.stm;
+
+    if (entry->has_pawns) {
+        int pc = entry->get(0, 0)->pieces[0] ^ flip_color;
+        for (int s = 0; s < 64; ++s) {
+            if (pos.piece[s] == pc) {
+                squares[size++] = s ^ flip_squares;
+                lead_pawns |= 1ULL << s;
+            }
+        }
+        lead_pawns_cnt = size;
+        std::swap(squares[0], *std::max_element(squares, squares + lead_pawns_cnt,
+            [](int a, int b) { return map_pawns[a] < map_pawns[b]; }));
+        tb_file = file_of(squares[0]);
+        if (tb_file > 3) tb_file = file_of(squares[0] ^ 7);
+    }
+
+    if (!check_dtz_stm(entry, stm, tb_file)) {
+        *result = ChangeStm;
+        return 0;
+    }
+
+    for (int s = 0; s < 64; ++s) {
+        if (!pos.piece[s] || (lead_pawns & (1ULL << s))) continue;
+        squares[size] = s ^ flip_squares;
+        pieces[size++] = pos.piece[s] ^ flip_color;
+    }
+
+    PairsData* d = entry->get(stm, tb_file);
+
+    // Reorder the pieces to the sequence stored in the table.
+    for (int i = lead_pawns_cnt; i < size - 1; ++i)
+        for (int j = i + 1; j < size; ++j)
+            if (d->pieces[i] == pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+
+    // Put the leading piece on the a1-d1-d4 side of the board.
+    if (file_of(squares[0]) > 3)
+        for (int i = 0; i < size; ++i) squares[i] ^= 7;
+
+    if (entry->has_pawns) {
+        idx = lead_pawn_idx[lead_pawns_cnt][squares[0]];
+        std::stable_sort(squares + 1, squares + lead_pawns_cnt,
+            [](int a, int b) { return map_pawns[a] < map_pawns[b]; });
+        for (int i = 1; i < lead_pawns_cnt; ++i)
+            idx += binomial[i][map_pawns[squares[i]]];
+    } else {
+        if (rank_of(squares[0]) > 3)
+            for (int i = 0; i < size; ++i) squares[i] ^= 56;
+
+        // First piece of the leading group off the diagonal goes below it.
+        for (int i = 0; i < d->group_len[0]; ++i) {
+            if (!off_a1h8(squares[i])) continue;
+            if (off_a1h8(squares[i]) > 0)
+                for (int j = i; j < size; ++j)
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            break;
+        }
+
+        if (entry->has_unique_pieces) {
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+            if (off_a1h8(squares[0]))
+                idx = (static_cast<uint64_t>(map_a1d1d4[squares[0]]) * 63 + (squares[1] - adjust1)) * 62
+                      + squares[2] - adjust2;
+            else if (off_a1h8(squares[1]))
+                idx = (6 * 63 + static_cast<uint64_t>(rank_of(squares[0])) * 28 + map_b1h1h7[squares[1]]) * 62
+                      + squares[2] - adjust2;
+            else if (off_a1h8(squares[2]))
+                idx = 6 * 63 * 62 + 4 * 28 * 62
+                      + static_cast<uint64_t>(rank_of(squares[0])) * 7 * 28
+                      + (rank_of(squares[1]) - adjust1) * 28
+                      + map_b1h1h7[squares[2]];
+            else
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28
+                      + static_cast<uint64_t>(rank_of(squares[0])) * 7 * 6
+                      + (rank_of(squares[1]) - adjust1) * 6
+                      + (rank_of(squares[2]) - adjust2);
+        } else {
+            idx = map_kk[map_a1d1d4[squares[0]]][squares[1]];
+        }
+    }
+
+    // Remaining groups: pawns of the other color first, then pieces.
+    idx *= d->group_idx[0];
+    int* group_sq = squares + d->group_len[0];
+    bool remaining_pawns = entry->has_pawns && entry->pawn_count[1];
+
+    while (d->group_len[++next]) {
+        std::stable_sort(group_sq, group_sq + d->group_len[next]);
+        uint64_t n = 0;
+        for (int i = 0; i < d->group_len[next]; ++i) {
+            auto adjust = std::count_if(squares, group_sq, [&](int s) { return group_sq[i] > s; });
+            n += binomial[i + 1][group_sq[i] - adjust - 8 * remaining_pawns];
+        }
+        remaining_pawns = false;
+        idx += n * d->group_idx[next];
+        group_sq += d->group_len[next];
+    }
+
+    return map_score(entry, tb_file, decompress_pairs(d, idx), wdl);
+}
+
+void set_groups(TbTable& e, PairsData* d, const int order[2], int f) {
+    int n = 0, first_len = e.has_pawns ? 0 : e.has_unique_pieces ? 3 : 2;
+    d->group_len[n] = 1;
+
+    for (int i = 1; i < e.piece_count; ++i) {
+        if (--first_len > 0 || d->pieces[i] == d->pieces[i - 1]) d->group_len[n]++;
+        else d->group_len[++n] = 1;
+    }
+    d->group_len[++n] = 0;
+
+    bool pp = e.has_pawns && e.pawn_count[1];
+    int next = pp ? 2 : 1;
+    int free_squares = 64 - d->group_len[0] - (pp ? d->group_len[1] : 0);
+    uint64_t idx = 1;
+
+    for (int k = 0; next < n || k == order[0] || k == order[1]; ++k) {
+        if (k == order[0]) {
+            d->group_idx[0] = idx;
+            idx *= e.has_pawns ? lead_pawns_size[d->group_len[0]][f] : e.has_unique_pieces ? 31332 : 462;
+        } else if (k == order[1]) {
+            d->group_idx[1] = idx;
+            idx *= binomial[d->group_len[1]][48 - d->group_len[0]];
+        } else {
+            d->group_idx[next] = idx;
+            idx *= binomial[d->group_len[next]][free_squares];
+            free_squares -= d->group_len[next++];
+        }
+    }
+    d->group_idx[n] = idx;
+}
+
+uint8_t set_symlen(PairsData* d, Sym s, std::vector<bool>& visited) {
+    visited[s] = true;
+    Sym sr = lr_right(d->btree + 3 * s);
+    if (sr == 0xFFF) return 0;
+    Sym sl = lr_left(d->btree + 3 * s);
+    if (!visited[sl]) d->symlen[sl] = set_symlen(d, sl, visited);
+    if (!visited[sr]) d->symlen[sr] = set_symlen(d, sr, visited);
+    return static_cast<uint8_t>(d->symlen[sl] + d->symlen[sr] + 1);
+}
+
+const uint8_t* set_sizes(PairsData* d, const uint8_t* data) {
+    d->flags = *data++;
+
+    if (d->flags & SingleValue) {
+        d->num_blocks = d->block_length_size = 0;
+        d->span = d->sparse_index_size = 0;
+        d->min_sym_len = *data++; // the single value
+        return data;
+    }
+
+    // group_len is zero terminated; the matching group_idx entry is the table size
+    uint64_t tb_size = d->group_idx[std::find(d->group_len, d->group_len + TbPieces, 0) - d->group_len];
+
+    d->block_size = size_t(1) << *data++;
+    d->span = size_t(1) << *data++;
+    d->sparse_index_size = static_cast<size_t>((tb_size + d->span - 1) / d->span);
+    uint8_t padding = *data++;
+    d->num_blocks = read_le32(data);
+    data += 4;
+    d->block_length_size = d->num_blocks + padding;
+    d->max_sym_len = *data++;
+    d->min_sym_len = *data++;
+    d->lowest_sym = data;
+    d->base64.assign(d->max_sym_len - d->min_sym_len + 1, 0);
+
+    // Canonical Huffman: longer codes have lower values. base64[i] is the
+    // lowest code of length min_sym_len + i, left-aligned in 64 bits.
+    for (int i = static_cast<int>(d->base64.size()) - 2; i >= 0; --i) {
+        d->base64[i] = (d->base64[i + 1] + read_le16(d->lowest_sym + 2 * i)
+                        - read_le16(d->lowest_sym + 2 * (i + 1))) / 2;
+    }
+    for (size_t i = 0; i < d->base64.size(); ++i) {
+        d->base64[i] <<= 64 - i - d->min_sym_len;
+    }
+
+    data += d->base64.size() * sizeof(Sym);
+    d->symlen.assign(read_le16(data), 0);
+    data += sizeof(uint16_t);
+    d->btree = data;
+
+    // Recursive pairing: each symbol expands to a pair of symbols.
+    std::vector<bool> visited(d->symlen.size());
+    for (size_t sym = 0; sym < d->symlen.size(); ++sym) {
+        if (!visited[sym]) d->symlen[sym] = set_symlen(d, static_cast<Sym>(sym), visited);
+    }
+    return data + d->symlen.size() * 3 + (d->symlen.size() & 1);
+}
+
+const uint8_t* set_dtz_map(TbTable& e, const uint8_t* data, int max_file) {
+    if (e.is_wdl) return data;
+
+    e.dtz_map = data;
+    for (int f = 0; f <= max_file; ++f) {
+        PairsData* d = e.get(0, f);
+        if (!(d->flags & Mapped)) continue;
+        if (d->flags & Wide) {
+            data += reinterpret_cast<uintptr_t>(data) & 1;
+            for (int i = 0; i < 4; ++i) {
+                d->map_idx[i] = static_cast<uint16_t>((data - e.dtz_map) / 2 + 1);
+                data += 2 * read_le16(data) + 2;
+            }
+        } else {
+            for (int i = 0; i < 4; ++i) {
+                d->map_idx[i] = static_cast<uint16_t>(data - e.dtz_map + 1);
+                data += *data + 1;
+            }
+        }
+    }
+    return data + (reinterpret_cast<uintptr_t>(data) & 1);
+}
+
+// Fills the PairsData records from a freshly mapped file (after the magic).
+void set_table(TbTable& e, const uint8_t* data) {
+    data++; // flags: split / has pawns, already known from the name
+
+    const int sides = (e.sides() == 2 && e.key != e.key2) ? 2 : 1;
+    const int max_file = e.has_pawns ? 3 : 0;
+    bool pp = e.has_pawns && e.pawn_count[1];
+
+    for (int f = 0; f <= max_file; ++f) {
+        for (int i = 0; i < sides; ++i) *e.get(i, f) = PairsData();
+
+        int order[2][2] = { { *data & 0xF, pp ? *(data + 1) & 0xF : 0xF },
+                            { *data >> 4, pp ? *(data + 1) >> 4 : 0xF } };
+        data += 1 + pp;
+
+        for (int k = 0; k < e.piece_count; ++k, ++data)
+            for (int i = 0; i < sides; ++i)
+                e.get(i, f)->pieces[k] = i ? *data >> 4 : *data & 0xF;
+
+        for (int i = 0; i < sides; ++i) set_groups(e, e.get(i, f), order[i], f);
+    }
+
+    data += reinterpret_cast<uintptr_t>(data) & 1;
+
+    for (int f = 0; f <= max_file; ++f)
+        for (int i = 0; i < sides; ++i) data = set_sizes(e.get(i, f), data);
+
+    data = set_dtz_map(e, data, max_file);
+
+    for (int f = 0; f <= max_file; ++f)
+        for (int i = 0; i < sides; ++i) {
+            PairsData* d = e.get(i, f);
+            d->sparse_index = data;
+            data += d->sparse_index_size * 6;
+        }
+
+    for (int f = 0; f <= max_file; ++f)
+        for (int i = 0; i < sides; ++i) {
+            PairsData* d = e.get(i, f);
+            d->block_length = data;
+            data += static_cast<size_t>(d->block_length_size) * 2;
+        }
+
+    for (int f = 0; f <= max_file; ++f)
+        for (int i = 0; i < sides; ++i) {
+            data = reinterpret_cast<const uint8_t*>((reinterpret_cast<uintptr_t>(data) + 0x3F) & ~uintptr_t(0x3F));
+            PairsData* d = e.get(i, f);
+            d->data = data;
+            data += static_cast<uint64_t>(d->num_blocks) * d->block_size;
+        }
+}
+
+// Maps and initialises the table on first use. Thread safe.
+bool mapped(TbTable& e) {
+    if (e.ready.load(std::memory_order_acquire)) return e.mapped_ok;
+
+    std::lock_guard<std::mutex> lock(map_mutex);
+    if (e.ready.load(std::memory_order_relaxed)) return e.mapped_ok;
+
+    static constexpr uint8_t wdl_magic[4] = { 0x71, 0xE8, 0x23, 0x5D };
+    static constexpr uint8_t dtz_magic[4] = { 0xD7, 0x66, 0x0C, 0xA5 };
+
+    if (!e.path.empty() && e.file.open(e.path) && e.file.size() > 4 &&
+        std::memcmp(e.file.data(), e.is_wdl ? wdl_magic : dtz_magic, 4) == 0) {
+        set_table(e, e.file.data() + 4);
+        e.mapped_ok = true;
+    } else {
+        e.file.close();
+    }
+    e.ready.store(true, std::memory_order_release);
+    return e.mapped_ok;
+}
+
+int probe_table(const TbPosition& pos, bool wdl_table, ProbeState* result, WdlScore wdl = WdlScore::Draw) {
+    if (pos.total == 2) return wdl_table ? static_cast<int>(WdlScore::Draw) : 0; // KvK
+
+    auto [wdl_entry, dtz_entry] = registry.find(pos.key);
+    TbTable* entry = wdl_table ? wdl_entry : dtz_entry;
+    if (!entry || !mapped(*entry)) {
+        *result = Fail;
+        return 0;
+    }
+    return do_probe_table(pos, entry, wdl, result);
+}
+
+bool is_capture(const Board& board, const Move& move) {
+    return move.type == MoveType::EnPassant || board.at(move.to_rank, move.to_file).has_value();
+}
+
+bool is_pawn_move(const Board& board, const Move& move) {
+    const auto& piece = board.at(move.from_rank, move.from_file);
+    return piece && piece->type == PieceType::Pawn;
+}
+
+// Tables store "don't care" values where the side to move has a winning
+// capture, and nothing for en passant, so captures are resolved by search.
+template <bool CheckZeroingMoves>
+WdlScore search(const Board& board, ProbeState* result) {
+    WdlScore value, best_value = WdlScore::Loss;
+    auto moves = generate_legal_moves(&board, board.get_side_to_move());
+    if (!moves) {
+        *result = Fail;
+        return WdlScore::Draw;
+    }
+    size_t total_count = moves->size(), move_count = 0;
+
+    for (const auto& move : *moves) {
+        if (!is_capture(board, move) && (!CheckZeroingMoves || !is_pawn_move(board, move)))
+            continue;
+
+        ++move_count;
+        Board next = board;
+        apply_move(next, move);
+        value = negate(search<false>(next, result));
+
+        if (*result == Fail) return WdlScore::Draw;
+
+        if (value > best_value) {
+            best_value = value;
+            if (value >= WdlScore::Win) {
+                *result = ZeroingBestMove;
+                return value;
+            }
+        }
+    }
+
+    bool no_more_moves = (move_count && move_count == total_count);
+    if (no_more_moves) {
+        value = best_value;
+    } else {
+        value = static_cast<WdlScore>(probe_table(make_position(board), true, result));
+        if (*result == Fail) return WdlScore::Draw;
+    }
+
+    if (best_value >= value) {
+        *result = (best_value > WdlScore::Draw || no_more_moves) ? ZeroingBestMove : Ok;
+        return best_value;
+    }
+    *result = Ok;
+    return value;
+}
+
+int probe_dtz(const Board& board, ProbeState* result);
+
+// Mate is the only case where the DTZ search must look at a position with no moves.
+bool is_mate(const Board& board) {
+    if (!king_in_check(board, board.get_side_to_move())) return false;
+    auto moves = generate_legal_moves(&board, board.get_side_to_move());
+    return moves && moves->empty();
+}
+
+int probe_dtz(const Board& board, ProbeState* result) {
+    *result = Ok;
+    WdlScore wdl = search<true>(board, result);
+
+    if (*result == Fail || wdl == WdlScore::Draw) return 0;
+    if (*result == ZeroingBestMove) return dtz_before_zeroing(wdl);
+
+    TbPosition pos = make_position(board);
+    int dtz = probe_table(pos, false, result, wdl);
+    if (*result == Fail) return 0;
+
+    if (*result != ChangeStm) {
+        bool cursed = wdl == WdlScore::BlessedLoss || wdl == WdlScore::CursedWin;
+        return (dtz + 100 * cursed) * sign_of(static_cast<int>(wdl));
+    }
+
+    // The table stores the other side to move: do a 1-ply search for the
+    // winning move with the smallest DTZ.
+    int min_dtz = 0xFFFF;
+    auto moves = generate_legal_moves(&board, board.get_side_to_move());
+    if (!moves) return 0;
+    for (const auto& move : *moves) {
+        bool zeroing = is_capture(board, move) || is_pawn_move(board, move);
+        Board next = board;
+        apply_move(next, move);
+
+        dtz = zeroing ? -dtz_before_zeroing(search<false>(next, result))
+                      : -probe_dtz(next, result);
+
+        if (dtz == 1 && is_mate(next)) min_dtz = 1;
+        if (!zeroing) dtz += sign_of(dtz);
+        if (dtz < min_dtz && sign_of(dtz) == sign_of(static_cast<int>(wdl))) min_dtz = dtz;
+
+        if (*result == Fail) return 0;
+    }
+    return min_dtz == 0xFFFF ? -1 : min_dtz;
+}
+
+bool probeable(const Board& board) {
+    if (board.white_kingside_castle || board.white_queenside_castle ||
+        board.black_kingside_castle || board.black_queenside_castle)
+        return false;
+    int pieces = syzygy_piece_count(board);
+    return pieces <= registry.max_pieces() && pieces <= syzygy_options.probe_limit;
+}
+
+} // namespace
+
+int syzygy_init(const std::string& paths) {
+    registry.clear();
+    if (paths.empty() || paths == "<empty>") return 0;
+    init_index_tables();
+
+#ifdef _WIN32
+    constexpr char sep = ';';
+#else
+    constexpr char sep = ':';
+#endif
+    std::vector<std::string> dirs;
+    std::stringstream ss(paths);
+    std::string dir;
+    while (std::getline(ss, dir, sep)) {
+        if (!dir.empty()) dirs.push_back(dir);
+    }
+
+    for (const auto& d : dirs) {
+        std::error_code ec;
+        for (const auto& file : std::filesystem::directory_iterator(d, ec)) {
+            if (file.path().extension() != ".rtbw") continue;
+            std::string name = file.path().stem().string();
+            int pieces = static_cast<int>(std::count_if(name.begin(), name.end(), [](char c) { return c != 'v'; }));
+            if (pieces <= TbPieces) registry.add(name, dirs);
+        }
+    }
+    return registry.size();
+}
+
+int syzygy_max_pieces() {
+    return registry.max_pieces();
+}
+
+int syzygy_piece_count(const Board& board) {
+    int count = 0;
+    for (int rank = 0; rank < Board::Size; ++rank)
+        for (int file = 0; file < Board::Size; ++file)
+            if (board.at(rank, file)) ++count;
+    return count;
+}
+
+std::optional<WdlScore> syzygy_probe_wdl(const Board& board) {
+    if (!probeable(board)) return std::nullopt;
+    ProbeState result = Ok;
+    WdlScore wdl = search<false>(board, &result);
+    if (result == Fail) return std::nullopt;
+    return wdl;
+}
+
+// Return value n, from the side to move's point of view:
+//   n < -100 : loss, but draw under the 50-move rule
+//   -100 <= n < -1 : loss in n plies
+//   -1 : the side to move is mated
+//   0 : draw
+//   1 < n <= 100 : win in n plies
+//   100 < n : win, but draw under the 50-move rule
+// The value can be off by one ply for positions not on the 50-move "edge".
+std::optional<int> syzygy_probe_dtz(const Board& board) {
+    if (!probeable(board)) return std::nullopt;
+    ProbeState result = Ok;
+    int dtz = probe_dtz(board, &result);
+    if (result == Fail) return std::nullopt;
+    return dtz;
+}
+
+std::optional<Move> syzygy_probe_root(const Board& board, std::vector<Move>& moves) {
+    if (moves.empty() || !probeable(board)) return std::nullopt;
+
+    // Rank every root move by the DTZ counted from the root.
+    std::vector<int> ranks;
+    ranks.reserve(moves.size());
+    for (const auto& move : moves) {
+        Board next = board;
+        apply_move(next, move);
+        ProbeState result = Ok;
+        int dtz;
+        if (is_capture(board, move) || is_pawn_move(board, move)) {
+            dtz = dtz_before_zeroing(negate(search<false>(next, &result)));
+        } else {
+            dtz = -probe_dtz(next, &result);
+            dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+        }
+        if (dtz == 2 && is_mate(next)) dtz = 1;
+        if (result == Fail) return std::nullopt;
+
+        // Certain wins by speed to zeroing, cursed wins and blessed losses as
+        // draws when the 50-move rule applies, losses by how long they last.
+        // Plies already played since the last zeroing move count against the limit.
+        int clock = board.get_halfmove_clock();
+        int rank = dtz > 0 ? (dtz + clock <= 99 || !syzygy_options.use_rule50 ? 1000 - dtz : 0)
+                 : dtz < 0 ? (-dtz + clock <= 99 || !syzygy_options.use_rule50 ? -1000 - dtz : 0)
+                 : 0;
+        ranks.push_back(rank);
+    }
+
+    int best_rank = *std::max_element(ranks.begin(), ranks.end());
+    size_t best_idx = std::find(ranks.begin(), ranks.end(), best_rank) - ranks.begin();
+    if (best_rank != 0) return moves[best_idx];
+
+    std::vector<Move> drawing;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        if (ranks[i] == 0) drawing.push_back(moves[i]);
+    }
+    moves = std::move(drawing);
+    return std::nullopt;
+}
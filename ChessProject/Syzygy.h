@@ -0,0 +1,40 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+#include "Board.h"
+#include "Move.h"
+
+// Syzygy endgame tablebase probing (.rtbw WDL and .rtbz DTZ files).
+// Tables are found at init, memory-mapped on first use and can be probed
+// concurrently from all search threads.
+
+enum class WdlScore { Loss = -2, BlessedLoss = -1, Draw = 0, CursedWin = 1, Win = 2 };
+
+struct SyzygyOptions {
+    int probe_depth = 1;      // Minimum remaining depth for probing inside the search
+    int probe_limit = 7;      // Maximum number of pieces to probe
+    bool use_rule50 = true;   // Treat cursed wins / blessed losses as draws
+};
+inline SyzygyOptions syzygy_options;
+
+// Scans the directories in `paths` (separated by ';' on Windows, ':' elsewhere)
+// and returns the number of WDL tables found. An empty path disables probing.
+int syzygy_init(const std::string& paths);
+
+// Largest piece count covered by the loaded tables, 0 when none are loaded.
+int syzygy_max_pieces();
+
+// Number of pieces on the board, kings included.
+int syzygy_piece_count(const Board& board);
+
+// Win/draw/loss from the side to move's point of view, nullopt if not available.
+std::optional<WdlScore> syzygy_probe_wdl(const Board& board);
+
+// Distance to zeroing move in plies (see Syzygy.cpp for the sign convention).
+std::optional<int> syzygy_probe_dtz(const Board& board);
+
+// Ranks the root moves with DTZ and keeps only the best ranked ones. Returns the
+// move to play when the position is won or lost; for drawn positions `moves` is
+// reduced to the drawing moves and nullopt is returned so the search picks one.
+std::optional<Move> syzygy_probe_root(const Board& board, std::vector<Move>& moves);
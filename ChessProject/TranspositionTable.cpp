@@ -0,0 +1,109 @@
+#include "TranspositionTable.h"
+#include "MoveGen.h"
+#include "Zobrist.h"
+#include <algorithm>
+#include <bit>
+#include <memory>
+
+namespace {
+
+// data: score (bits 0-31) | depth (32-39) | move (40-55) | valid (56)
+constexpr uint64_t ValidBit = uint64_t(1) << 56;
+
+uint64_t pack(int depth, int score, uint16_t move) {
+    return static_cast<uint32_t>(score) | (static_cast<uint64_t>(depth & 0xFF) << 32) |
+           (static_cast<uint64_t>(move) << 40) | ValidBit;
+}
+
+} // namespace
+
+TranspositionTable::TranspositionTable(size_t megabytes, Placement placement) : placement_(placement) {
+    resize(megabytes);
+}
+
+void TranspositionTable::for_each_slot_range(const std::function<void(size_t, size_t)>& body) {
+    if (placement_ == Placement::Interleaved) for_each_chunk_on_nodes(capacity(), memory_.size(), body);
+    else body(0, capacity());
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    size_t slots = std::max<size_t>(megabytes, 1) * 1024 * 1024 / sizeof(Slot);
+    slots = std::bit_floor(slots);
+    memory_ = LargeBuffer(); // release the old table before mapping the new one
+    memory_ = LargeBuffer(slots * sizeof(Slot));
+    slots_ = static_cast<Slot*>(memory_.data());
+    mask_ = slots - 1;
+    // Constructing the slots is the first touch of every page.
+    for_each_slot_range([this](size_t begin, size_t end) {
+        std::uninitialized_value_construct(slots_ + begin, slots_ + end);
+    });
+}
+
+void TranspositionTable::clear() {
+    for_each_slot_range([this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            slots_[i].check.store(0, std::memory_order_relaxed);
+            slots_[i].data.store(0, std::memory_order_relaxed);
+        }
+    });
+}
+
+std::optional<TranspositionTable::Entry> TranspositionTable::probe(uint64_t key) const {
+    const Slot& slot = slots_[key & mask_];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if (!(data & ValidBit) || (check ^ data) != key) return std::nullopt;
+    return Entry{ static_cast<int32_t>(static_cast<uint32_t>(data)), static_cast<int>((data >> 32) & 0xFF),
+                  static_cast<uint16_t>(data >> 40) };
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int score, uint16_t move) {
+    Slot& slot = slots_[key & mask_];
+    uint64_t old_data = slot.data.load(std::memory_order_relaxed);
+    uint64_t old_key = slot.check.load(std::memory_order_relaxed) ^ old_data;
+    // Keep deeper results for the same position; other positions are replaced.
+    if ((old_data & ValidBit) && old_key == key && static_cast<int>((old_data >> 32) & 0xFF) > depth) return;
+
+    uint64_t data = pack(depth, score, move);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    size_t sample = std::min<size_t>(1000, capacity());
+    int used = 0;
+    for (size_t i = 0; i < sample; ++i) {
+        if (slots_[i].data.load(std::memory_order_relaxed) & ValidBit) ++used;
+    }
+    return static_cast<int>(used * 1000 / sample);
+}
+
+uint16_t TranspositionTable::encode_move(const Move& move) {
+    int from = move.from_rank * 8 + move.from_file;
+    int to = move.to_rank * 8 + move.to_file;
+    int promo = move.promotion ? static_cast<int>(*move.promotion) + 1 : 0;
+    return static_cast<uint16_t>(from | (to << 6) | (promo << 12));
+}
+
+std::optional<Move> TranspositionTable::decode_move(const Board& board, uint16_t code) {
+    if (code == 0) return std::nullopt;
+    auto moves = generate_legal_moves(&board, board.get_side_to_move());
+    if (!moves) return std::nullopt;
+    for (const auto& move : *moves) {
+        if (encode_move(move) == code) return move;
+    }
+    return std::nullopt;
+}
+
+std::vector<Move> extract_pv(const TranspositionTable& tt, Board board, int max_length) {
+    std::vector<Move> pv;
+    while (static_cast<int>(pv.size()) < max_length) {
+        auto entry = tt.probe(zobrist_key(board));
+        if (!entry) break;
+        auto move = TranspositionTable::decode_move(board, entry->move);
+        if (!move) break;
+        pv.push_back(*move);
+        apply_move(board, *move);
+    }
+    return pv;
+}
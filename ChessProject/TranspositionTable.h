@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Board.h"
+#include "Memory.h"
+#include "Move.h"
+
+// Hash table of searched positions, indexed by zobrist_key. Plain minimax
+// scores are exact, so an entry can stand in for any search of equal or
+// lower depth. Slots are written without locks; the key is stored xor'ed
+// with the data so a torn write from another thread reads as a miss.
+// The slots live in a LargeBuffer to cut TLB misses on big tables.
+class TranspositionTable {
+public:
+    // Where the pages of the table are first touched: spread over all NUMA
+    // nodes for a table shared by the search threads, or on the node of the
+    // calling thread for a table private to one worker.
+    enum class Placement { Interleaved, Local };
+
+    struct Entry {
+        int score;      // for the side to move
+        int depth;
+        uint16_t move;  // best move, see encode_move
+    };
+
+    explicit TranspositionTable(size_t megabytes = 16, Placement placement = Placement::Interleaved);
+
+    void resize(size_t megabytes);
+    void clear();
+
+    std::optional<Entry> probe(uint64_t key) const;
+    void store(uint64_t key, int depth, int score, uint16_t move);
+
+    size_t capacity() const { return mask_ + 1; }
+    size_t megabytes() const { return memory_.size() / (1024 * 1024); }
+    // Used slots per thousand, sampled from the start of the table.
+    int hashfull() const;
+    // Page size backing the table, e.g. "2 MB huge pages".
+    std::string page_description() const { return memory_.page_description(); }
+
+    // 16-bit move code: from square, to square and promotion piece.
+    static uint16_t encode_move(const Move& move);
+    static std::optional<Move> decode_move(const Board& board, uint16_t code);
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> data{0};
+    };
+
+    LargeBuffer memory_;
+    Slot* slots_ = nullptr;
+    size_t mask_ = 0;
+    Placement placement_;
+
+    // Runs body(begin, end) over all slots, chunked over the NUMA nodes for
+    // an interleaved table.
+    void for_each_slot_range(const std::function<void(size_t, size_t)>& body);
+};
+
+// Follows the stored best moves from `board` for at most `max_length` plies.
+std::vector<Move> extract_pv(const TranspositionTable& tt, Board board, int max_length);
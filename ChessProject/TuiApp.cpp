@@ -1,6 +1,9 @@
 #include "TuiApp.h"
 #include <iostream>
+#include <cctype>
+#include <format>
 #include <limits>
+#include "Board.h"
 
 TuiApp::TuiApp() {
     // Default board: empty 8x8
@@ -26,7 +29,8 @@ void TuiApp::set_board(const std::vector<std::vector<char>>& board) {
 }
 
 void TuiApp::draw() {
-    clear_screen();
+    // Frames go through screen_, which sends only the cells that changed.
+    screen_.clear();
     switch (display_mode_) {
         case BoardDisplayMode::ASCII:
             draw_board_ascii();
@@ -35,46 +39,47 @@ void TuiApp::draw() {
             draw_board_unicode();
             break;
     }
-	move_cursor(25, 1); // Move cursor to a new line below the board
-    std::cout << "\nPress 'q' to quit, 'm' to switch mode.\n";
+    screen_.print(11, 0, "Press 'q' to quit, 'm' to switch mode.");
+    std::string out;
+    screen_.flush(out);
+    std::cout << out << "\033[25;1H";
     std::cout.flush();
 }
 
 void TuiApp::draw_board_ascii() {
     std::lock_guard<std::mutex> lock(board_mutex_);
-    std::cout << "  a b c d e f g h\n";
+    screen_.print(0, 0, "  a b c d e f g h");
     for (int r = 0; r < 8; ++r) {
-        std::cout << 8 - r << " ";
+        std::string row = std::format("{} ", 8 - r);
         for (int c = 0; c < 8; ++c) {
-            std::cout << board_[r][c] << " ";
+            row += board_[r][c];
+            row += ' ';
         }
-        std::cout << 8 - r << "\n";
+        screen_.print(1 + r, 0, row + std::to_string(8 - r));
     }
-    std::cout << "  a b c d e f g h\n";
+    screen_.print(9, 0, "  a b c d e f g h");
 }
 
 void TuiApp::draw_board_unicode() {
-    // Example: use Unicode chess pieces for demonstration
-    // (U+2654 to U+265F for basic pieces)
-    static const wchar_t* pieces[2][6] = {
-        {L"\u2656", L"\u2658", L"\u2657", L"\u2655", L"\u2654", L"\u2659"}, // White
-        {L"\u265C", L"\u265E", L"\u265D", L"\u265B", L"\u265A", L"\u265F"}  // Black
-    };
     std::lock_guard<std::mutex> lock(board_mutex_);
-    std::wcout << L"  a b c d e f g h\n";
+    screen_.print(0, 0, "  a b c d e f g h");
     for (int r = 0; r < 8; ++r) {
-        std::wcout << 8 - r << " ";
+        screen_.print(1 + r, 0, std::to_string(8 - r));
         for (int c = 0; c < 8; ++c) {
-            // For demo, show pawns on 2nd/7th rank, dots elsewhere
-            wchar_t symbol = L'.';
-            if (r == 1) symbol = L'\u265F'; // Black pawn
-            else if (r == 6) symbol = L'\u2659'; // White pawn
-            std::wcout << symbol << " ";
+            // Letters as in FEN: upper case white, '.' for an empty square.
+            char letter = board_[r][c];
+            const char* glyph = ".";
+            static constexpr std::string_view letters = "PNBRQK";
+            if (auto index = letters.find(static_cast<char>(std::toupper(static_cast<unsigned char>(letter))));
+                index != std::string_view::npos) {
+                Color color = std::isupper(static_cast<unsigned char>(letter)) ? Color::White : Color::Black;
+                glyph = piece_glyph({ static_cast<PieceType>(index), color });
+            }
+            screen_.print(1 + r, 2 + 2 * c, glyph);
         }
-        std::wcout << 8 - r << L"\n";
+        screen_.print(1 + r, 18, std::to_string(8 - r));
     }
-    std::wcout << L"  a b c d e f g h\n";
-    std::wcout.flush();
+    screen_.print(9, 0, "  a b c d e f g h");
 }
 
 void TuiApp::handle_input() {
@@ -95,13 +100,3 @@ void TuiApp::switch_display_mode() {
     else
         display_mode_ = BoardDisplayMode::ASCII;
 }
-
-void TuiApp::clear_screen() {
-    // ANSI escape code to clear screen and move cursor to top-left
-    std::cout << "\033[2J\033[H";
-}
-
-void TuiApp::move_cursor(int row, int col) {
-    // ANSI escape code to move cursor (1-based)
-    std::cout << "\033[" << row << ";" << col << "H";
-}
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <atomic>
 #include <mutex>
 #include <iostream>
+#include "Screen.h"
 
 enum class BoardDisplayMode {
     ASCII,
@@ -28,14 +29,11 @@ private:
     std::vector<std::vector<char>> board_;
     std::atomic<bool> running_{true};
     std::mutex board_mutex_;
+    ScreenBuffer screen_{ 24, 80 };
 
     void draw();
     void draw_board_ascii();
     void draw_board_unicode();
     void handle_input();
     void switch_display_mode();
-
-    // VT100 helpers
-    void clear_screen();
-    void move_cursor(int row, int col);
 };
\ No newline at end of file
@@ -0,0 +1,267 @@
+#include "Tune.h"
+#include "Eval.h"
+#include "Fen.h"
+#include "PackedPosition.h"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <print>
+
+namespace {
+
+// Parameter vector: the five tuned piece values, then the 64 pawn table entries.
+constexpr int PieceParams = 5;
+constexpr int ParamCount = PieceParams + 64;
+
+std::array<double, ParamCount> initial_params() {
+    std::array<double, ParamCount> params{};
+    for (int i = 0; i < PieceParams; ++i) params[i] = piece_values[i];
+    for (int r = 0; r < 8; ++r) {
+        for (int f = 0; f < 8; ++f) params[PieceParams + r * 8 + f] = pawn_table[r][f];
+    }
+    return params;
+}
+
+// The evaluation is linear in the parameters, so each position is stored as
+// its nonzero coefficients (white count minus black count per term) and an
+// iteration never has to look at a board again.
+struct Coefficient {
+    uint8_t index;
+    int8_t value;
+};
+
+struct Dataset {
+    std::vector<Coefficient> coefficients;
+    std::vector<uint32_t> offsets{ 0 };   // position i uses coefficients[offsets[i], offsets[i + 1])
+    std::vector<float> results;           // 1, 0.5 or 0 for white
+    std::vector<float> scores;            // search score for white in centipawns, NAN when unknown
+
+    size_t size() const { return results.size(); }
+};
+
+void add_position(Dataset& data, const Board& board, float result, float score) {
+    int counts[ParamCount] = {};
+    int pieces = 0;
+    for (int rank = 0; rank < Board::Size; ++rank) {
+        for (int file = 0; file < Board::Size; ++file) {
+            const auto& sq = board.at(rank, file);
+            if (!sq) continue;
+            ++pieces;
+            if (sq->type == PieceType::King) continue;
+            int sign = sq->color == Color::White ? 1 : -1;
+            counts[static_cast<int>(sq->type)] += sign;
+            if (sq->type == PieceType::Pawn) {
+                int r = sq->color == Color::White ? rank : 7 - rank;
+                counts[PieceParams + r * 8 + file] += sign;
+            }
+        }
+    }
+    // Three-piece positions are scored by the bitbases, not by these terms.
+    if (pieces <= 3) return;
+
+    for (int i = 0; i < ParamCount; ++i) {
+        if (counts[i]) data.coefficients.push_back({ static_cast<uint8_t>(i), static_cast<int8_t>(counts[i]) });
+    }
+    data.offsets.push_back(static_cast<uint32_t>(data.coefficients.size()));
+    data.results.push_back(result);
+    data.scores.push_back(score);
+}
+
+// Game result in an EPD line: c9 "1-0", [0.5], or a bare 1-0 / 0-1 / 1/2-1/2.
+std::optional<float> epd_result(std::string_view rest) {
+    if (rest.find("1/2-1/2") != std::string_view::npos || rest.find("[0.5]") != std::string_view::npos) return 0.5f;
+    if (rest.find("1-0") != std::string_view::npos || rest.find("[1.0]") != std::string_view::npos) return 1.0f;
+    if (rest.find("0-1") != std::string_view::npos || rest.find("[0.0]") != std::string_view::npos) return 0.0f;
+    return std::nullopt;
+}
+
+bool load(Dataset& data, const std::string& path) {
+    Board board;
+    PositionReader reader;
+    if (reader.open(path)) {
+        for (const PackedPosition& packed : reader.records()) {
+            if (!packed.has_result() || !unpack_position(packed, board)) continue;
+            float score = NAN;
+            if (packed.has_score()) score = packed.flags & 1 ? -packed.score : packed.score;
+            add_position(data, board, (packed.result + 1) / 2.0f, score);
+        }
+        return true;
+    }
+
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        auto ops = parse_fen(line, board);
+        if (!ops) continue;
+        auto result = epd_result(ops->text);
+        if (!result) continue;
+        add_position(data, board, *result, NAN);
+    }
+    return true;
+}
+
+double sigmoid(double k, double eval) {
+    return 1.0 / (1.0 + std::exp(-k * eval));
+}
+
+// Mean squared error over the dataset and, when `gradient` is given, its
+// gradient with respect to the parameters. Each thread sums a contiguous
+// slice into its own accumulators.
+double evaluate_error(const Dataset& data, const std::array<double, ParamCount>& params, double k, double lambda,
+                      int threads, std::array<double, ParamCount>* gradient) {
+    struct Partial {
+        double error = 0;
+        std::array<double, ParamCount> gradient{};
+    };
+    std::vector<Partial> partials(threads);
+    {
+        std::vector<std::jthread> pool;
+        for (int t = 0; t < threads; ++t) {
+            pool.emplace_back([&, t] {
+                Partial& partial = partials[t];
+                size_t begin = data.size() * t / threads, end = data.size() * (t + 1) / threads;
+                for (size_t i = begin; i < end; ++i) {
+                    double eval = 0;
+                    for (uint32_t c = data.offsets[i]; c < data.offsets[i + 1]; ++c)
+                        eval += params[data.coefficients[c].index] * data.coefficients[c].value;
+
+                    double target = data.results[i];
+                    if (!std::isnan(data.scores[i])) target = lambda * target + (1 - lambda) * sigmoid(k, data.scores[i]);
+                    double predicted = sigmoid(k, eval);
+                    double diff = predicted - target;
+                    partial.error += diff * diff;
+                    if (!gradient) continue;
+
+                    double slope = 2 * diff * predicted * (1 - predicted) * k;
+                    for (uint32_t c = data.offsets[i]; c < data.offsets[i + 1]; ++c)
+                        partial.gradient[data.coefficients[c].index] += slope * data.coefficients[c].value;
+                }
+            });
+        }
+    }
+
+    double error = 0;
+    if (gradient) gradient->fill(0);
+    for (const Partial& partial : partials) {
+        error += partial.error;
+        if (gradient) {
+            for (int p = 0; p < ParamCount; ++p) (*gradient)[p] += partial.gradient[p] / data.size();
+        }
+    }
+    return error / data.size();
+}
+
+// Sigmoid scale that best fits the starting parameters, by ternary search.
+double fit_scale(const Dataset& data, const std::array<double, ParamCount>& params, double lambda, int threads) {
+    double low = 0.0001, high = 0.05;
+    for (int i = 0; i < 40; ++i) {
+        double a = low + (high - low) / 3, b = high - (high - low) / 3;
+        if (evaluate_error(data, params, a, lambda, threads, nullptr) < evaluate_error(data, params, b, lambda, threads, nullptr))
+            high = b;
+        else
+            low = a;
+    }
+    return (low + high) / 2;
+}
+
+bool write_header(const std::string& path, const std::array<double, ParamCount>& params, size_t positions,
+                  double error, double k) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+
+    out << "#pragma once\n\n"
+           "// Evaluation parameters, written by the \"tune\" mode (see Tune.h). Rerun the\n"
+           "// tuner to change them rather than editing this file by hand.\n";
+    out << std::format("// Tuned on {} positions: error {:.6f}, sigmoid scale {:.6f}.\n\n", positions, error, k);
+
+    out << "// Indexed by PieceType; the king value is not tuned.\n";
+    out << "constexpr int piece_values[6] = { ";
+    for (int i = 0; i < PieceParams; ++i) out << std::lround(params[i]) << ", ";
+    out << piece_values[static_cast<int>(PieceType::King)] << " };\n\n";
+
+    out << "// Pawn bonus by rank from the pawn owner's side (row 0 = own back rank) and file.\n";
+    out << "constexpr int pawn_table[8][8] = {\n";
+    for (int r = 0; r < 8; ++r) {
+        out << "    {";
+        for (int f = 0; f < 8; ++f) out << std::format("{:>4}{}", std::lround(params[PieceParams + r * 8 + f]), f < 7 ? "," : "");
+        out << (r < 7 ? "},\n" : "}\n");
+    }
+    out << "};\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+std::optional<TuneOptions> parse_tune_args(const std::vector<std::string>& args) {
+    TuneOptions options;
+    try {
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if (arg == "--input" && has_value) options.input_paths.push_back(args[++i]);
+            else if (arg == "--output" && has_value) options.output_path = args[++i];
+            else if (arg == "--threads" && has_value) options.threads = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--iterations" && has_value) options.iterations = std::max(1, std::stoi(args[++i]));
+            else if (arg == "--lr" && has_value) options.learning_rate = std::stod(args[++i]);
+            else if (arg == "--lambda" && has_value) options.lambda = std::clamp(std::stod(args[++i]), 0.0, 1.0);
+            else return std::nullopt;
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    if (options.input_paths.empty()) return std::nullopt;
+    return options;
+}
+
+int run_tune(const TuneOptions& options) {
+    auto start = std::chrono::steady_clock::now();
+    Dataset data;
+    for (const auto& path : options.input_paths) {
+        if (!load(data, path)) {
+            std::println(stderr, "Cannot open {}", path);
+            return 1;
+        }
+    }
+    if (data.size() == 0) {
+        std::println(stderr, "No labelled positions in the input");
+        return 1;
+    }
+    double load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::println("Loaded {} positions in {:.1f} s ({:.1f} MB of coefficients)", data.size(), load_seconds,
+                 (data.coefficients.size() * sizeof(Coefficient) + data.size() * 12) / 1048576.0);
+
+    auto params = initial_params();
+    double k = fit_scale(data, params, options.lambda, options.threads);
+    double error = evaluate_error(data, params, k, options.lambda, options.threads, nullptr);
+    std::println("Sigmoid scale {:.6f}, starting error {:.6f}", k, error);
+
+    // Adam over the full batch.
+    constexpr double Beta1 = 0.9, Beta2 = 0.999, Epsilon = 1e-8;
+    std::array<double, ParamCount> gradient{}, m{}, v{};
+    for (int iter = 1; iter <= options.iterations; ++iter) {
+        error = evaluate_error(data, params, k, options.lambda, options.threads, &gradient);
+        for (int p = 0; p < ParamCount; ++p) {
+            m[p] = Beta1 * m[p] + (1 - Beta1) * gradient[p];
+            v[p] = Beta2 * v[p] + (1 - Beta2) * gradient[p] * gradient[p];
+            double m_hat = m[p] / (1 - std::pow(Beta1, iter));
+            double v_hat = v[p] / (1 - std::pow(Beta2, iter));
+            params[p] -= options.learning_rate * m_hat / (std::sqrt(v_hat) + Epsilon);
+        }
+        if (iter % 100 == 0 || iter == options.iterations) {
+            std::println("Iteration {:>5}: error {:.6f}  P {:.0f} N {:.0f} B {:.0f} R {:.0f} Q {:.0f}", iter, error,
+                         params[0], params[1], params[2], params[3], params[4]);
+        }
+    }
+    error = evaluate_error(data, params, k, options.lambda, options.threads, nullptr);
+
+    if (!write_header(options.output_path, params, data.size(), error, k)) {
+        std::println(stderr, "Cannot write {}", options.output_path);
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::println("Final error {:.6f}; wrote {} in {:.1f} s", error, options.output_path, seconds);
+    return 0;
+}
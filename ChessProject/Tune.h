@@ -0,0 +1,23 @@
+#pragma once
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TuneOptions {
+    std::vector<std::string> input_paths; // PackedPosition containers or EPD lines with a result
+    std::string output_path = "EvalParams.h";
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int iterations = 1000;
+    double learning_rate = 1.0;   // Adam step size in centipawns
+    double lambda = 1.0;          // Weight of the game result against the search score in the target
+};
+
+// Parses the arguments following "tune" on the command line.
+std::optional<TuneOptions> parse_tune_args(const std::vector<std::string>& args);
+
+// Texel tuning of the parameters in EvalParams.h: fits the sigmoid scale to
+// the data, minimises the mean squared error with full-batch Adam spread
+// over all threads, and writes the result as a new EvalParams.h.
+int run_tune(const TuneOptions& options);
@@ -0,0 +1,249 @@
+#include "UciEngine.h"
+#include <algorithm>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <thread>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+bool UciEngine::start(const std::string& command) {
+    if (!launch(command)) return false;
+    send("uci");
+    if (!wait_for("uciok", std::chrono::seconds(10))) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+bool UciEngine::launch(const std::string& command) {
+    stop();
+#ifdef _WIN32
+    // Our pipe ends are never inheritable, and the child inherits only the
+    // handles in its list even when another thread starts a child at the
+    // same time: a sibling holding the write end would keep this child from
+    // ever seeing EOF.
+    HANDLE child_in_read, child_in_write, child_out_read, child_out_write;
+    if (!CreatePipe(&child_in_read, &child_in_write, nullptr, 0)) return false;
+    if (!CreatePipe(&child_out_read, &child_out_write, nullptr, 0)) {
+        CloseHandle(child_in_read);
+        CloseHandle(child_in_write);
+        return false;
+    }
+    SetHandleInformation(child_in_read, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+    SetHandleInformation(child_out_write, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+    HANDLE child_err = GetStdHandle(STD_ERROR_HANDLE);
+    HANDLE inherited[3] = { child_in_read, child_out_write, child_err };
+    DWORD inherited_count = 2;
+    if (child_err && child_err != INVALID_HANDLE_VALUE &&
+        SetHandleInformation(child_err, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT)) {
+        inherited_count = 3;
+    }
+
+    SIZE_T attributes_size = 0;
+    InitializeProcThreadAttributeList(nullptr, 1, 0, &attributes_size);
+    std::vector<char> attributes_buffer(attributes_size);
+    auto attributes = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributes_buffer.data());
+    bool attributes_ok = InitializeProcThreadAttributeList(attributes, 1, 0, &attributes_size);
+    if (attributes_ok && !UpdateProcThreadAttribute(attributes, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited,
+                                                    inherited_count * sizeof(HANDLE), nullptr, nullptr)) {
+        DeleteProcThreadAttributeList(attributes);
+        attributes_ok = false;
+    }
+
+    STARTUPINFOEXA si{};
+    si.StartupInfo.cb = sizeof(si);
+    si.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+    si.StartupInfo.hStdInput = child_in_read;
+    si.StartupInfo.hStdOutput = child_out_write;
+    si.StartupInfo.hStdError = inherited_count == 3 ? child_err : nullptr;
+    si.lpAttributeList = attributes;
+    PROCESS_INFORMATION pi{};
+    std::string cmdline = command;
+    BOOL ok = attributes_ok &&
+              CreateProcessA(nullptr, cmdline.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW | EXTENDED_STARTUPINFO_PRESENT,
+                             nullptr, nullptr, &si.StartupInfo, &pi);
+    if (attributes_ok) DeleteProcThreadAttributeList(attributes);
+    CloseHandle(child_in_read);
+    CloseHandle(child_out_write);
+    if (!ok) {
+        CloseHandle(child_in_write);
+        CloseHandle(child_out_read);
+        return false;
+    }
+    CloseHandle(pi.hThread);
+    process_ = pi.hProcess;
+    to_child_ = child_in_write;
+    from_child_ = child_out_read;
+#else
+    // No pipe end may leak into another child, not even one forked by
+    // another thread while this one is starting: a sibling holding the
+    // write end would keep this child from ever seeing EOF. The pipes are
+    // close-on-exec from the start; dup2 clears the flag on the child's
+    // stdin and stdout.
+    int in_pipe[2], out_pipe[2];
+    if (pipe2(in_pipe, O_CLOEXEC) != 0) return false;
+    if (pipe2(out_pipe, O_CLOEXEC) != 0) {
+        ::close(in_pipe[0]);
+        ::close(in_pipe[1]);
+        return false;
+    }
+    // The child may only make async-signal-safe calls until exec: another
+    // thread can hold the allocator lock at the fork, so the command line
+    // is built here. exec makes the engine itself the child, so it receives
+    // the kill signal.
+    std::string shell_command = "exec " + command;
+    const char* argv[] = { "sh", "-c", shell_command.c_str(), nullptr };
+    pid_t pid = fork();
+    if (pid < 0) {
+        for (int fd : { in_pipe[0], in_pipe[1], out_pipe[0], out_pipe[1] }) ::close(fd);
+        return false;
+    }
+    if (pid == 0) {
+        dup2(in_pipe[0], STDIN_FILENO);
+        dup2(out_pipe[1], STDOUT_FILENO);
+        for (int fd : { in_pipe[0], in_pipe[1], out_pipe[0], out_pipe[1] }) ::close(fd);
+        execv("/bin/sh", const_cast<char* const*>(argv));
+        _exit(127);
+    }
+    ::close(in_pipe[0]);
+    ::close(out_pipe[1]);
+    pid_ = pid;
+    to_child_ = in_pipe[1];
+    from_child_ = out_pipe[0];
+    signal(SIGPIPE, SIG_IGN); // a crashed engine must not take the runner down
+#endif
+    buffer_.clear();
+    exited_ = false;
+    return true;
+}
+
+void UciEngine::stop() {
+    if (!is_running()) return;
+    send("quit");
+#ifdef _WIN32
+    if (WaitForSingleObject(process_, 1000) != WAIT_OBJECT_0) TerminateProcess(process_, 1);
+    CloseHandle(to_child_);
+    CloseHandle(from_child_);
+    CloseHandle(process_);
+    process_ = to_child_ = from_child_ = nullptr;
+#else
+    ::close(to_child_);
+    ::close(from_child_);
+    int status = 0;
+    for (int i = 0; i < 100 && waitpid(pid_, &status, WNOHANG) == 0; ++i) usleep(10000);
+    if (waitpid(pid_, &status, WNOHANG) == 0) {
+        ::kill(pid_, SIGKILL);
+        waitpid(pid_, &status, 0);
+    }
+    pid_ = to_child_ = from_child_ = -1;
+#endif
+}
+
+void UciEngine::kill() {
+    if (!is_running()) return;
+#ifdef _WIN32
+    TerminateProcess(process_, 1);
+    WaitForSingleObject(process_, INFINITE);
+    CloseHandle(to_child_);
+    CloseHandle(from_child_);
+    CloseHandle(process_);
+    process_ = to_child_ = from_child_ = nullptr;
+#else
+    ::kill(pid_, SIGKILL);
+    ::close(to_child_);
+    ::close(from_child_);
+    int status = 0;
+    waitpid(pid_, &status, 0);
+    pid_ = to_child_ = from_child_ = -1;
+#endif
+}
+
+bool UciEngine::is_running() const {
+#ifdef _WIN32
+    return process_ != nullptr;
+#else
+    return pid_ > 0;
+#endif
+}
+
+void UciEngine::send(const std::string& line) {
+    if (!is_running()) return;
+    std::string data = line + "\n";
+#ifdef _WIN32
+    DWORD written;
+    WriteFile(to_child_, data.data(), static_cast<DWORD>(data.size()), &written, nullptr);
+#else
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = ::write(to_child_, p, left);
+        if (n <= 0) return;
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+#endif
+}
+
+std::optional<std::string> UciEngine::read_line(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        if (auto pos = buffer_.find('\n'); pos != std::string::npos) {
+            std::string line = buffer_.substr(0, pos);
+            buffer_.erase(0, pos + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return line;
+        }
+        if (!is_running()) return std::nullopt;
+
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) return std::nullopt;
+
+        char chunk[4096];
+#ifdef _WIN32
+        DWORD available = 0;
+        if (!PeekNamedPipe(from_child_, nullptr, 0, nullptr, &available, nullptr)) {
+            exited_ = true;
+            return std::nullopt;
+        }
+        if (available == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        DWORD n = 0;
+        if (!ReadFile(from_child_, chunk, std::min<DWORD>(available, sizeof(chunk)), &n, nullptr) || n == 0) {
+            exited_ = true;
+            return std::nullopt;
+        }
+#else
+        pollfd pfd{ from_child_, POLLIN, 0 };
+        int ready = poll(&pfd, 1, static_cast<int>(left.count()));
+        if (ready <= 0) continue;
+        ssize_t n = ::read(from_child_, chunk, sizeof(chunk));
+        if (n <= 0) {
+            exited_ = true;
+            return std::nullopt;
+        }
+#endif
+        buffer_.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+std::optional<std::string> UciEngine::wait_for(const std::string& prefix, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        auto line = read_line(left);
+        if (!line) return std::nullopt;
+        if (line->starts_with(prefix)) return line;
+    }
+}
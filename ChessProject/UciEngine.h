@@ -0,0 +1,48 @@
+#pragma once
+#include <chrono>
+#include <optional>
+#include <string>
+
+// An external UCI engine running as a child process, driven over its
+// stdin/stdout pipes. launch() skips the handshake, for children that speak
+// another line protocol.
+class UciEngine {
+public:
+    UciEngine() = default;
+    ~UciEngine() { stop(); }
+
+    UciEngine(const UciEngine&) = delete;
+    UciEngine& operator=(const UciEngine&) = delete;
+
+    // Starts `command` through the shell and completes the uci/uciok handshake.
+    bool start(const std::string& command);
+    bool launch(const std::string& command);
+    void stop();
+    // Ends the child at once, without "quit", and reaps it: for a child
+    // that stopped answering and would not read "quit" either.
+    void kill();
+    bool is_running() const;
+    // The child closed its output, normally because it exited.
+    bool exited() const { return exited_; }
+
+    void send(const std::string& line);
+
+    // Next line of engine output, or nullopt on timeout or when the engine exits.
+    std::optional<std::string> read_line(std::chrono::milliseconds timeout);
+
+    // Reads until a line starting with `prefix` and returns it.
+    std::optional<std::string> wait_for(const std::string& prefix, std::chrono::milliseconds timeout);
+
+private:
+    std::string buffer_;
+    bool exited_ = false;
+#ifdef _WIN32
+    void* process_ = nullptr;
+    void* to_child_ = nullptr;
+    void* from_child_ = nullptr;
+#else
+    int pid_ = -1;
+    int to_child_ = -1;
+    int from_child_ = -1;
+#endif
+};
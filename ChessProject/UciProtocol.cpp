@@ -1,9 +1,23 @@
 #include "UciProtocol.h"
+#include "CpuFeatures.h"
+#include "MoveGen.h"
+#include "Syzygy.h"
+#include "Zobrist.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
+#include <fstream>
 
-UciProtocol::UciProtocol(Logger& logger)
-    : logger_(logger), move_selector_(std::thread::hardware_concurrency()) {}
+UciProtocol::UciProtocol(Logger& logger, std::string stats_json_path)
+    : logger_(logger), move_selector_(std::thread::hardware_concurrency()), stats_json_path_(std::move(stats_json_path)) {
+    move_selector_.set_transposition_table(&tt_);
+    log_memory();
+    move_selector_.set_iteration_callback([this](int depth, const std::vector<RootLine>& lines, const SearchStats& stats) {
+        print_iteration(depth, lines, stats);
+    });
+}
 
 void UciProtocol::run() {
     logger_.log("UCI protocol run() started", LogLevel::Info);
@@ -22,18 +36,33 @@ void UciProtocol::handle_command(const std::string& line) {
     else if (cmd == "ucinewgame") cmd_ucinewgame();
     else if (cmd == "position") cmd_position(line.substr(8));
     else if (cmd == "go") cmd_go(line.substr(2));
+    else if (cmd == "setoption") cmd_setoption(line.substr(9));
     else if (cmd == "quit") cmd_quit();
-    // TODO: Add support for setoption, stop, ponderhit, etc.
+    else if (cmd == "stats") cmd_stats();
+    // TODO: Add support for stop, ponderhit, etc.
     else if (cmd == "help") {
-        std::cout << "Supported UCI commands: uci, isready, ucinewgame, position, go, quit" << std::endl;
+        std::cout << "Supported UCI commands: uci, isready, ucinewgame, position, go, setoption, quit, stats" << std::endl;
         logger_.log("Handled help", LogLevel::Info);
     }
     else logger_.log("Unknown command: " + cmd, LogLevel::Warning);
 }
 
 void UciProtocol::cmd_uci() {
-    std::cout << "id name MyChessEngine" << std::endl;
+    std::cout << "id name MyChessEngine (" << kernel_variant_name(kernel_variant()) << ")" << std::endl;
     std::cout << "id author YourName" << std::endl;
+    std::cout << "option name Hash type spin default 16 min 1 max 65536" << std::endl;
+    std::cout << "option name OwnBook type check default false" << std::endl;
+    std::cout << "option name BookFile type string default <empty>" << std::endl;
+    std::cout << "option name BookBestMove type check default false" << std::endl;
+    std::cout << "option name SyzygyPath type string default <empty>" << std::endl;
+    std::cout << "option name SyzygyProbeDepth type spin default 1 min 1 max 100" << std::endl;
+    std::cout << "option name SyzygyProbeLimit type spin default 7 min 0 max 7" << std::endl;
+    std::cout << "option name Syzygy50MoveRule type check default true" << std::endl;
+    std::cout << "option name AnalysisCache type string default <empty>" << std::endl;
+    std::cout << "option name AnalysisCacheDepth type spin default 6 min 1 max 63" << std::endl;
+    std::cout << "option name MultiPV type spin default 1 min 1 max 256" << std::endl;
+    std::cout << "option name MateChecksOnly type check default false" << std::endl;
+    std::cout << "option name CpuVariant type combo default auto var auto var avx2 var scalar" << std::endl;
     std::cout << "uciok" << std::endl;
 }
 
@@ -43,30 +72,217 @@ void UciProtocol::cmd_isready() {
 
 void UciProtocol::cmd_ucinewgame() {
     board_.setup_initial_position();
+    tt_.clear();
+    mate_search_.clear();
+    warm_from_cache();
     logger_.log("New game started (ucinewgame)", LogLevel::Info);
 }
 
 void UciProtocol::cmd_position(const std::string& args) {
     std::istringstream iss(args);
     std::string token;
-    if (args.find("startpos") != std::string::npos) {
+    iss >> token;
+    if (token == "startpos") {
         board_.setup_initial_position();
-    } else if (args.find("fen") != std::string::npos) {
-        iss >> token; // skip "fen"
+        iss >> token;
+    } else if (token == "fen") {
         std::string fen;
-        std::getline(iss, fen);
+        while (iss >> token && token != "moves") fen += token + " ";
         board_.set_fen(fen);
     }
-    // TODO: Parse and apply moves after position
-    logger_.log("Position set: " + args, LogLevel::Debug);
+    // Positions before the current one, for repetition detection in the search
+    std::vector<uint64_t> history;
+    if (token == "moves") {
+        while (iss >> token) {
+            auto move = parse_move(board_, token);
+            if (!move) {
+                logger_.log("Illegal move in position command: " + token, LogLevel::Warning);
+                break;
+            }
+            history.push_back(zobrist_key(board_));
+            apply_move(board_, *move);
+        }
+    }
+    move_selector_.set_game_history(std::move(history));
+    if (logger_.enabled(LogLevel::Debug)) logger_.log("Position set: " + args, LogLevel::Debug);
 }
 
 void UciProtocol::cmd_go(const std::string& args) {
-    // TODO: Parse search parameters (depth, movetime, etc.)
-    Color side = Color::White; // TODO: Determine from board state
-    Move best = move_selector_.select_best_move(board_, side, 4);
+    // Book moves are answered without searching.
+    if (own_book_ && book_.is_open()) {
+        if (auto book_move = book_.probe(board_, book_pick_)) {
+            std::string text = book_move->to_algebraic(board_);
+            if (parse_move(board_, text)) {
+                std::cout << "bestmove " << text << std::endl;
+                logger_.log("Book move sent: " + text, LogLevel::Info);
+                return;
+            }
+        }
+    }
+
+    // go [depth N] [nodes N] [movetime ms] [mate N] [wtime ms btime ms winc ms binc ms]
+    Color side = board_.get_side_to_move();
+    SearchLimits limits;
+    bool has_depth = false;
+    int mate_moves = 0;
+    int64_t time_left = 0, increment = 0;
+    std::istringstream iss(args);
+    std::string token;
+    while (iss >> token) {
+        if (token == "depth") { iss >> limits.depth; has_depth = true; }
+        else if (token == "nodes") iss >> limits.nodes;
+        else if (token == "movetime") iss >> limits.movetime_ms;
+        else if (token == "mate") iss >> mate_moves;
+        else if (token == (side == Color::White ? "wtime" : "btime")) iss >> time_left;
+        else if (token == (side == Color::White ? "winc" : "binc")) iss >> increment;
+    }
+    // Spend a fixed share of the clock when no move time is given.
+    if (limits.movetime_ms == 0 && time_left > 0) limits.movetime_ms = std::max<int64_t>(time_left / 30 + increment / 2, 1);
+    if (!has_depth && (limits.nodes || limits.movetime_ms)) limits.depth = SearchLimits::MaxDepth;
+
+    // Without a proven mate the regular search still answers with a move,
+    // in the time the mate search left.
+    if (mate_moves > 0) {
+        auto mate_start = std::chrono::steady_clock::now();
+        if (go_mate(mate_moves, limits)) return;
+        if (limits.movetime_ms > 0) {
+            auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - mate_start).count();
+            limits.movetime_ms = std::max<int64_t>(limits.movetime_ms - spent, 1);
+        }
+    }
+
+    // Info lines are printed after each iteration by print_iteration.
+    Move best = move_selector_.search(board_, side, limits);
+    const SearchStats& stats = move_selector_.last_stats();
     std::cout << "bestmove " << best.to_algebraic(board_) << std::endl;
     logger_.log("Best move sent: " + best.to_algebraic(board_), LogLevel::Info);
+
+    Board root = board_;
+    root.set_side_to_move(side);
+    if (move_selector_.history_independent(root)) cache_.record_search(tt_, root, stats.depth);
+
+    if (!stats_json_path_.empty()) {
+        std::ofstream out(stats_json_path_, std::ios::app);
+        out << move_selector_.last_stats().to_json() << '\n';
+    }
+}
+
+void UciProtocol::cmd_setoption(const std::string& args) {
+    // setoption name <id> [value <x>]
+    std::istringstream iss(args);
+    std::string token, name, value;
+    iss >> token; // "name"
+    while (iss >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+    std::getline(iss >> std::ws, value);
+
+    if (name == "Hash") {
+        tt_.resize(std::clamp(std::atoi(value.c_str()), 1, 65536));
+        log_memory();
+        warm_from_cache();
+    } else if (name == "OwnBook") {
+        own_book_ = (value == "true");
+    } else if (name == "BookFile") {
+        if (value.empty() || value == "<empty>") {
+            book_.close();
+        } else if (book_.open(value)) {
+            logger_.log("Opened book " + value + " (" + std::to_string(book_.entry_count()) + " entries)", LogLevel::Info);
+        } else {
+            logger_.log("Cannot open book " + value, LogLevel::Warning);
+        }
+    } else if (name == "BookBestMove") {
+        book_pick_ = (value == "true") ? OpeningBook::Pick::Best : OpeningBook::Pick::Weighted;
+    } else if (name == "SyzygyPath") {
+        int found = syzygy_init(value);
+        logger_.log("Syzygy: " + std::to_string(found) + " tables found, up to " +
+                    std::to_string(syzygy_max_pieces()) + " pieces", LogLevel::Info);
+    } else if (name == "SyzygyProbeDepth") {
+        syzygy_options.probe_depth = std::clamp(std::atoi(value.c_str()), 1, 100);
+    } else if (name == "SyzygyProbeLimit") {
+        syzygy_options.probe_limit = std::clamp(std::atoi(value.c_str()), 0, 7);
+    } else if (name == "Syzygy50MoveRule") {
+        syzygy_options.use_rule50 = (value == "true");
+    } else if (name == "AnalysisCache") {
+        if (value.empty() || value == "<empty>") {
+            cache_.close();
+        } else if (cache_.open(value)) {
+            warm_from_cache();
+        } else {
+            logger_.log("Cannot open analysis cache " + value, LogLevel::Warning);
+        }
+    } else if (name == "AnalysisCacheDepth") {
+        cache_.set_min_depth(std::clamp(std::atoi(value.c_str()), 1, 63));
+    } else if (name == "MultiPV") {
+        move_selector_.set_multi_pv(std::clamp(std::atoi(value.c_str()), 1, 256));
+    } else if (name == "MateChecksOnly") {
+        // Disproofs found with checks only do not hold for all moves.
+        bool checks_only = (value == "true");
+        if (checks_only != mate_checks_only_) mate_search_.clear();
+        mate_checks_only_ = checks_only;
+    } else if (name == "CpuVariant") {
+        if (!set_kernel_variant(value)) logger_.log("CPU variant " + value + " is unknown or not supported by this host", LogLevel::Warning);
+        logger_.log("CPU features: " + cpu_features().to_string() + ", kernels: " +
+                    std::string(kernel_variant_name(kernel_variant())), LogLevel::Info);
+    } else {
+        logger_.log("Unknown option: " + name, LogLevel::Warning);
+    }
+}
+
+void UciProtocol::log_memory() {
+    logger_.log("Hash: " + std::to_string(tt_.megabytes()) + " MB, " + tt_.page_description() + "; " +
+                numa_description(), LogLevel::Info);
+}
+
+void UciProtocol::warm_from_cache() {
+    if (!cache_.is_open()) return;
+    size_t count = cache_.warm(tt_);
+    logger_.log("Analysis cache " + cache_.path() + ": " + std::to_string(count) + " entries loaded", LogLevel::Info);
+}
+
+bool UciProtocol::go_mate(int moves, const SearchLimits& limits) {
+    MateOptions options;
+    options.max_moves = moves;
+    options.checks_only = mate_checks_only_;
+    options.nodes = limits.nodes;
+    options.movetime_ms = limits.movetime_ms;
+    MateResult result = mate_search_.find(board_, options);
+    if (result.line.empty()) {
+        std::cout << "info string no mate in " << moves << (result.aborted ? " proven within the budget" : "")
+                  << " nodes " << result.nodes << " time " << static_cast<long long>(result.elapsed_ms) << std::endl;
+        return false;
+    }
+
+    std::cout << "info depth " << 2 * result.moves - 1 << " score mate " << result.moves << " nodes " << result.nodes
+              << " time " << static_cast<long long>(result.elapsed_ms) << " pv";
+    Board line = board_;
+    for (const auto& move : result.line) {
+        std::cout << " " << move.to_algebraic(line);
+        apply_move(line, move);
+    }
+    std::cout << std::endl;
+    std::cout << "bestmove " << result.line.front().to_algebraic(board_) << std::endl;
+    logger_.log("Mate in " + std::to_string(result.moves) + " sent: " + result.line.front().to_algebraic(board_), LogLevel::Info);
+    return true;
+}
+
+void UciProtocol::print_iteration(int depth, const std::vector<RootLine>& lines, const SearchStats& stats) {
+    bool multi = move_selector_.multi_pv() > 1;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        std::cout << "info depth " << depth;
+        if (multi) std::cout << " multipv " << i + 1;
+        std::cout << " score cp " << lines[i].score << " nodes " << stats.total.nodes << " tbhits " << stats.total.tb_hits
+                  << " time " << static_cast<long long>(stats.elapsed_ms) << " hashfull " << tt_.hashfull() << " pv";
+        Board line = board_;
+        for (const auto& move : lines[i].pv) {
+            std::cout << " " << move.to_algebraic(line);
+            apply_move(line, move);
+        }
+        std::cout << std::endl;
+    }
+}
+
+// Non-standard: dumps the counters of the last search as one JSON object.
+void UciProtocol::cmd_stats() {
+    std::cout << "info string stats " << move_selector_.last_stats().to_json() << std::endl;
 }
 
 void UciProtocol::cmd_quit() {
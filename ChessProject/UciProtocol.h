@@ -2,6 +2,10 @@
 #include "Board.h"
 #include "Eval.h"
 #include "Logger.h"
+#include "AnalysisCache.h"
+#include "Book.h"
+#include "Mate.h"
+#include "TranspositionTable.h"
 #include <string>
 #include <atomic>
 #include <thread>
@@ -10,7 +14,7 @@
 
 class UciProtocol {
 public:
-    explicit UciProtocol(Logger& logger);
+    explicit UciProtocol(Logger& logger, std::string stats_json_path = {});
 
     void run();
 
@@ -18,7 +22,17 @@ private:
     Logger& logger_;
     Board board_;
     MoveSelector move_selector_;
+    TranspositionTable tt_;
     std::atomic<bool> running_{true};
+    std::string stats_json_path_; // Appends one JSON line per search when set
+
+    // Options
+    OpeningBook book_;
+    bool own_book_ = false;
+    OpeningBook::Pick book_pick_ = OpeningBook::Pick::Weighted;
+    AnalysisCache cache_;
+    MateSearch mate_search_;
+    bool mate_checks_only_ = false;
 
     void handle_command(const std::string& line);
 
@@ -28,7 +42,20 @@ private:
     void cmd_ucinewgame();
     void cmd_position(const std::string& args);
     void cmd_go(const std::string& args);
+    void cmd_setoption(const std::string& args);
     void cmd_quit();
 
-    // TODO: Add advanced UCI commands (setoption, stop, ponderhit, etc.)
+    // Extensions
+    void cmd_stats();
+
+    // Reloads the analysis cache into tt_ after the table was cleared.
+    void warm_from_cache();
+    // Logs the hash size, its page size and the NUMA binding.
+    void log_memory();
+    // Answers "go mate N" with a proof-number search; false when no mate was found.
+    bool go_mate(int moves, const SearchLimits& limits);
+    // Prints the info lines of one completed iteration, one per MultiPV line.
+    void print_iteration(int depth, const std::vector<RootLine>& lines, const SearchStats& stats);
+
+    // TODO: Add advanced UCI commands (stop, ponderhit, etc.)
 };
\ No newline at end of file
@@ -0,0 +1,7 @@
+#pragma once
+#include <cstdint>
+#include "Board.h"
+
+// Position hash using the Polyglot random table, so keys can be used both
+// for opening book lookups and as the engine's own Zobrist hash.
+uint64_t zobrist_key(const Board& board);
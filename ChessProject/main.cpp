@@ -1,4 +1,5 @@
 #include <string>
+#include <chrono>
 #include <print>
 #include <algorithm>
 #include <execution>
@@ -11,6 +12,19 @@
 #include "Eval.h"
 #include "UciProtocol.h"
 #include "Logger.h"
+#include "Bitbase.h"
+#include "SelfPlay.h"
+#include "Analyze.h"
+#include "AnalysisCache.h"
+#include "Server.h"
+#include "Coordinator.h"
+#include "LiveAnalysis.h"
+#include "Pgn.h"
+#include "Fen.h"
+#include "PackedPosition.h"
+#include "Perft.h"
+#include "Gensfen.h"
+#include "Tune.h"
 //#include "TuiApp.h"
 //#include <notcurses/notcurses.h>
 
@@ -61,7 +75,7 @@ static void test_tui() {
     board.clear_board(); // Call the non-static member function on the object
     std::println("Clearing the board\n{}", board.to_string());
 
-    board.set_fen("8/8/8/8/8/8/4K3/4k3");
+    board.set_fen("8/8/8/8/8/8/4K3/4k3 w - -");
     std::println("Setting board up with custom fen string.\n{}", board.to_string());
 
     board.set_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
@@ -116,10 +130,210 @@ static void testing_the_scenarios() {
 }
 
 int main(int argc, char* argv[]) {
+    // selfplay --engine <spec> --engine <spec> [--openings file] [--games n] [--concurrency n]
+    //          [--max-plies n] [--pgn file] [--sprt elo0,elo1[,alpha,beta]]
+    if (argc > 1 && std::string(argv[1]) == "selfplay") {
+        auto options = parse_selfplay_args(std::vector<std::string>(argv + 2, argv + argc));
+        if (!options) {
+            std::println(stderr, "usage: {} selfplay --engine name=a,depth=3 --engine name=b,cmd=./other,movetime=100 "
+                                 "[--openings file] [--games n] [--concurrency n] [--max-plies n] [--pgn file] "
+                                 "[--sprt elo0,elo1[,alpha,beta]]", argv[0]);
+            return 1;
+        }
+        bitbase_generate();
+        return run_selfplay(*options);
+    }
+
+    // analyze --input file|- [--output file] [--workers n] [--depth n] [--nodes n] [--movetime ms]
+    //         [--hash mb] [--shared-hash] [--cache file] [--cache-depth n]
+    if (argc > 1 && std::string(argv[1]) == "analyze") {
+        auto options = parse_analyze_args(std::vector<std::string>(argv + 2, argv + argc));
+        if (!options) {
+            std::println(stderr, "usage: {} analyze --input positions.epd [--output results.jsonl] [--workers n] "
+                                 "[--depth n] [--nodes n] [--movetime ms] [--hash mb] [--shared-hash] [--cache file] "
+                                 "[--cache-depth n]", argv[0]);
+            return 1;
+        }
+        bitbase_generate();
+        return run_analyze(*options);
+    }
+
+    // serve --socket path | --port n | --stdio [--workers n] [--hash mb] [--depth n] [--nodes n] [--movetime ms]
+    //       [--max-pending n]
+    if (argc > 1 && std::string(argv[1]) == "serve") {
+        auto options = parse_server_args(std::vector<std::string>(argv + 2, argv + argc));
+        if (!options) {
+            std::println(stderr, "usage: {} serve --socket /tmp/chess.sock | --port n | --stdio [--workers n] [--hash mb] "
+                                 "[--depth n] [--nodes n] [--movetime ms] [--max-pending n]", argv[0]);
+            return 1;
+        }
+        bitbase_generate();
+        return run_server(*options);
+    }
+
+    // coordinate (--worker spec)... [--local n] (--input file|- [--output file] | --fen fen|startpos [--moves m...])
+    //            [--depth n] [--nodes n] [--movetime ms] [--multipv n] [--inflight n] [--retries n] [--timeout ms]
+    //            [--local-threads n] [--local-hash mb]
+    if (argc > 1 && std::string(argv[1]) == "coordinate") {
+        auto options = parse_coordinator_args(std::vector<std::string>(argv + 2, argv + argc));
+        if (!options) {
+            std::println(stderr, "usage: {} coordinate [--worker cmd=...|unix:path|tcp:host:port]... [--local n] "
+                                 "(--input positions.epd [--output results.jsonl] | --fen fen|startpos [--moves m...]) "
+                                 "[--depth n] [--nodes n] [--movetime ms] [--multipv n] [--inflight n] "
+                                 "[--retries n] [--timeout ms] [--local-threads n] [--local-hash mb]", argv[0]);
+            return 1;
+        }
+        options->self_path = argv[0];
+        bitbase_generate();
+        return run_coordinator(*options);
+    }
+
+    // live [--fen fen|startpos] [--moves m...] [--depth n] [--nodes n] [--movetime ms] [--threads n] [--hash mb]
+    //      [--multipv n] [--refresh ms]
+    if (argc > 1 && std::string(argv[1]) == "live") {
+        auto options = parse_live_args(std::vector<std::string>(argv + 2, argv + argc));
+        if (!options) {
+            std::println(stderr, "usage: {} live [--fen fen|startpos] [--moves m...] [--depth n] [--nodes n] "
+                                 "[--movetime ms] [--threads n] [--hash mb] [--multipv n] [--refresh ms]", argv[0]);
+            return 1;
+        }
+        bitbase_generate();
+        return run_live(*options);
+    }
+
+    // cache-compact --input cache.bin [--output compacted.bin] [--min-depth n]
+    if (argc > 1 && std::string(argv[1]) == "cache-compact") {
+        std::string input, output;
+        int min_depth = 0;
+        for (int i = 2; i + 1 < argc; i += 2) {
+            std::string arg = argv[i];
+            if (arg == "--input") input = argv[i + 1];
+            else if (arg == "--output") output = argv[i + 1];
+            else if (arg == "--min-depth") min_depth = std::atoi(argv[i + 1]);
+        }
+        if (input.empty()) {
+            std::println(stderr, "usage: {} cache-compact --input cache.bin [--output compacted.bin] [--min-depth n]", argv[0]);
+            return 1;
+        }
+        size_t records_in = 0, records_out = 0;
+        if (!compact_analysis_cache(input, output.empty() ? input : output, min_depth, records_in, records_out)) {
+            std::println(stderr, "Cannot compact {}", input);
+            return 1;
+        }
+        std::println("{} records in, {} records out", records_in, records_out);
+        return 0;
+    }
+
+    // pgn --input games.pgn [--threads n] [--verify-san]
+    if (argc > 1 && std::string(argv[1]) == "pgn") {
+        auto options = parse_pgn_args(std::vector<std::string>(argv + 2, argv + argc));
+        if (!options) {
+            std::println(stderr, "usage: {} pgn --input games.pgn [--threads n] [--verify-san]", argv[0]);
+            return 1;
+        }
+        return run_pgn(*options);
+    }
+
+    // fen-check --input positions.epd [--lenient] [--max-reports n]
+    if (argc > 1 && std::string(argv[1]) == "fen-check") {
+        auto options = parse_fen_check_args(std::vector<std::string>(argv + 2, argv + argc));
+        if (!options) {
+            std::println(stderr, "usage: {} fen-check --input positions.epd [--lenient] [--max-reports n]", argv[0]);
+            return 1;
+        }
+        return run_fen_check(*options);
+    }
+
+    // perft [--fen fen] [--depth n]
+    if (argc > 1 && std::string(argv[1]) == "perft") {
+        auto options = parse_perft_args(std::vector<std::string>(argv + 2, argv + argc));
+        if (!options) {
+            std::println(stderr, "usage: {} perft [--fen fen] [--depth n]", argv[0]);
+            return 1;
+        }
+        return run_perft(*options);
+    }
+
+    // pack --input positions.epd --output positions.bin [--append]
+    if (argc > 1 && std::string(argv[1]) == "pack") {
+        auto options = parse_pack_args(std::vector<std::string>(argv + 2, argv + argc));
+        if (!options) {
+            std::println(stderr, "usage: {} pack --input positions.epd --output positions.bin [--append]", argv[0]);
+            return 1;
+        }
+        return run_pack(*options);
+    }
+
+    // gensfen --output samples.bin [--positions n] [--threads n] [--depth n] [--nodes n] [--random-plies n]
+    //         [--max-plies n] [--max-score cp] [--eval-margin cp] [--hash mb] [--flush-ms n] [--seed n] [--append]
+    if (argc > 1 && std::string(argv[1]) == "gensfen") {
+        auto options = parse_gensfen_args(std::vector<std::string>(argv + 2, argv + argc));
+        if (!options) {
+            std::println(stderr, "usage: {} gensfen --output samples.bin [--positions n] [--threads n] [--depth n] "
+                                 "[--nodes n] [--random-plies n] [--max-plies n] [--max-score cp] [--eval-margin cp] "
+                                 "[--hash mb] [--flush-ms n] [--seed n] [--append]", argv[0]);
+            return 1;
+        }
+        bitbase_generate();
+        return run_gensfen(*options);
+    }
+
+    // tune --input samples.bin [--input more.epd] [--output EvalParams.h] [--threads n] [--iterations n]
+    //      [--lr x] [--lambda x]
+    if (argc > 1 && std::string(argv[1]) == "tune") {
+        auto options = parse_tune_args(std::vector<std::string>(argv + 2, argv + argc));
+        if (!options) {
+            std::println(stderr, "usage: {} tune --input samples.bin [--input more.epd] [--output EvalParams.h] "
+                                 "[--threads n] [--iterations n] [--lr x] [--lambda x]", argv[0]);
+            return 1;
+        }
+        return run_tune(*options);
+    }
+
     Board board; // Ensure an object of Board is created
 
-	Logger logger; // Create a Logger instance
-	UciProtocol uci(logger); // Create a UCI protocol instance
+    Logger logger; // Create a Logger instance
+
+    std::string stats_json_path; // --stats-json <file>: append search stats per move
+    std::string bitbase_path;    // --bitbase-file <file>: load KPK/KRK/KQK bitbases, generating them if missing
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--stats-json" && i + 1 < argc) {
+            stats_json_path = argv[++i];
+        }
+        else if (arg == "--log-file" && i + 1 < argc) { // async logging to a file
+            std::string path = argv[++i];
+            if (!logger.start_async(path)) std::println(stderr, "Cannot open log file {}", path);
+        }
+        else if (arg == "--bitbase-file" && i + 1 < argc) {
+            bitbase_path = argv[++i];
+        }
+        else if (arg == "--log-level" && i + 1 < argc) { // debug, info, warn, error
+            std::string level = argv[++i];
+            if (level == "debug") logger.set_min_level(LogLevel::Debug);
+            else if (level == "info") logger.set_min_level(LogLevel::Info);
+            else if (level == "warn") logger.set_min_level(LogLevel::Warning);
+            else if (level == "error") logger.set_min_level(LogLevel::Error);
+            else {
+                std::println(stderr, "Unknown log level {}", level);
+                std::println(stderr, "usage: {} [--log-file file] [--log-level debug|info|warn|error] [--stats-json file] "
+                                     "[--bitbase-file file]", argv[0]);
+                return 1;
+            }
+        }
+    }
+
+    if (bitbase_path.empty() || !bitbase_load(bitbase_path)) {
+        auto start = std::chrono::steady_clock::now();
+        bitbase_generate();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        logger.log("Generated endgame bitbases in " + std::to_string(ms) + " ms", LogLevel::Info);
+        if (!bitbase_path.empty() && !bitbase_save(bitbase_path)) {
+            logger.log("Cannot write bitbase file " + bitbase_path, LogLevel::Warning);
+        }
+    }
+
+	UciProtocol uci(logger, stats_json_path); // Create a UCI protocol instance
 
     uci.run();
 